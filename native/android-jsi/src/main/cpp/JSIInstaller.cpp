@@ -11,7 +11,9 @@ extern "C" JNIEXPORT void JNICALL Java_com_nozbe_watermelondb_jsi_JSIInstaller_i
     jsi::Runtime *runtime = (jsi::Runtime *)runtimePtr;
     assert(runtime != nullptr);
     watermelondb::platform::configureJNI(env);
-    watermelondb::Database::install(runtime);
+    // NOTE: CallInvoker is not passed, so async methods (experimentalUsesAsyncJSI) are not available on Android.
+    // SqliteJsiDispatcher warns about it, and uses synchronous methods instead
+    watermelondb::Database::install(runtime, nullptr);
 }
 
 extern "C" JNIEXPORT void JNICALL Java_com_nozbe_watermelondb_jsi_JSIInstaller_provideSyncJson(JNIEnv *env, jclass clazz, jint id, jbyteArray array) {
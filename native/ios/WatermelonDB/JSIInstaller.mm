@@ -8,5 +8,5 @@ extern "C" void installWatermelonJSI(RCTCxxBridge *bridge) {
 
     jsi::Runtime *runtime = (jsi::Runtime*) bridge.runtime;
     assert(runtime != nullptr);
-    watermelondb::Database::install(runtime);
+    watermelondb::Database::install(runtime, bridge.jsCallInvoker);
 }
@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+#include "DatabasePlatform.h"
+#include "DatabasePlatformLinux.h"
+
+namespace watermelondb {
+namespace platform {
+
+void consoleLog(std::string message) {
+    if (std::getenv("WATERMELONDB_QUIET")) {
+        return;
+    }
+    std::fprintf(stdout, "[watermelondb] %s\n", message.c_str());
+}
+
+void consoleError(std::string message) {
+    std::fprintf(stderr, "[watermelondb] Error: %s\n", message.c_str());
+}
+
+std::once_flag sqliteInitialization;
+
+void initializeSqlite() {
+    std::call_once(sqliteInitialization, []() {
+        // Enable file URI syntax https://www.sqlite.org/uri.html (e.g. ?mode=memory&cache=shared)
+        if (sqlite3_config(SQLITE_CONFIG_URI, 1) != SQLITE_OK) {
+            consoleError("Failed to configure SQLite to support file URI syntax - shared cache will not work");
+        }
+
+        if (sqlite3_initialize() != SQLITE_OK) {
+            consoleError("Failed to initialize sqlite - this probably means sqlite was already initialized");
+        }
+    });
+}
+
+std::string resolveDatabasePath(std::string path) {
+    // Default: $XDG_DATA_HOME/watermelondb/<name>.db, or ./<name>.db if XDG_DATA_HOME is not set
+    namespace fs = std::filesystem;
+    fs::path directory = fs::current_path();
+    if (const char *dataHome = std::getenv("XDG_DATA_HOME")) {
+        directory = fs::path(dataHome) / "watermelondb";
+        std::error_code err;
+        fs::create_directories(directory, err);
+        if (err) {
+            throw std::runtime_error("Failed to resolve database path - could not create " + directory.string());
+        }
+    }
+    return (directory / (path + ".db")).string();
+}
+
+void deleteDatabaseFile(std::string path, bool warnIfDoesNotExist) {
+    namespace fs = std::filesystem;
+    if (!fs::exists(path)) {
+        if (warnIfDoesNotExist) {
+            consoleLog("Warning: Skipping deleting " + path + ", because it does not exist");
+        } else {
+            throw std::runtime_error("Could not delete database file " + path + " because it does not exist");
+        }
+        return;
+    }
+
+    std::error_code err;
+    fs::remove(path, err);
+    if (err) {
+        throw std::runtime_error("Could not delete database file - " + err.message());
+    }
+}
+
+void onMemoryAlert(std::function<void(void)> callback) {
+    // TODO: Unimplemented
+}
+
+std::unordered_map<int, std::string> providedSyncJsons;
+std::mutex providedSyncJsonsMutex;
+
+void provideJson(int id, std::string json) {
+    const std::lock_guard<std::mutex> lock(providedSyncJsonsMutex);
+
+    if (providedSyncJsons.find(id) != providedSyncJsons.end()) {
+        throw std::runtime_error("Sync json " + std::to_string(id) + " is already provided");
+    }
+
+    providedSyncJsons[id] = std::move(json);
+}
+
+std::string_view getSyncJson(int id) {
+    const std::lock_guard<std::mutex> lock(providedSyncJsonsMutex);
+
+    auto jsonSearch = providedSyncJsons.find(id);
+    if (jsonSearch == providedSyncJsons.end()) {
+        throw std::runtime_error("Sync json " + std::to_string(id) + " does not exist");
+    }
+
+    return std::string_view(jsonSearch->second);
+}
+
+void deleteSyncJson(int id) {
+    const std::lock_guard<std::mutex> lock(providedSyncJsonsMutex);
+    providedSyncJsons.erase(id);
+}
+
+std::vector<std::function<void()>> destroyListeners;
+
+void destroy() {
+    for (auto listener : destroyListeners) {
+        listener();
+    }
+    destroyListeners.clear();
+}
+
+void onDestroy(std::function<void()> callback) {
+    destroyListeners.push_back(callback);
+}
+
+} // namespace platform
+} // namespace watermelondb
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace watermelondb {
+namespace platform {
+
+void provideJson(int id, std::string json);
+void destroy();
+
+} // namespace platform
+} // namespace watermelondb
@@ -0,0 +1,680 @@
+// WatermelonDB native micro-benchmarks
+//
+// Runs the JSI methods installed by Database::install against fixed, deterministic datasets on a real
+// JSI runtime (Hermes), and reports rows/sec and p50/p99 latency per method. The intent is to catch
+// performance regressions in native/shared before they reach devices - absolute numbers obviously
+// differ from phones, but relative changes between commits are meaningful.
+//
+// Usage:
+//   watermelondb-benchmark [--sizes=10000,100000,1000000] [--shapes=narrow,wide] [--samples=30]
+//                          [--filter=query] [--query-limit=1000] [--sync-max-rows=100000]
+//                          [--chunk-max-rows=100000] [--memory] [--csv]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <hermes/hermes.h>
+#include <jsi/jsi.h>
+
+#include "Database.h"
+#include "DatabasePlatformLinux.h"
+
+using namespace facebook;
+
+namespace watermelondb {
+namespace benchmark {
+
+const char *const tableName = "records";
+
+struct Options {
+    std::vector<size_t> sizes = { 10000, 100000, 1000000 };
+    std::vector<std::string> shapes = { "narrow", "wide" };
+    size_t samples = 30;
+    size_t queryLimit = 1000;
+    size_t syncMaxRows = 100000;
+    size_t chunkMaxRows = 100000;
+    std::string filter = "";
+    bool inMemory = false;
+    bool csv = false;
+};
+
+// Table layout. Column names are t0.., n0.., b0.. (text, number, boolean); n0 is indexed and holds the
+// record's position, so that range queries have a predictable number of results
+struct Shape {
+    std::string name;
+    int textColumns;
+    int numberColumns;
+    int boolColumns;
+    size_t longTextLength; // last text column is "long" - e.g. a note body
+};
+
+Shape shapeNamed(const std::string &name) {
+    if (name == "narrow") {
+        return { "narrow", 1, 2, 1, 0 };
+    } else if (name == "wide") {
+        return { "wide", 10, 15, 5, 200 };
+    }
+    throw std::invalid_argument("Unknown shape " + name);
+}
+
+struct Dataset {
+    Shape shape;
+    size_t rows;
+    std::string name;
+    std::string path;
+    std::vector<std::string> ids;
+    std::vector<std::string> columnNames;
+};
+
+struct Result {
+    std::string dataset;
+    std::string method;
+    std::vector<double> latencies; // milliseconds
+    size_t rows;
+    std::string note;
+};
+
+std::string humanCount(size_t count) {
+    if (count % 1000000 == 0) {
+        return std::to_string(count / 1000000) + "M";
+    } else if (count % 1000 == 0) {
+        return std::to_string(count / 1000) + "k";
+    }
+    return std::to_string(count);
+}
+
+// MARK: - Data generation
+
+std::string randomString(std::mt19937 &rng, size_t length) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::uniform_int_distribution<size_t> dist(0, sizeof(alphabet) - 2);
+    std::string str(length, ' ');
+    for (size_t i = 0; i < length; i++) {
+        str[i] = alphabet[dist(rng)];
+    }
+    return str;
+}
+
+void appendColumnValues(std::string &json, std::mt19937 &rng, const Shape &shape, size_t position, bool withKeys) {
+    auto appendKey = [&](const std::string &key) {
+        if (withKeys) {
+            json += "\"" + key + "\":";
+        }
+    };
+    for (int i = 0; i < shape.textColumns; i++) {
+        bool isLong = shape.longTextLength && i == shape.textColumns - 1;
+        json += ",";
+        appendKey("t" + std::to_string(i));
+        json += "\"" + randomString(rng, isLong ? shape.longTextLength : 16) + "\"";
+    }
+    for (int i = 0; i < shape.numberColumns; i++) {
+        json += ",";
+        appendKey("n" + std::to_string(i));
+        json += i == 0 ? std::to_string(position) : std::to_string(std::uniform_real_distribution<double>(0, 1e6)(rng));
+    }
+    for (int i = 0; i < shape.boolColumns; i++) {
+        json += ",";
+        appendKey("b" + std::to_string(i));
+        json += std::uniform_int_distribution<int>(0, 1)(rng) ? (withKeys ? "true" : "1") : (withKeys ? "false" : "0");
+    }
+}
+
+std::string schemaSql(const Dataset &dataset) {
+    std::string sql = "create table \"local_storage\" (\"key\" varchar(16) primary key not null, \"value\" text not null);"
+                      "create index \"local_storage_key_index\" on \"local_storage\" (\"key\");";
+    sql += "create table \"" + std::string(tableName) + "\" (\"id\" primary key, \"_changed\", \"_status\"";
+    for (auto const &column : dataset.columnNames) {
+        sql += ", \"" + column + "\"";
+    }
+    sql += ");";
+    sql += "create index \"" + std::string(tableName) + "_n0\" on \"" + tableName + "\" (\"n0\");";
+    sql += "create index \"" + std::string(tableName) + "__status\" on \"" + tableName + "\" (\"_status\");";
+    return sql;
+}
+
+std::string insertSql(const Dataset &dataset) {
+    std::string sql = "insert into \"" + std::string(tableName) + "\" (\"id\", \"_status\", \"_changed\"";
+    for (auto const &column : dataset.columnNames) {
+        sql += ", \"" + column + "\"";
+    }
+    sql += ") values (?, ?, ?";
+    for (size_t i = 0; i < dataset.columnNames.size(); i++) {
+        sql += ", ?";
+    }
+    sql += ")";
+    return sql;
+}
+
+// Same format as encodeBatch() + JSON.stringify() on JS side
+std::vector<std::string> batchJsons(const Dataset &dataset, size_t batchSize) {
+    std::mt19937 rng(42);
+    std::vector<std::string> batches;
+    auto sql = insertSql(dataset);
+    for (size_t start = 0; start < dataset.rows; start += batchSize) {
+        std::string json = "[[1,\"" + std::string(tableName) + "\",\"" + sql + "\",[";
+        for (size_t i = start; i < std::min(start + batchSize, dataset.rows); i++) {
+            json += i == start ? "[" : ",[";
+            json += "\"" + dataset.ids[i] + "\",\"synced\",\"\"";
+            appendColumnValues(json, rng, dataset.shape, i, false);
+            json += "]";
+        }
+        json += "]]]";
+        batches.push_back(std::move(json));
+    }
+    return batches;
+}
+
+// Statement with `rowsPerStatement` rows of values, like the multi-row inserts of batchRecords (see RecordBatch.h)
+std::string multiRowInsertSql(const Dataset &dataset, size_t rowsPerStatement) {
+    auto sql = insertSql(dataset);
+    auto valuesSql = sql.substr(sql.find(" values ") + 8);
+    for (size_t i = 1; i < rowsPerStatement; i++) {
+        sql += ", " + valuesSql;
+    }
+    return sql;
+}
+
+// batchJSON inserting first `rows` rows of the dataset, `rowsPerStatement` rows at a time
+std::string chunkedInsertJson(const Dataset &dataset, size_t rows, size_t rowsPerStatement) {
+    std::mt19937 rng(42);
+    std::string json = "[[0,null,\"" + multiRowInsertSql(dataset, rowsPerStatement) + "\",[";
+    for (size_t start = 0; start < rows; start += rowsPerStatement) {
+        json += start == 0 ? "[" : ",[";
+        for (size_t i = start; i < start + rowsPerStatement; i++) {
+            json += i == start ? "" : ",";
+            json += "\"" + dataset.ids[i] + "\",\"synced\",\"\"";
+            appendColumnValues(json, rng, dataset.shape, i, false);
+        }
+        json += "]";
+    }
+    json += "]]]";
+    return json;
+}
+
+// batchJSON deleting first `rows` rows of the dataset by id, `rowsPerStatement` ids at a time
+std::string chunkedDeleteJson(const Dataset &dataset, size_t rows, size_t rowsPerStatement) {
+    std::string sql = "delete from \"" + std::string(tableName) + "\" where \"id\" in (?";
+    for (size_t i = 1; i < rowsPerStatement; i++) {
+        sql += ", ?";
+    }
+    sql += ")";
+    std::string json = "[[0,null,\"" + sql + "\",[";
+    for (size_t start = 0; start < rows; start += rowsPerStatement) {
+        json += start == 0 ? "[" : ",[";
+        for (size_t i = start; i < start + rowsPerStatement; i++) {
+            json += i == start ? "" : ",";
+            json += "\"" + dataset.ids[i] + "\"";
+        }
+        json += "]";
+    }
+    json += "]]]";
+    return json;
+}
+
+// Same format as sync pull response passed to unsafeLoadFromSync
+std::string syncJson(const Dataset &dataset) {
+    std::mt19937 rng(42);
+    std::string json = "{\"changes\":{\"" + std::string(tableName) + "\":{\"created\":[";
+    for (size_t i = 0; i < dataset.rows; i++) {
+        json += i == 0 ? "{" : ",{";
+        json += "\"id\":\"" + dataset.ids[i] + "\"";
+        appendColumnValues(json, rng, dataset.shape, i, true);
+        json += "}";
+    }
+    json += "],\"updated\":[],\"deleted\":[]}},\"timestamp\":1600000000000}";
+    return json;
+}
+
+Dataset makeDataset(const Shape &shape, size_t rows, const Options &options) {
+    Dataset dataset;
+    dataset.shape = shape;
+    dataset.rows = rows;
+    dataset.name = shape.name + "-" + humanCount(rows);
+
+    for (int i = 0; i < shape.textColumns; i++) {
+        dataset.columnNames.push_back("t" + std::to_string(i));
+    }
+    for (int i = 0; i < shape.numberColumns; i++) {
+        dataset.columnNames.push_back("n" + std::to_string(i));
+    }
+    for (int i = 0; i < shape.boolColumns; i++) {
+        dataset.columnNames.push_back("b" + std::to_string(i));
+    }
+
+    std::mt19937 rng(1337);
+    dataset.ids.reserve(rows);
+    for (size_t i = 0; i < rows; i++) {
+        dataset.ids.push_back(randomString(rng, 16));
+    }
+
+    if (options.inMemory) {
+        // NOTE: shared cache, so that fresh adapters see the same data
+        dataset.path = "file:watermelondb-bench-" + dataset.name + "?mode=memory&cache=shared";
+    } else {
+        dataset.path = (std::filesystem::temp_directory_path() / ("watermelondb-bench-" + dataset.name + ".db")).string();
+    }
+    return dataset;
+}
+
+void removeDatabaseFiles(const std::string &path) {
+    if (path.rfind("file:", 0) == 0) {
+        return;
+    }
+    for (auto suffix : { "", "-wal", "-shm" }) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+// MARK: - Harness
+
+class Harness {
+public:
+    Harness(jsi::Runtime &rt, const Options &options) : rt_(rt), options_(options) {
+    }
+
+    jsi::Object createAdapter(const Dataset &dataset) {
+        auto create = rt_.global().getPropertyAsFunction(rt_, "nativeWatermelonCreateAdapter");
+        jsi::Object adapter = create.call(rt_, jsi::String::createFromUtf8(rt_, dataset.path), false).getObject(rt_);
+        auto status = call(adapter, "initialize", jsi::String::createFromUtf8(rt_, dataset.name), 1).getObject(rt_);
+        auto code = status.getProperty(rt_, "code").getString(rt_).utf8(rt_);
+        if (code == "schema_needed") {
+            call(adapter, "setUpWithSchema", jsi::String::createFromUtf8(rt_, dataset.name),
+                 jsi::String::createFromUtf8(rt_, schemaSql(dataset)), 1);
+        } else if (code != "ok") {
+            throw std::runtime_error("Unexpected initialization status " + code);
+        }
+        return adapter;
+    }
+
+    void closeAdapter(jsi::Object &adapter) {
+        call(adapter, "unsafeClose");
+    }
+
+    template <typename... Args>
+    jsi::Value call(jsi::Object &adapter, const char *method, Args &&...args) {
+        return adapter.getPropertyAsFunction(rt_, method).call(rt_, std::forward<Args>(args)...);
+    }
+
+    template <typename Block>
+    double time(Block &&block) {
+        auto start = std::chrono::steady_clock::now();
+        block();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    jsi::Runtime &rt() {
+        return rt_;
+    }
+
+    const Options &options() {
+        return options_;
+    }
+
+private:
+    jsi::Runtime &rt_;
+    const Options &options_;
+};
+
+// MARK: - Benchmarks
+
+Result benchBatchJSON(Harness &harness, Dataset &dataset) {
+    const size_t batchSize = 1000;
+    removeDatabaseFiles(dataset.path);
+    auto adapter = harness.createAdapter(dataset);
+    auto batches = batchJsons(dataset, batchSize);
+
+    Result result = { dataset.name, "batchJSON", {}, dataset.rows, std::to_string(batchSize) + " creates/batch" };
+    for (auto &json : batches) {
+        auto &rt = harness.rt();
+        auto jsiJson = jsi::String::createFromUtf8(rt, json);
+        result.latencies.push_back(harness.time([&]() {
+            harness.call(adapter, "batchJSON", std::move(jsiJson));
+        }));
+    }
+    // NOTE: Adapter is kept open so that in-memory databases are not destroyed
+    return result;
+}
+
+Result benchFind(Harness &harness, Dataset &dataset) {
+    auto &rt = harness.rt();
+    auto adapter = harness.createAdapter(dataset);
+    std::mt19937 rng(7);
+    std::vector<std::string> ids = dataset.ids;
+    std::shuffle(ids.begin(), ids.end(), rng);
+
+    // NOTE: Each id is looked up once, because subsequent finds would only return a cached id
+    size_t samples = std::min(harness.options().samples * 10, ids.size());
+    Result result = { dataset.name, "find", {}, samples, "" };
+    auto table = jsi::String::createFromAscii(rt, tableName);
+    for (size_t i = 0; i < samples; i++) {
+        auto id = jsi::String::createFromUtf8(rt, ids[i]);
+        result.latencies.push_back(harness.time([&]() {
+            auto record = harness.call(adapter, "find", table, id);
+            if (!record.isObject()) {
+                throw std::runtime_error("find did not return a record");
+            }
+        }));
+    }
+    harness.closeAdapter(adapter);
+    return result;
+}
+
+Result benchQuery(Harness &harness, Dataset &dataset, const char *method) {
+    auto &rt = harness.rt();
+    std::mt19937 rng(7);
+    size_t limit = std::min(harness.options().queryLimit, dataset.rows);
+    std::uniform_int_distribution<size_t> startDist(0, dataset.rows - limit);
+
+    Result result = { dataset.name, method, {}, 0, std::to_string(limit) + " rows/query" };
+    auto table = jsi::String::createFromAscii(rt, tableName);
+    auto jsonParse = rt.global().getPropertyAsObject(rt, "JSON").getPropertyAsFunction(rt, "parse");
+    for (size_t i = 0; i < harness.options().samples; i++) {
+        // NOTE: Fresh adapter, so that records aren't returned as cached ids
+        auto adapter = harness.createAdapter(dataset);
+        size_t start = startDist(rng);
+        // NOTE: Values are inlined, just like encodeQuery does it
+        std::string sql = "select \"" + std::string(tableName) + "\".* from \"" + tableName + "\" where \"" + tableName +
+                          "\".\"n0\" >= " + std::to_string(start) + " and \"" + tableName + "\".\"n0\" < " +
+                          std::to_string(start + limit);
+        auto jsiSql = jsi::String::createFromUtf8(rt, sql);
+        auto args = jsi::Array(rt, 0);
+        size_t rows = 0;
+        bool isJson = std::string(method) == "queryAsJSON";
+        result.latencies.push_back(harness.time([&]() {
+            auto value = harness.call(adapter, method, table, jsiSql, args);
+            // NOTE: Parsing is part of the cost of the JSON format, so it's measured, too
+            if (isJson) {
+                value = jsonParse.call(rt, value);
+            }
+            rows = value.getObject(rt).getArray(rt).size(rt);
+        }));
+        // queryAsArray/queryAsJSON return column names as first element
+        result.rows += std::string(method) != "query" && rows ? rows - 1 : rows;
+        harness.closeAdapter(adapter);
+    }
+    return result;
+}
+
+// Unlike query, raw (and columnar) queries always return full records, so the same adapter (and prepared
+// statement) is reused for all samples
+Result benchRawQuery(Harness &harness, Dataset &dataset, const char *method) {
+    auto &rt = harness.rt();
+    auto adapter = harness.createAdapter(dataset);
+    std::mt19937 rng(7);
+    size_t limit = std::min(harness.options().queryLimit, dataset.rows);
+    std::uniform_int_distribution<size_t> startDist(0, dataset.rows - limit);
+
+    Result result = { dataset.name, method, {}, 0, std::to_string(limit) + " rows/query" };
+    std::string sql = "select * from \"" + std::string(tableName) + "\" where \"n0\" >= ? and \"n0\" < ?";
+    auto jsiSql = jsi::String::createFromUtf8(rt, sql);
+    for (size_t i = 0; i < harness.options().samples; i++) {
+        size_t start = startDist(rng);
+        auto args = jsi::Array::createWithElements(rt, (double) start, (double) (start + limit));
+        size_t rows = 0;
+        result.latencies.push_back(harness.time([&]() {
+            auto records = harness.call(adapter, method, jsiSql, args).getObject(rt);
+            rows = records.isArray(rt) ? records.getArray(rt).size(rt) : (size_t) records.getProperty(rt, "rowCount").getNumber();
+        }));
+        result.rows += rows;
+    }
+    harness.closeAdapter(adapter);
+    return result;
+}
+
+Result benchUnsafeLoadFromSync(Harness &harness, Dataset &dataset) {
+    auto &rt = harness.rt();
+    Result result = { dataset.name, "unsafeLoadFromSync", {}, 0, "" };
+    if (dataset.rows > harness.options().syncMaxRows) {
+        result.note = "skipped (--sync-max-rows)";
+        return result;
+    }
+
+    auto json = syncJson(dataset);
+    size_t samples = std::max<size_t>(1, std::min<size_t>(harness.options().samples, 5));
+    for (size_t i = 0; i < samples; i++) {
+        Dataset scratch = dataset;
+        scratch.name = dataset.name + "-sync";
+        scratch.path = dataset.path + (harness.options().inMemory ? "-sync" : ".sync.db");
+        removeDatabaseFiles(scratch.path);
+        auto adapter = harness.createAdapter(scratch);
+
+        // schema in the format expected by decodeTableSchema
+        jsi::Object columns(rt);
+        jsi::Array columnArray(rt, dataset.columnNames.size());
+        for (size_t c = 0; c < dataset.columnNames.size(); c++) {
+            auto &name = dataset.columnNames[c];
+            jsi::Object column(rt);
+            column.setProperty(rt, "name", jsi::String::createFromUtf8(rt, name));
+            column.setProperty(rt, "type", name[0] == 't' ? "string" : name[0] == 'n' ? "number" : "boolean");
+            columnArray.setValueAtIndex(rt, c, std::move(column));
+        }
+        columns.setProperty(rt, "columnArray", std::move(columnArray));
+        jsi::Object tables(rt);
+        tables.setProperty(rt, tableName, std::move(columns));
+        jsi::Object schema(rt);
+        schema.setProperty(rt, "tables", std::move(tables));
+
+        int jsonId = (int)i + 1;
+        platform::provideJson(jsonId, json);
+        result.latencies.push_back(harness.time([&]() {
+            harness.call(adapter, "unsafeLoadFromSync", jsonId, schema, jsi::String::createFromAscii(rt, ""),
+                         jsi::String::createFromAscii(rt, ""));
+        }));
+        result.rows += dataset.rows;
+        harness.closeAdapter(adapter);
+        removeDatabaseFiles(scratch.path);
+    }
+    return result;
+}
+
+// Compares rows/sec of inserting (or deleting) the same rows with statements of different numbers of rows.
+// Values are bound the same way regardless of the number of rows, so differences come from sqlite itself
+Result benchChunks(Harness &harness, Dataset &dataset, bool isDelete, size_t rowsPerStatement) {
+    auto &rt = harness.rt();
+    size_t rows = std::min(dataset.rows, harness.options().chunkMaxRows) / rowsPerStatement * rowsPerStatement;
+    Result result = { dataset.name, std::string(isDelete ? "deleteChunks" : "insertChunks") + "-" + std::to_string(rowsPerStatement),
+                      {}, 0, std::to_string(rowsPerStatement) + " rows/statement" };
+    if (rows == 0) {
+        result.note = "skipped (not enough rows)";
+        return result;
+    }
+
+    auto json = isDelete ? chunkedDeleteJson(dataset, rows, rowsPerStatement) : chunkedInsertJson(dataset, rows, rowsPerStatement);
+    auto setUpJson = isDelete ? chunkedInsertJson(dataset, rows, 1) : "";
+    size_t samples = std::max<size_t>(1, std::min<size_t>(harness.options().samples, 5));
+    for (size_t i = 0; i < samples; i++) {
+        Dataset scratch = dataset;
+        scratch.name = dataset.name + "-chunks";
+        scratch.path = dataset.path + (harness.options().inMemory ? "-chunks" : ".chunks.db");
+        removeDatabaseFiles(scratch.path);
+        auto adapter = harness.createAdapter(scratch);
+        if (isDelete) {
+            harness.call(adapter, "batchJSON", jsi::String::createFromUtf8(rt, setUpJson));
+        }
+
+        auto jsiJson = jsi::String::createFromUtf8(rt, json);
+        result.latencies.push_back(harness.time([&]() {
+            harness.call(adapter, "batchJSON", std::move(jsiJson));
+        }));
+        result.rows += rows;
+        harness.closeAdapter(adapter);
+        removeDatabaseFiles(scratch.path);
+    }
+    return result;
+}
+
+struct Benchmark {
+    const char *name;
+    std::function<Result(Harness &, Dataset &)> run;
+};
+
+std::vector<Benchmark> benchmarks() {
+    std::vector<Benchmark> benchmarks = {
+        // NOTE: batchJSON must be first, as it populates the dataset
+        { "batchJSON", benchBatchJSON },
+        { "find", benchFind },
+        { "query", [](Harness &h, Dataset &d) { return benchQuery(h, d, "query"); } },
+        { "queryAsArray", [](Harness &h, Dataset &d) { return benchQuery(h, d, "queryAsArray"); } },
+        { "queryAsJSON", [](Harness &h, Dataset &d) { return benchQuery(h, d, "queryAsJSON"); } },
+        { "unsafeQueryRaw", [](Harness &h, Dataset &d) { return benchRawQuery(h, d, "unsafeQueryRaw"); } },
+        { "unsafeQueryRawLazy", [](Harness &h, Dataset &d) { return benchRawQuery(h, d, "unsafeQueryRawLazy"); } },
+        { "queryColumnar", [](Harness &h, Dataset &d) { return benchRawQuery(h, d, "queryColumnar"); } },
+        { "unsafeLoadFromSync", benchUnsafeLoadFromSync },
+    };
+    for (size_t rowsPerStatement : { 1, 4, 16, 32, 64, 256 }) {
+        benchmarks.push_back({ "insertChunks", [rowsPerStatement](Harness &h, Dataset &d) {
+            return benchChunks(h, d, false, rowsPerStatement);
+        } });
+    }
+    for (size_t rowsPerStatement : { 1, 16, 64, 256 }) {
+        benchmarks.push_back({ "deleteChunks", [rowsPerStatement](Harness &h, Dataset &d) {
+            return benchChunks(h, d, true, rowsPerStatement);
+        } });
+    }
+    return benchmarks;
+}
+
+// MARK: - Reporting
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p * values.size());
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+void printHeader(const Options &options) {
+    if (options.csv) {
+        std::printf("dataset,method,samples,rows_per_sec,p50_ms,p99_ms,note\n");
+    } else {
+        std::printf("%-16s %-20s %8s %14s %10s %10s  %s\n", "dataset", "method", "samples", "rows/sec", "p50 ms",
+                    "p99 ms", "note");
+    }
+}
+
+void printResult(const Result &result, const Options &options) {
+    double total = 0;
+    for (auto latency : result.latencies) {
+        total += latency;
+    }
+    double rowsPerSec = total > 0 ? result.rows / (total / 1000) : 0;
+    double p50 = percentile(result.latencies, 0.5);
+    double p99 = percentile(result.latencies, 0.99);
+    if (options.csv) {
+        std::printf("%s,%s,%zu,%.0f,%.4f,%.4f,%s\n", result.dataset.c_str(), result.method.c_str(),
+                    result.latencies.size(), rowsPerSec, p50, p99, result.note.c_str());
+    } else {
+        std::printf("%-16s %-20s %8zu %14.0f %10.3f %10.3f  %s\n", result.dataset.c_str(), result.method.c_str(),
+                    result.latencies.size(), rowsPerSec, p50, p99, result.note.c_str());
+    }
+    std::fflush(stdout);
+}
+
+// MARK: - Main
+
+std::vector<std::string> split(const std::string &str) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= str.size()) {
+        size_t end = str.find(',', start);
+        if (end == std::string::npos) {
+            end = str.size();
+        }
+        if (end > start) {
+            parts.push_back(str.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return parts;
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        auto eq = arg.find('=');
+        auto key = arg.substr(0, eq);
+        auto value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--sizes") {
+            options.sizes = {};
+            for (auto const &size : split(value)) {
+                options.sizes.push_back(std::stoul(size));
+            }
+        } else if (key == "--shapes") {
+            options.shapes = split(value);
+        } else if (key == "--samples") {
+            options.samples = std::max<size_t>(1, std::stoul(value));
+        } else if (key == "--query-limit") {
+            options.queryLimit = std::max<size_t>(1, std::stoul(value));
+        } else if (key == "--sync-max-rows") {
+            options.syncMaxRows = std::stoul(value);
+        } else if (key == "--chunk-max-rows") {
+            options.chunkMaxRows = std::max<size_t>(1, std::stoul(value));
+        } else if (key == "--filter") {
+            options.filter = value;
+        } else if (key == "--memory") {
+            options.inMemory = true;
+        } else if (key == "--csv") {
+            options.csv = true;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+int run(int argc, char **argv) {
+    Options options = parseOptions(argc, argv);
+
+    auto runtime = hermes::makeHermesRuntime();
+    jsi::Runtime &rt = *runtime;
+    // NOTE: No CallInvoker, so async methods are executed synchronously
+    Database::install(&rt, nullptr);
+    Harness harness(rt, options);
+
+    printHeader(options);
+    for (auto const &shapeName : options.shapes) {
+        auto shape = shapeNamed(shapeName);
+        for (auto rows : options.sizes) {
+            auto dataset = makeDataset(shape, rows, options);
+            for (auto const &benchmark : benchmarks()) {
+                bool isSetup = std::string(benchmark.name) == "batchJSON";
+                bool isFilteredOut = std::string(benchmark.name).find(options.filter) == std::string::npos;
+                if (isFilteredOut && !isSetup) {
+                    continue;
+                }
+                auto result = benchmark.run(harness, dataset);
+                if (!isFilteredOut) {
+                    printResult(result, options);
+                }
+            }
+            // tear down adapters that still hold the dataset (e.g. batchJSON one)
+            platform::destroy();
+            removeDatabaseFiles(dataset.path);
+        }
+    }
+    return 0;
+}
+
+} // namespace benchmark
+} // namespace watermelondb
+
+int main(int argc, char **argv) {
+    try {
+        return watermelondb::benchmark::run(argc, argv);
+    } catch (const std::exception &ex) {
+        std::fprintf(stderr, "Benchmark failed: %s\n", ex.what());
+        return 1;
+    }
+}
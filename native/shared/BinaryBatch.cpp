@@ -0,0 +1,129 @@
+#include "BinaryBatch.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace watermelondb {
+
+static const uint32_t noString = 0xFFFFFFFF;
+
+enum BinaryArgTag : uint8_t { nullTag = 0, falseTag = 1, trueTag = 2, numberTag = 3, stringTag = 4 };
+
+static bool isLittleEndian() {
+    const uint16_t value = 1;
+    uint8_t firstByte;
+    std::memcpy(&firstByte, &value, 1);
+    return firstByte == 1;
+}
+
+BinaryBatchReader::BinaryBatchReader(const uint8_t *data, size_t size) : position_(data), end_(data + size) {
+    if (readU8() != formatVersion) {
+        throw std::invalid_argument("Unsupported binary batch format version");
+    }
+
+    uint32_t stringCount = readU32();
+    // NOTE: Each string takes at least 4 bytes, so this can't be used to allocate unbounded memory
+    if (stringCount > size / 4) {
+        throw std::invalid_argument("Malformed binary batch - invalid string count");
+    }
+    strings_.reserve(stringCount);
+    for (uint32_t i = 0; i < stringCount; i++) {
+        strings_.push_back(readString());
+    }
+
+    remainingOperations_ = readU32();
+}
+
+bool BinaryBatchReader::hasNextOperation() {
+    if (remainingOperations_ == 0 && position_ != end_) {
+        throw std::invalid_argument("Malformed binary batch - unexpected data after last operation");
+    }
+    return remainingOperations_ != 0;
+}
+
+BinaryBatchOperation BinaryBatchReader::nextOperation() {
+    remainingOperations_--;
+
+    BinaryBatchOperation operation;
+    operation.cacheBehavior = (int8_t) readU8();
+    uint32_t tableIndex = readU32();
+    operation.table = tableIndex == noString ? std::string_view() : stringAt(tableIndex);
+    operation.sql = stringAt(readU32());
+    operation.argsBatchCount = readU32();
+    return operation;
+}
+
+uint32_t BinaryBatchReader::nextArgsBatch() {
+    return readU32();
+}
+
+BinaryBatchArg BinaryBatchReader::nextArg() {
+    BinaryBatchArg arg = { BinaryArgType::null, 0, std::string_view() };
+    uint8_t tag = readU8();
+    switch (tag) {
+        case nullTag:
+            break;
+        case falseTag:
+        case trueTag:
+            arg.type = BinaryArgType::boolean;
+            arg.number = tag == trueTag ? 1 : 0;
+            break;
+        case numberTag:
+            arg.type = BinaryArgType::number;
+            arg.number = readF64();
+            break;
+        case stringTag:
+            arg.type = BinaryArgType::string;
+            arg.string = readString();
+            break;
+        default:
+            throw std::invalid_argument("Malformed binary batch - invalid argument tag");
+    }
+    return arg;
+}
+
+const uint8_t *BinaryBatchReader::read(size_t size) {
+    if ((size_t) (end_ - position_) < size) {
+        throw std::invalid_argument("Malformed binary batch - unexpected end of data");
+    }
+    auto data = position_;
+    position_ += size;
+    return data;
+}
+
+uint8_t BinaryBatchReader::readU8() {
+    return *read(1);
+}
+
+uint32_t BinaryBatchReader::readU32() {
+    auto data = read(4);
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+double BinaryBatchReader::readF64() {
+    auto data = read(8);
+    uint8_t bytes[8];
+    if (isLittleEndian()) {
+        std::memcpy(bytes, data, 8);
+    } else {
+        for (int i = 0; i < 8; i++) {
+            bytes[i] = data[7 - i];
+        }
+    }
+    double value;
+    std::memcpy(&value, bytes, 8);
+    return value;
+}
+
+std::string_view BinaryBatchReader::readString() {
+    uint32_t length = readU32();
+    return std::string_view((const char *) read(length), length);
+}
+
+std::string_view BinaryBatchReader::stringAt(uint32_t index) {
+    if (index >= strings_.size()) {
+        throw std::invalid_argument("Malformed binary batch - invalid string index");
+    }
+    return strings_[index];
+}
+
+} // namespace watermelondb
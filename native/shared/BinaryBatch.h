@@ -0,0 +1,61 @@
+#pragma once
+
+#import <cstddef>
+#import <cstdint>
+#import <string_view>
+#import <vector>
+
+namespace watermelondb {
+
+// Raw SQL batch operations encoded by encodeBinaryBatch (see src/adapters/sqlite/encodeBinaryBatch), which are
+// decoded in place - strings point into the encoded buffer, so it must outlive the reader and the
+// statements the strings were bound to. Layout (little-endian, unaligned):
+//   u8 format version
+//   u32 string count, then per string: u32 byte length, UTF-8 bytes (table names and SQL, deduplicated)
+//   u32 operation count, then per operation:
+//     i8 cache behavior, u32 table string index (or 0xFFFFFFFF), u32 SQL string index, u32 args batch count,
+//     then per args batch: u32 argument count, then per argument: u8 tag, value
+//   Argument tags: 0 - null, 1 - false, 2 - true, 3 - f64 number, 4 - string (u32 byte length, UTF-8 bytes)
+enum class BinaryArgType { null, boolean, number, string };
+
+struct BinaryBatchArg {
+    BinaryArgType type;
+    double number; // boolean is 0 or 1
+    std::string_view string;
+};
+
+struct BinaryBatchOperation {
+    int cacheBehavior;
+    std::string_view table;
+    std::string_view sql;
+    uint32_t argsBatchCount;
+};
+
+// NOTE: Operations, args batches and their arguments must be read in order, all of them. Throws
+// std::invalid_argument if the buffer is malformed
+class BinaryBatchReader {
+public:
+    static const uint8_t formatVersion = 1;
+
+    BinaryBatchReader(const uint8_t *data, size_t size);
+    bool hasNextOperation();
+    BinaryBatchOperation nextOperation();
+    // Returns argument count of the next args batch of current operation
+    uint32_t nextArgsBatch();
+    BinaryBatchArg nextArg();
+
+private:
+    const uint8_t *position_;
+    const uint8_t *end_;
+    std::vector<std::string_view> strings_;
+    uint32_t remainingOperations_ = 0;
+
+    const uint8_t *read(size_t size);
+    uint8_t readU8();
+    uint32_t readU32();
+    double readF64();
+    std::string_view readString();
+    std::string_view stringAt(uint32_t index);
+};
+
+} // namespace watermelondb
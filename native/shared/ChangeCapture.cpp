@@ -0,0 +1,201 @@
+#include "ChangeCapture.h"
+#include <algorithm>
+#include <cstring>
+
+namespace watermelondb {
+
+ChangeCapture::~ChangeCapture() {
+    detach();
+}
+
+void ChangeCapture::attach(sqlite3 *db) {
+    if (db_ == db) {
+        return;
+    }
+    detach();
+    db_ = db;
+    sqlite3_update_hook(db, updateHook, this);
+    sqlite3_commit_hook(db, commitHook, this);
+    sqlite3_rollback_hook(db, rollbackHook, this);
+}
+
+void ChangeCapture::detach() {
+    if (!db_) {
+        return;
+    }
+    sqlite3_update_hook(db_, nullptr, nullptr);
+    sqlite3_commit_hook(db_, nullptr, nullptr);
+    sqlite3_rollback_hook(db_, nullptr, nullptr);
+    db_ = nullptr;
+    pending_.clear();
+    pendingDeletedIds_.clear();
+    committed_.clear();
+    hasSavepoint_ = false;
+    undoLog_.clear();
+}
+
+bool ChangeCapture::isAttached() {
+    return db_ != nullptr;
+}
+
+void ChangeCapture::recordDeletedId(const std::string &table, const std::string &id) {
+    if (!db_) {
+        return;
+    }
+    auto ids = pendingDeletedIds_.try_emplace(table).first;
+    ids->second.push_back(id);
+    if (hasSavepoint_) {
+        undoLog_.push_back({ &ids->first, 0, std::nullopt, true });
+    }
+}
+
+void ChangeCapture::beginSavepoint() {
+    hasSavepoint_ = true;
+    undoLog_.clear();
+}
+
+void ChangeCapture::releaseSavepoint() {
+    hasSavepoint_ = false;
+    undoLog_.clear();
+}
+
+void ChangeCapture::rollbackToSavepoint() {
+    for (auto entry = undoLog_.rbegin(); entry != undoLog_.rend(); entry++) {
+        if (entry->isDeletedId) {
+            auto ids = pendingDeletedIds_.find(*entry->table);
+            ids->second.pop_back();
+            if (ids->second.empty()) {
+                pendingDeletedIds_.erase(ids);
+            }
+        } else if (entry->previous) {
+            pending_[*entry->table][entry->rowid] = *entry->previous;
+        } else {
+            pending_[*entry->table].erase(entry->rowid);
+        }
+    }
+    releaseSavepoint();
+}
+
+void ChangeCapture::setCollectsChanges(bool collectsChanges) {
+    collectsChanges_ = collectsChanges;
+    if (!collectsChanges) {
+        committed_.clear();
+    }
+}
+
+void ChangeCapture::setCommitListener(std::function<void(const ChangeSet &)> listener) {
+    commitListener_ = listener;
+}
+
+void ChangeCapture::setRowChangeListener(std::function<void(const std::string &, int64_t)> listener) {
+    rowChangeListener_ = listener;
+}
+
+std::vector<ChangeSet> ChangeCapture::drain() {
+    std::vector<ChangeSet> changes;
+    std::swap(changes, committed_);
+    return changes;
+}
+
+void ChangeCapture::recordChange(int operation, const char *table, int64_t rowid) {
+    if (std::strcmp(table, "local_storage") == 0) {
+        return;
+    }
+
+    auto rowsOfTable = pending_.find(table);
+    if (rowsOfTable == pending_.end()) {
+        rowsOfTable = pending_.emplace(table, std::unordered_map<int64_t, Change>()).first;
+    }
+    if (rowChangeListener_) {
+        rowChangeListener_(rowsOfTable->first, rowid);
+    }
+
+    auto &rows = rowsOfTable->second;
+    auto found = rows.find(rowid);
+    if (hasSavepoint_) {
+        auto previous = found == rows.end() ? std::nullopt : std::optional<Change>(found->second);
+        undoLog_.push_back({ &rowsOfTable->first, rowid, previous, false });
+    }
+    if (found == rows.end()) {
+        rows[rowid] = operation == SQLITE_INSERT ? Change::inserted :
+                      operation == SQLITE_DELETE ? Change::deleted : Change::updated;
+        return;
+    }
+
+    auto &change = found->second;
+    if (operation == SQLITE_INSERT) {
+        // NOTE: Row deleted and inserted again with the same rowid (e.g. `insert or replace`) was changed
+        change = change == Change::deleted ? Change::updated : Change::inserted;
+    } else if (operation == SQLITE_DELETE) {
+        if (change == Change::inserted) {
+            rows.erase(found);
+        } else {
+            change = Change::deleted;
+        }
+    } else if (change != Change::inserted) {
+        change = Change::updated;
+    }
+}
+
+void ChangeCapture::commit() {
+    hasSavepoint_ = false;
+    undoLog_.clear();
+    if (pending_.empty() && pendingDeletedIds_.empty()) {
+        return;
+    }
+
+    ChangeSet changeSet;
+    for (auto &table : pending_) {
+        if (table.second.empty()) {
+            continue;
+        }
+
+        auto &changes = changeSet[table.first];
+        for (auto const &row : table.second) {
+            auto &rowids = row.second == Change::inserted ? changes.inserted :
+                           row.second == Change::deleted ? changes.deleted : changes.updated;
+            rowids.push_back(row.first);
+        }
+        std::sort(changes.inserted.begin(), changes.inserted.end());
+        std::sort(changes.updated.begin(), changes.updated.end());
+        std::sort(changes.deleted.begin(), changes.deleted.end());
+    }
+    for (auto &table : pendingDeletedIds_) {
+        changeSet[table.first].deletedIds = std::move(table.second);
+    }
+
+    pending_.clear();
+    pendingDeletedIds_.clear();
+    if (changeSet.empty()) {
+        return;
+    }
+
+    if (commitListener_) {
+        commitListener_(changeSet);
+    }
+    if (collectsChanges_) {
+        committed_.push_back(std::move(changeSet));
+    }
+}
+
+void ChangeCapture::rollback() {
+    pending_.clear();
+    pendingDeletedIds_.clear();
+    hasSavepoint_ = false;
+    undoLog_.clear();
+}
+
+void ChangeCapture::updateHook(void *context, int operation, const char *, const char *table, sqlite3_int64 rowid) {
+    ((ChangeCapture *) context)->recordChange(operation, table, rowid);
+}
+
+int ChangeCapture::commitHook(void *context) {
+    ((ChangeCapture *) context)->commit();
+    return 0; // NOTE: non-zero would turn commit into a rollback
+}
+
+void ChangeCapture::rollbackHook(void *context) {
+    ((ChangeCapture *) context)->rollback();
+}
+
+} // namespace watermelondb
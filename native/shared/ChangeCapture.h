@@ -0,0 +1,92 @@
+#pragma once
+
+#import <cstdint>
+#import <functional>
+#import <map>
+#import <optional>
+#import <string>
+#import <unordered_map>
+#import <vector>
+#import <sqlite3.h>
+
+namespace watermelondb {
+
+// Rows of a table changed by a single transaction. Changes are coalesced, e.g. a row inserted and then updated
+// is only reported as inserted, and a row inserted and then deleted is not reported at all
+struct TableChanges {
+    std::vector<int64_t> inserted; // rowids
+    std::vector<int64_t> updated;
+    std::vector<int64_t> deleted;
+    // NOTE: Ids of deleted rows can't be read by sqlite hooks, so only ids of records deleted by batch
+    // (destroyPermanently) are known
+    std::vector<std::string> deletedIds;
+};
+
+// Changes made by a committed transaction (or a statement executed outside of one), by table name
+using ChangeSet = std::map<std::string, TableChanges>;
+
+// Collects rows changed on a connection, using sqlite3_update_hook. Changes are held until the transaction
+// is committed, and dropped if it's rolled back.
+// NOTE: ROLLBACK TO (savepoint) can't be observed by sqlite hooks, so changes rolled back that way are still
+// reported, unless the savepoint is marked with beginSavepoint(). Changes to tables without rowids (and to
+// local_storage), and rows deleted by sqlite's truncate optimization (`delete from table` without `where`)
+// are not captured
+class ChangeCapture {
+public:
+    ~ChangeCapture();
+
+    // Starts capturing changes on the connection. Must be called with the connection not in use
+    void attach(sqlite3 *db);
+    void detach();
+    bool isAttached();
+
+    // Records id of a record known to be deleted in the current transaction
+    void recordDeletedId(const std::string &table, const std::string &id);
+    // Must be called when a savepoint is set, released, or rolled back to, so that changes rolled back to the
+    // savepoint are forgotten. Savepoints can't be nested
+    void beginSavepoint();
+    void releaseSavepoint();
+    void rollbackToSavepoint();
+    // If enabled, committed changes are kept until drained
+    void setCollectsChanges(bool collectsChanges);
+    // Returns changes committed since the last call, in commit order
+    std::vector<ChangeSet> drain();
+    // Called with changes of every committed transaction. It's called from sqlite's commit hook, so it must
+    // not use the connection
+    void setCommitListener(std::function<void(const ChangeSet &)> listener);
+    // Called immediately when a row is changed (even if the transaction is later rolled back), e.g. to drop
+    // data cached for the row. It's called from sqlite's update hook, so it must not use the connection
+    void setRowChangeListener(std::function<void(const std::string &table, int64_t rowid)> listener);
+
+private:
+    enum class Change { inserted, updated, deleted };
+
+    // Change made since the savepoint, with previous change of the row (nullopt if it wasn't changed before),
+    // or a deleted id
+    struct UndoEntry {
+        const std::string *table;
+        int64_t rowid;
+        std::optional<Change> previous;
+        bool isDeletedId;
+    };
+
+    sqlite3 *db_ = nullptr;
+    std::unordered_map<std::string, std::unordered_map<int64_t, Change>> pending_;
+    std::unordered_map<std::string, std::vector<std::string>> pendingDeletedIds_;
+    std::vector<ChangeSet> committed_;
+    bool hasSavepoint_ = false;
+    std::vector<UndoEntry> undoLog_;
+    bool collectsChanges_ = false;
+    std::function<void(const ChangeSet &)> commitListener_;
+    std::function<void(const std::string &, int64_t)> rowChangeListener_;
+
+    void recordChange(int operation, const char *table, int64_t rowid);
+    void commit();
+    void rollback();
+
+    static void updateHook(void *context, int operation, const char *database, const char *table, sqlite3_int64 rowid);
+    static int commitHook(void *context);
+    static void rollbackHook(void *context);
+};
+
+} // namespace watermelondb
@@ -2,14 +2,52 @@
 #include "DatabasePlatform.h"
 #include "JSLockPerfHack.h"
 #include "simdjson.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace watermelondb {
 
 using platform::consoleError;
 using platform::consoleLog;
 
-Database::Database(jsi::Runtime *runtime, std::string path, bool usesExclusiveLocking) : runtime_(runtime), mutex_() {
+// NOTE: sqlite's default number of WAL pages after which commit checkpoints it
+static const int defaultWalAutocheckpoint = 1000;
+
+// Returns `pragma synchronous` level of the connection (0 = OFF, 1 = NORMAL, 2 = FULL, 3 = EXTRA)
+static int getSynchronous(sqlite3 *db) {
+    sqlite3_stmt *statement = nullptr;
+    int synchronous = 2;
+    if (sqlite3_prepare_v2(db, "pragma synchronous", -1, &statement, nullptr) == SQLITE_OK &&
+        sqlite3_step(statement) == SQLITE_ROW) {
+        synchronous = sqlite3_column_int(statement, 0);
+    }
+    sqlite3_finalize(statement);
+    return synchronous;
+}
+
+Database::Database(jsi::Runtime *runtime, std::string path, bool usesExclusiveLocking, std::shared_ptr<react::CallInvoker> jsCallInvoker)
+    : runtime_(runtime), mutex_(), jsCallInvoker_(jsCallInvoker), asyncQueue_("watermelondb") {
     db_ = std::make_unique<SqliteDb>(path);
+    statementCache_.setFinalizeListener([this](sqlite3_stmt *statement) {
+        // NOTE: Statement pointers can be reused by sqlite after they're finalized. Statements can be evicted on the
+        // async worker thread, but PropNameIDs may only be released on the JS thread, so shape is released later
+        auto found = resultShapes_.find(statement);
+        if (found != resultShapes_.end()) {
+            retiredResultShapes_.push_back(std::move(found->second));
+            resultShapes_.erase(found);
+        }
+    });
+    // NOTE: Called from sqlite's commit hook, i.e. with the database locked
+    changeCapture_.setCommitListener([this](const ChangeSet &changes) {
+        liveQueries_.markChanged(changes);
+        matchers_.markChanged(changes);
+        queryCache_.markChanged(changes);
+    });
+    // NOTE: Called from sqlite's update hook, i.e. with the database locked
+    changeCapture_.setRowChangeListener([this](const std::string &table, int64_t rowid) {
+        rowCache_.invalidate(table, rowid);
+    });
 
     // FIXME: On Android, Watermelon often errors out on large batches with an IO error, because it
     // can't find a temp store... I tried setting sqlite3_temp_directory to /tmp/something, but that
@@ -32,36 +70,56 @@ Database::Database(jsi::Runtime *runtime, std::string path, bool usesExclusiveLo
         // this seems to fix the headless JS service issue but breaks if you have multiple readers
         executeMultiple("pragma locking_mode = EXCLUSIVE;");
     }
+    // NOTE: Batches can be made less (or more) durable than that - see Durability
+    defaultSynchronous_ = getSynchronous(db_->sqlite);
+    defaultDurability_ = defaultSynchronous_ >= 2 ? Durability::full : Durability::normal;
+    durability_ = defaultDurability_;
+
+    // NOTE: Only async reads can run in parallel. In-memory databases are private to a connection, and exclusive
+    // locking mode doesn't allow other readers
+    bool isInMemory = path == "" || path == ":memory:" || path.find("mode=memory") != std::string::npos;
+    if (jsCallInvoker_ && !usesExclusiveLocking && !isInMemory) {
+        size_t readConnectionCount = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+        readPool_ = std::make_unique<ReadConnectionPool>(path, readConnectionCount);
+    }
+    // NOTE: Tables of queries are found on a separate connection, so the query cache needs one, too. Unlike
+    // readers, it only reads the schema, so it can also use a shared-cache in-memory database
+    if (!usesExclusiveLocking && path != "" && path != ":memory:") {
+        queryTables_ = std::make_unique<QueryTables>(path);
+    }
 }
 
 jsi::Runtime &Database::getRt() {
     return *runtime_;
 }
 
-jsi::JSError Database::dbError(std::string description) {
-    // TODO: In serialized threading mode, those may be incorrect - probably smarter to pass result codes around?
-    auto sqliteMessage = std::string(sqlite3_errmsg(db_->sqlite));
-    auto code = sqlite3_extended_errcode(db_->sqlite);
-    auto message = description + " - sqlite error " + std::to_string(code) + " (" + sqliteMessage + ")";
-    // Note: logging to console in case another exception is thrown so that the original error isn't lost
-    consoleError(message);
-
-    auto &rt = getRt();
-    return jsi::JSError(rt, message);
+DatabaseError Database::dbError(std::string description) {
+    return sqliteError(db_->sqlite, description);
 }
 
 void Database::destroy() {
+    // NOTE: Must be done before locking, since async work needs the lock to finish
+    asyncQueue_.destroy();
+    if (readPool_) {
+        readPool_->destroy();
+    }
     const std::lock_guard<std::mutex> lock(mutex_);
 
     if (isDestroyed_) {
         return;
     }
     isDestroyed_ = true;
-    for (auto const &cachedStatement : cachedStatements_) {
-        sqlite3_stmt *statement = cachedStatement.second;
-        sqlite3_finalize(statement);
+    statementCache_.clear();
+    if (queryTables_) {
+        queryTables_->destroy();
     }
-    cachedStatements_ = {};
+    for (auto const &prepared : preparedStatements_) {
+        sqlite3_finalize(prepared.second);
+    }
+    preparedStatements_ = {};
+    resultShapes_.clear();
+    retiredResultShapes_.clear();
+    changeCapture_.detach();
     db_->destroy();
 }
 
@@ -69,40 +127,98 @@ Database::~Database() {
     destroy();
 }
 
-std::string cacheKey(std::string tableName, std::string recordId) {
-    return tableName + "$" + recordId; // NOTE: safe as long as table names cannot contain $ sign
+bool Database::isCached(const std::string &tableName, std::string_view id) {
+    return cachedRecords_.contains(tableName, id);
+}
+void Database::markAsCached(const std::string &tableName, std::string_view id) {
+    cachedRecords_.insert(tableName, id);
+}
+void Database::removeFromCache(const std::string &tableName, std::string_view id) {
+    cachedRecords_.erase(tableName, id);
 }
 
-bool Database::isCached(std::string cacheKey) {
-    return cachedRecords_.find(cacheKey) != cachedRecords_.end();
+sqlite3_stmt* Database::prepareQuery(std::string sql, bool pinned) {
+    return statementCache_.prepare(db_->sqlite, sql, pinned);
 }
-void Database::markAsCached(std::string cacheKey) {
-    cachedRecords_.insert(cacheKey);
+
+StatementCacheStats Database::statementCacheStats() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto stats = statementCache_.stats();
+    if (readPool_) {
+        stats += readPool_->statementCacheStats();
+    }
+    return stats;
 }
-void Database::removeFromCache(std::string cacheKey) {
-    cachedRecords_.erase(cacheKey);
+
+size_t Database::evictCachedRecords(std::string tableName, std::vector<std::string> ids) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return cachedRecords_.evict(tableName, ids);
 }
 
-sqlite3_stmt* Database::prepareQuery(std::string sql) {
-    sqlite3_stmt *statement = cachedStatements_[sql];
+RecordCacheStats Database::recordCacheStats() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return cachedRecords_.stats();
+}
 
-    if (statement == nullptr) {
-        int resultPrepare = sqlite3_prepare_v2(db_->sqlite, sql.c_str(), -1, &statement, nullptr);
+void Database::configureRowCache(size_t maxCount, size_t maxMemory) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    rowCache_.setLimits(maxCount, maxMemory);
+    if (rowCache_.isEnabled()) {
+        // NOTE: Cached rows are invalidated by the update hook, so that changes not made by batch are noticed too
+        changeCapture_.attach(db_->sqlite);
+    }
+}
 
-        if (resultPrepare != SQLITE_OK) {
-            sqlite3_finalize(statement);
-            throw dbError("Failed to prepare query statement");
-        }
+RowCacheStats Database::rowCacheStats() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return rowCache_.stats();
+}
+
+void Database::configureQueryCache(size_t maxMemory) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    queryCache_.setMaxMemory(maxMemory);
+    usesQueryCache_ = queryCache_.isEnabled();
+    if (queryCache_.isEnabled()) {
+        // NOTE: Cached results are invalidated by the commit hook, so that changes not made by batch are noticed too
+        changeCapture_.attach(db_->sqlite);
+    }
+}
+
+void Database::configureWriteCoalescing(int windowMs) {
+    const std::lock_guard<std::mutex> lock(writeGroupMutex_);
+    writeCoalescingWindow_ = std::chrono::milliseconds(std::max(windowMs, 0));
+}
+
+QueryCacheStats Database::queryCacheStats() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return queryCache_.stats();
+}
 
-        cachedStatements_[sql] = statement;
+QueryResult Database::findWithRowCache(const std::string &tableName, const std::string &id) {
+    QueryResult result;
+    if (auto row = rowCache_.get(tableName, id)) {
+        result.columnNames = *row->columnNames;
+        result.values = row->values;
     } else {
-        // in theory, this shouldn't be necessary, since statements ought to be reset *after* use, not before use
-        // but still this might prevent some crashes if this is not done right
-        // TODO: Remove this later - should not be necessary, and it wastes time
-        sqlite3_reset(statement);
+        std::vector<SqliteValue> args = { id };
+        auto statement = SqliteStatement(prepareQuery("select rowid, * from `" + tableName + "` where id == ? limit 1"));
+        bindArgs(statement.stmt, args);
+
+        if (getNextRowOrTrue(statement.stmt)) {
+            return result;
+        }
+        int columnCount = sqlite3_column_count(statement.stmt);
+        for (int i = 1; i < columnCount; i++) {
+            result.columnNames.push_back(sqlite3_column_name(statement.stmt, i));
+            result.values.push_back(columnValue(statement.stmt, i));
+        }
+        rowCache_.put(tableName, id, sqlite3_column_int64(statement.stmt, 0), result.columnNames, result.values);
     }
-    assert(statement != nullptr);
-    return statement;
+    result.isCachedId.push_back(false);
+
+    markAsCached(tableName, id);
+    return result;
 }
 
 void Database::bindArgs(sqlite3_stmt *statement, jsi::Array &arguments) {
@@ -126,6 +242,9 @@ void Database::bindArgs(sqlite3_stmt *statement, jsi::Array &arguments) {
             bindResult = sqlite3_bind_double(statement, i + 1, value.getNumber());
         } else if (value.isBool()) {
             bindResult = sqlite3_bind_int(statement, i + 1, value.getBool());
+        } else if (value.isObject() && value.getObject(rt).isArray(rt)) {
+            jsi::Array array = value.getObject(rt).getArray(rt);
+            bindResult = bindArray(statement, i + 1, arrayArgFromJsi(rt, array));
         } else if (value.isObject()) {
             sqlite3_reset(statement);
             throw jsi::JSError(rt, "Invalid argument type (object) for query");
@@ -143,7 +262,6 @@ void Database::bindArgs(sqlite3_stmt *statement, jsi::Array &arguments) {
 
 std::string Database::bindArgsAndReturnId(sqlite3_stmt *statement, simdjson::ondemand::array &args) {
     using namespace simdjson;
-    auto &rt = getRt();
     std::string returnId = "";
 
     int argsCount = sqlite3_bind_parameter_count(statement);
@@ -165,7 +283,7 @@ std::string Database::bindArgsAndReturnId(sqlite3_stmt *statement, simdjson::ond
         } else if (type == ondemand::json_type::null) {
             bindResult = sqlite3_bind_null(statement, i + 1);
         } else {
-            throw jsi::JSError(rt, "Invalid argument type for query - only strings, numbers, booleans and null are allowed");
+            throw DatabaseError("Invalid argument type for query - only strings, numbers, booleans and null are allowed");
         }
 
         i++;
@@ -178,12 +296,41 @@ std::string Database::bindArgsAndReturnId(sqlite3_stmt *statement, simdjson::ond
 
     if (argsCount != i) {
         sqlite3_reset(statement);
-        throw jsi::JSError(rt, "Number of args passed to query doesn't match number of arg placeholders");
+        throw DatabaseError("Number of args passed to query doesn't match number of arg placeholders");
     }
 
     return returnId;
 }
 
+void Database::bindBinaryArgs(sqlite3_stmt *statement, BinaryBatchReader &reader) {
+    int argsCount = sqlite3_bind_parameter_count(statement);
+    uint32_t batchArgsCount = reader.nextArgsBatch();
+    for (uint32_t i = 0; i < batchArgsCount; i++) {
+        int bindResult;
+        auto arg = reader.nextArg();
+
+        if (arg.type == BinaryArgType::string) {
+            bindResult = sqlite3_bind_text(statement, i + 1, arg.string.data(), (int) arg.string.length(), SQLITE_STATIC);
+        } else if (arg.type == BinaryArgType::number) {
+            bindResult = sqlite3_bind_double(statement, i + 1, arg.number);
+        } else if (arg.type == BinaryArgType::boolean) {
+            bindResult = sqlite3_bind_int(statement, i + 1, (int) arg.number);
+        } else {
+            bindResult = sqlite3_bind_null(statement, i + 1);
+        }
+
+        if (bindResult != SQLITE_OK) {
+            sqlite3_reset(statement);
+            throw dbError("Failed to bind an argument for query");
+        }
+    }
+
+    if (argsCount != (int) batchArgsCount) {
+        sqlite3_reset(statement);
+        throw DatabaseError("Number of args passed to query doesn't match number of arg placeholders");
+    }
+}
+
 SqliteStatement Database::executeQuery(std::string sql, jsi::Array &arguments) {
     auto statement = prepareQuery(sql);
     bindArgs(statement, arguments);
@@ -198,15 +345,16 @@ void Database::executeUpdate(sqlite3_stmt *statement) {
     }
 }
 
-void Database::executeUpdate(std::string sql, jsi::Array &args) {
-    auto stmt = prepareQuery(sql);
+void Database::executeUpdate(std::string sql, jsi::Array &args, bool pinned) {
+    auto stmt = prepareQuery(sql, pinned);
     bindArgs(stmt, args);
     SqliteStatement statement(stmt);
     executeUpdate(stmt);
 }
 
 void Database::executeUpdate(std::string sql) {
-    auto stmt = prepareQuery(sql);
+    // NOTE: Only used for transactions and schema version
+    auto stmt = prepareQuery(sql, true);
     SqliteStatement statement(stmt);
     executeUpdate(stmt);
 }
@@ -215,7 +363,7 @@ void Database::getRow(sqlite3_stmt *stmt) {
     int result = sqlite3_step(stmt);
 
     if (result != SQLITE_ROW) {
-        throw dbError("Failed to get a row for query");
+        throw sqliteError(sqlite3_db_handle(stmt), "Failed to get a row for query");
     }
 }
 
@@ -225,14 +373,68 @@ bool Database::getNextRowOrTrue(sqlite3_stmt *stmt) {
     if (result == SQLITE_DONE) {
         return true;
     } else if (result != SQLITE_ROW) {
-        throw dbError("Failed to get a row for query");
+        throw sqliteError(sqlite3_db_handle(stmt), "Failed to get a row for query");
     }
 
     return false;
 }
 
+// Returns false for batch SQL whose changes are all noticed by the update hook. Raw SQL could also replace rows
+// (REPLACE conflict resolution), delete all rows of a table (truncate optimization), or change local storage,
+// none of which is noticed
+static bool mayChangeRowsUnnoticed(const std::string &sql) {
+    std::string lowercased;
+    lowercased.reserve(sql.size());
+    for (char c : sql) {
+        lowercased.push_back(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    auto start = lowercased.find_first_not_of(" \t\n");
+    if (start == std::string::npos) {
+        return false;
+    } else if (lowercased.find("replace") != std::string::npos || lowercased.find("local_storage") != std::string::npos) {
+        return true;
+    }
+    auto startsWith = [&](const char *keyword) {
+        return lowercased.compare(start, std::strlen(keyword), keyword) == 0;
+    };
+    if (startsWith("update ") || startsWith("insert ")) {
+        return false;
+    }
+    return !(startsWith("delete ") && lowercased.find(" where ") != std::string::npos);
+}
+
+// Returns true for `delete` SQL. Records removed from cache by batch are either deleted permanently, or only
+// marked as deleted (an update), and only ids of the former are deleted rows
+static bool isDeleteSql(const std::string &sql) {
+    auto start = sql.find_first_not_of(" \t\n");
+    if (start == std::string::npos || sql.size() - start < 6) {
+        return false;
+    }
+    for (size_t i = 0; i < 6; i++) {
+        char c = sql[start + i];
+        if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != "delete"[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Database::invalidateCachesAfterRawSql() {
+    rowCache_.clear();
+    queryCache_.clear();
+    localStorage_ = std::nullopt;
+    // NOTE: Tables changed by such SQL are not known, so all live queries could have changed, and rows of any
+    // table could have been deleted
+    liveQueries_.markAllDirty();
+    matchers_.markUnknownDeletions();
+}
+
 void Database::executeMultiple(std::string sql) {
-    auto &rt = getRt();
+    invalidateCachesAfterRawSql();
+    executeMultipleWithoutInvalidation(sql);
+}
+
+void Database::executeMultipleWithoutInvalidation(const std::string &sql) {
     char *errmsg = nullptr;
     int resultExec = sqlite3_exec(db_->sqlite, sql.c_str(), nullptr, nullptr, &errmsg);
 
@@ -241,7 +443,7 @@ void Database::executeMultiple(std::string sql) {
         // sqlite3_errmsg if needed...
         std::string message(errmsg);
         sqlite3_free(errmsg);
-        throw jsi::JSError(rt, message);
+        throw DatabaseError(message);
     }
 
     if (resultExec != SQLITE_OK) {
@@ -249,13 +451,52 @@ void Database::executeMultiple(std::string sql) {
     }
 }
 
-jsi::Object Database::resultDictionary(sqlite3_stmt *statement) {
+static bool hasColumnNames(sqlite3_stmt *statement, const std::vector<std::string> &columnNames) {
+    if ((size_t) sqlite3_column_count(statement) != columnNames.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        const char *column = sqlite3_column_name(statement, (int) i);
+        if (!column || columnNames[i] != column) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const ResultShape &Database::resultShape(sqlite3_stmt *statement) {
     auto &rt = getRt();
-    jsi::Object dictionary(rt);
+    retiredResultShapes_.clear();
+    int columnCount = sqlite3_column_count(statement);
+
+    // NOTE: Statement is re-prepared by sqlite after schema changes (e.g. a column renamed by raw SQL), so its
+    // columns may change, too, even if their count doesn't. Comparing names is cheap - sqlite returns them as is
+    auto found = resultShapes_.find(statement);
+    if (found != resultShapes_.end() && hasColumnNames(statement, found->second.sqlColumnNames)) {
+        return found->second;
+    }
 
-    for (int i = 0, len = sqlite3_column_count(statement); i < len; i++) {
+    ResultShape shape;
+    shape.sqlColumnNames.reserve(columnCount);
+    shape.columnNames.reserve(columnCount);
+    for (int i = 0; i < columnCount; i++) {
         const char *column = sqlite3_column_name(statement, i);
         assert(column);
+        shape.sqlColumnNames.emplace_back(column);
+        shape.columnNames.push_back(jsi::PropNameID::forUtf8(rt, column));
+    }
+
+    resultShapes_.erase(statement);
+    return resultShapes_.emplace(statement, std::move(shape)).first->second;
+}
+
+jsi::Object Database::resultDictionary(sqlite3_stmt *statement) {
+    auto &rt = getRt();
+    jsi::Object dictionary(rt);
+    auto &columns = resultShape(statement).columnNames;
+
+    for (int i = 0, len = (int) columns.size(); i < len; i++) {
+        auto &column = columns[i];
 
         auto type = sqlite3_column_type(statement, i);
         if (type == SQLITE_INTEGER) {
@@ -339,7 +580,18 @@ jsi::Array Database::arrayFromStd(std::vector<jsi::Value> &vector) {
     return array;
 }
 
-void Database::beginTransaction() {
+void Database::beginTransaction(std::optional<Durability> durability) {
+    if (isInWriteGroup_) {
+        // NOTE: If the group's transaction was rolled back (e.g. by an IO error), a savepoint would start a new one
+        if (sqlite3_get_autocommit(db_->sqlite)) {
+            throw DatabaseError("Transaction of coalesced writes was rolled back");
+        }
+        executeUpdate("savepoint watermelon_batch");
+        changeCapture_.beginSavepoint();
+        return;
+    }
+    // NOTE: Durability of writes in a group is decided by the group's transaction (see executeWriteGroup)
+    setDurability(durability.value_or(defaultDurability_));
     // NOTE: using exclusive transaction, because that's what FMDB does
     // In theory, `deferred` seems better, since it's less likely to get locked
     // OTOH, we don't really do multithreaded access, and when we *do*, we'd either
@@ -348,7 +600,18 @@ void Database::beginTransaction() {
 }
 
 void Database::commit() {
+    if (isInWriteGroup_) {
+        executeUpdate("release savepoint watermelon_batch");
+        changeCapture_.releaseSavepoint();
+        return;
+    }
     executeUpdate("commit transaction");
+    if (durability_ != defaultDurability_) {
+        if (durability_ == Durability::deferred) {
+            scheduleCheckpoint();
+        }
+        setDurability(defaultDurability_);
+    }
 }
 
 void Database::rollback() {
@@ -363,7 +626,15 @@ void Database::rollback() {
     // https://sqlite.org/lang_transaction.html recommends that we roll back anyway, since an error is
     // harmless.
     try {
+        if (isInWriteGroup_) {
+            // NOTE: Only this batch is rolled back, other writes of the group are not affected
+            changeCapture_.rollbackToSavepoint();
+            executeUpdate("rollback transaction to savepoint watermelon_batch");
+            executeUpdate("release savepoint watermelon_batch");
+            return;
+        }
         executeUpdate("rollback transaction");
+        setDurability(defaultDurability_);
     } catch (const std::exception &ex) {
         std::string errorMessage = "Error while attempting to roll back transaction, probably harmless: ";
         errorMessage += ex.what();
@@ -371,6 +642,33 @@ void Database::rollback() {
     }
 }
 
+void Database::setDurability(Durability durability) {
+    if (durability == durability_) {
+        return;
+    }
+
+    // NOTE: This is cheap (no IO), but can't be done inside a transaction
+    auto synchronousOf = [this](Durability level) {
+        return level == defaultDurability_ ? defaultSynchronous_ : level == Durability::full ? 2 : 1;
+    };
+    int synchronous = synchronousOf(durability);
+    if (synchronous != synchronousOf(durability_)) {
+        // NOTE: Not using executeMultiple, as it would needlessly invalidate caches (twice per batch)
+        auto sql = "pragma synchronous = " + std::to_string(synchronous);
+        if (sqlite3_exec(db_->sqlite, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+            throw dbError("Failed to set durability of a transaction");
+        }
+    }
+
+    // NOTE: Without async JSI, there's no worker to checkpoint WAL later, so deferred commits are the same as normal
+    bool defersCheckpoint = durability == Durability::deferred && jsCallInvoker_;
+    bool deferredCheckpoint = durability_ == Durability::deferred && jsCallInvoker_;
+    if (defersCheckpoint != deferredCheckpoint) {
+        sqlite3_wal_autocheckpoint(db_->sqlite, defersCheckpoint ? 0 : defaultWalAutocheckpoint);
+    }
+    durability_ = durability;
+}
+
 int Database::getUserVersion() {
     auto &rt = getRt();
     auto args = jsi::Array::createWithElements(rt);
@@ -393,9 +691,15 @@ jsi::Value Database::find(jsi::String &tableName, jsi::String &id) {
     auto &rt = getRt();
     const std::lock_guard<std::mutex> lock(mutex_);
 
-    if (isCached(cacheKey(tableName.utf8(rt), id.utf8(rt)))) {
+    auto table = tableName.utf8(rt);
+    auto idString = id.utf8(rt);
+    if (isCached(table, idString)) {
         return std::move(id);
     }
+    if (rowCache_.isEnabled()) {
+        auto result = findWithRowCache(table, idString);
+        return findResultToJsi(rt, result);
+    }
 
     auto args = jsi::Array::createWithElements(rt, id);
     auto statement = executeQuery("select * from `" + tableName.utf8(rt) + "` where id == ? limit 1", args);
@@ -406,36 +710,202 @@ jsi::Value Database::find(jsi::String &tableName, jsi::String &id) {
 
     auto record = resultDictionary(statement.stmt);
 
-    markAsCached(cacheKey(tableName.utf8(rt), id.utf8(rt)));
+    markAsCached(table, idString);
 
     return record;
 }
 
+std::vector<FoundRecords> Database::findMany(const std::vector<FindRequest> &requests) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<FoundRecords> results;
+    results.reserve(requests.size());
+    for (auto const &request : requests) {
+        results.push_back(findManyInTable(request.first, request.second));
+    }
+    return results;
+}
+
+FoundRecords Database::findManyInTable(const std::string &tableName, const std::vector<std::string> &ids) {
+    FoundRecords found;
+    auto &rows = found.rows;
+    found.rowIndexes.assign(ids.size(), -1);
+
+    auto addCachedId = [&](size_t position, const std::string &id) {
+        found.rowIndexes[position] = (int) rows.isCachedId.size();
+        rows.values.push_back(id);
+        rows.isCachedId.push_back(true);
+    };
+
+    // NOTE: Same as calling find for each id in order - if an id is requested more than once, the record is only
+    // sent in full the first time
+    std::unordered_map<std::string_view, std::vector<size_t>> missingPositions;
+    auto missingIds = std::make_shared<SqliteValueArray>();
+    for (size_t i = 0; i < ids.size(); i++) {
+        auto &id = ids[i];
+        auto missing = missingPositions.find(id);
+        if (missing != missingPositions.end()) {
+            missing->second.push_back(i);
+        } else if (isCached(tableName, id)) {
+            addCachedId(i, id);
+        } else if (auto row = rowCache_.get(tableName, id)) {
+            if (rows.columnNames.empty()) {
+                rows.columnNames = *row->columnNames;
+            }
+            found.rowIndexes[i] = (int) rows.isCachedId.size();
+            rows.values.insert(rows.values.end(), row->values.begin(), row->values.end());
+            rows.isCachedId.push_back(false);
+            markAsCached(tableName, id);
+        } else {
+            missingPositions[id].push_back(i);
+            missingIds->values.push_back(id);
+        }
+    }
+
+    if (missingIds->values.empty()) {
+        return found;
+    }
+
+    std::vector<SqliteValue> args = { missingIds };
+    auto statement = SqliteStatement(prepareQuery("select rowid, * from `" + tableName + "` where id in watermelon_array(?)"));
+    bindArgs(statement.stmt, args);
+
+    int columnCount = sqlite3_column_count(statement.stmt);
+    int idColumn = -1;
+    for (int i = 1; i < columnCount; i++) {
+        if (std::string_view(sqlite3_column_name(statement.stmt, i)) == "id") {
+            idColumn = i;
+        }
+    }
+    if (idColumn == -1) {
+        throw std::invalid_argument("Table " + tableName + " has no id column");
+    }
+    if (rows.columnNames.empty()) {
+        for (int i = 1; i < columnCount; i++) {
+            rows.columnNames.push_back(sqlite3_column_name(statement.stmt, i));
+        }
+    }
+
+    while (!getNextRowOrTrue(statement.stmt)) {
+        std::vector<SqliteValue> values;
+        values.reserve(columnCount - 1);
+        for (int i = 1; i < columnCount; i++) {
+            values.push_back(columnValue(statement.stmt, i));
+        }
+
+        auto rowId = std::get_if<std::string>(&values[idColumn - 1]);
+        auto missing = rowId ? missingPositions.find(*rowId) : missingPositions.end();
+        if (missing == missingPositions.end()) {
+            continue;
+        }
+        auto &positions = missing->second;
+        auto &id = ids[positions[0]];
+        found.rowIndexes[positions[0]] = (int) rows.isCachedId.size();
+        rows.values.insert(rows.values.end(), values.begin(), values.end());
+        rows.isCachedId.push_back(false);
+        for (size_t i = 1; i < positions.size(); i++) {
+            addCachedId(positions[i], id);
+        }
+
+        rowCache_.put(tableName, id, sqlite3_column_int64(statement.stmt, 0), rows.columnNames, std::move(values));
+        markAsCached(tableName, id);
+        missingPositions.erase(missing);
+    }
+
+    return found;
+}
+
 jsi::Value Database::query(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sql.utf8(rt), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false);
+    }
+
+    auto statement = executeQuery(sql.utf8(rt), arguments);
+    return queryResult(tableName.utf8(rt), statement.stmt);
+}
+
+jsi::Value Database::queryAsArray(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sql.utf8(rt), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, true);
+    }
+
+    auto statement = executeQuery(sql.utf8(rt), arguments);
+    return queryAsArrayResult(tableName.utf8(rt), statement.stmt);
+}
+
+jsi::Array Database::queryIds(jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        ReadQuery query = { ReadQueryKind::ids, "", sql.utf8(rt), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false).getObject(rt).getArray(rt);
+    }
+
+    auto statement = executeQuery(sql.utf8(rt), arguments);
+    return queryIdsResult(statement.stmt);
+}
+
+jsi::Array Database::unsafeQueryRaw(jsi::String &sql, jsi::Array &arguments) {
     auto &rt = getRt();
     const std::lock_guard<std::mutex> lock(mutex_);
 
     auto statement = executeQuery(sql.utf8(rt), arguments);
+    return unsafeQueryRawResult(statement.stmt);
+}
+
+jsi::Array Database::unsafeQueryRawLazy(jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto statement = executeQuery(sql.utf8(rt), arguments);
+    auto rows = readLazyRows(statement.stmt);
+    return lazyRowsToJsi(rt, rows);
+}
+
+jsi::Value Database::count(jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        ReadQuery query = { ReadQueryKind::count, "", sql.utf8(rt), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false);
+    }
+
+    auto statement = executeQuery(sql.utf8(rt), arguments);
+    return countResult(statement.stmt);
+}
+
+jsi::Value Database::queryResult(std::string tableName, sqlite3_stmt *statement) {
+    auto &rt = getRt();
     std::vector<jsi::Value> records = {};
+    auto &cachedIds = cachedRecords_.table(tableName);
 
     while (true) {
-        if (getNextRowOrTrue(statement.stmt)) {
+        if (getNextRowOrTrue(statement)) {
             break;
         }
 
-        assert(std::string(sqlite3_column_name(statement.stmt, 0)) == "id");
+        assert(std::string(sqlite3_column_name(statement, 0)) == "id");
 
-        const char *id = (const char *)sqlite3_column_text(statement.stmt, 0);
+        const char *id = (const char *)sqlite3_column_text(statement, 0);
         if (!id) {
             throw jsi::JSError(rt, "Failed to get ID of a record");
         }
 
-        if (isCached(cacheKey(tableName.utf8(rt), std::string(id)))) {
+        if (!cachedIds.insert(id)) {
             jsi::String jsiId = jsi::String::createFromAscii(rt, id);
             records.push_back(std::move(jsiId));
         } else {
-            markAsCached(cacheKey(tableName.utf8(rt), std::string(id)));
-            jsi::Object record = resultDictionary(statement.stmt);
+            jsi::Object record = resultDictionary(statement);
             records.push_back(std::move(record));
         }
     }
@@ -443,36 +913,33 @@ jsi::Value Database::query(jsi::String &tableName, jsi::String &sql, jsi::Array
     return arrayFromStd(records);
 }
 
-jsi::Value Database::queryAsArray(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments) {
+jsi::Value Database::queryAsArrayResult(std::string tableName, sqlite3_stmt *statement) {
     auto &rt = getRt();
-    const std::lock_guard<std::mutex> lock(mutex_);
-
-    auto statement = executeQuery(sql.utf8(rt), arguments);
     std::vector<jsi::Value> results = {};
+    auto &cachedIds = cachedRecords_.table(tableName);
 
     while (true) {
-        if (getNextRowOrTrue(statement.stmt)) {
+        if (getNextRowOrTrue(statement)) {
             break;
         }
 
-        assert(std::string(sqlite3_column_name(statement.stmt, 0)) == "id");
+        assert(std::string(sqlite3_column_name(statement, 0)) == "id");
 
-        const char *id = (const char *)sqlite3_column_text(statement.stmt, 0);
+        const char *id = (const char *)sqlite3_column_text(statement, 0);
         if (!id) {
             throw jsi::JSError(rt, "Failed to get ID of a record");
         }
 
         if (results.size() == 0) {
-            jsi::Array columns = resultColumns(statement.stmt);
+            jsi::Array columns = resultColumns(statement);
             results.push_back(std::move(columns));
         }
 
-        if (isCached(cacheKey(tableName.utf8(rt), std::string(id)))) {
+        if (!cachedIds.insert(id)) {
             jsi::String jsiId = jsi::String::createFromAscii(rt, id);
             results.push_back(std::move(jsiId));
         } else {
-            markAsCached(cacheKey(tableName.utf8(rt), std::string(id)));
-            jsi::Array record = resultArray(statement.stmt);
+            jsi::Array record = resultArray(statement);
             results.push_back(std::move(record));
         }
     }
@@ -480,21 +947,18 @@ jsi::Value Database::queryAsArray(jsi::String &tableName, jsi::String &sql, jsi:
     return arrayFromStd(results);
 }
 
-jsi::Array Database::queryIds(jsi::String &sql, jsi::Array &arguments) {
+jsi::Array Database::queryIdsResult(sqlite3_stmt *statement) {
     auto &rt = getRt();
-    const std::lock_guard<std::mutex> lock(mutex_);
-
-    auto statement = executeQuery(sql.utf8(rt), arguments);
     std::vector<jsi::Value> ids = {};
 
     while (true) {
-        if (getNextRowOrTrue(statement.stmt)) {
+        if (getNextRowOrTrue(statement)) {
             break;
         }
 
-        assert(std::string(sqlite3_column_name(statement.stmt, 0)) == "id");
+        assert(std::string(sqlite3_column_name(statement, 0)) == "id");
 
-        const char *idText = (const char *)sqlite3_column_text(statement.stmt, 0);
+        const char *idText = (const char *)sqlite3_column_text(statement, 0);
         if (!idText) {
             throw jsi::JSError(rt, "Failed to get ID of a record");
         }
@@ -506,35 +970,168 @@ jsi::Array Database::queryIds(jsi::String &sql, jsi::Array &arguments) {
     return arrayFromStd(ids);
 }
 
-jsi::Array Database::unsafeQueryRaw(jsi::String &sql, jsi::Array &arguments) {
-    auto &rt = getRt();
-    const std::lock_guard<std::mutex> lock(mutex_);
-
-    auto statement = executeQuery(sql.utf8(rt), arguments);
+jsi::Array Database::unsafeQueryRawResult(sqlite3_stmt *statement) {
     std::vector<jsi::Value> raws = {};
 
     while (true) {
-        if (getNextRowOrTrue(statement.stmt)) {
+        if (getNextRowOrTrue(statement)) {
             break;
         }
 
-        jsi::Object raw = resultDictionary(statement.stmt);
+        jsi::Object raw = resultDictionary(statement);
         raws.push_back(std::move(raw));
     }
 
     return arrayFromStd(raws);
 }
 
-jsi::Value Database::count(jsi::String &sql, jsi::Array &arguments) {
+std::vector<std::shared_ptr<LazyRow>> Database::readLazyRows(sqlite3_stmt *statement) {
+    std::vector<std::shared_ptr<LazyRow>> rows = {};
+    std::shared_ptr<LazyRowColumns> columns;
+
+    while (true) {
+        if (getNextRowOrTrue(statement)) {
+            break;
+        }
+
+        if (!columns) {
+            columns = std::make_shared<LazyRowColumns>();
+            for (int i = 0, len = sqlite3_column_count(statement); i < len; i++) {
+                const char *column = sqlite3_column_name(statement, i);
+                assert(column);
+                columns->names.push_back(column);
+                columns->indexes[column] = i;
+            }
+        }
+
+        rows.push_back(std::make_shared<LazyRow>(columns, statement));
+    }
+
+    return rows;
+}
+
+jsi::Array Database::lazyRowsToJsi(jsi::Runtime &rt, std::vector<std::shared_ptr<LazyRow>> &rows) {
+    jsi::Array array(rt, rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        array.setValueAtIndex(rt, i, jsi::Object::createFromHostObject(rt, rows[i]));
+    }
+    return array;
+}
+
+jsi::Value Database::countResult(sqlite3_stmt *statement) {
+    getRow(statement);
+
+    assert(sqlite3_data_count(statement) == 1);
+    int count = sqlite3_column_int(statement, 0);
+    return jsi::Value(count);
+}
+
+// MARK: - Prepared queries
+
+int Database::prepare(jsi::String &sql) {
     auto &rt = getRt();
     const std::lock_guard<std::mutex> lock(mutex_);
 
-    auto statement = executeQuery(sql.utf8(rt), arguments);
-    getRow(statement.stmt);
+    // NOTE: Not using statement cache, because prepared statements must stay alive until released
+    sqlite3_stmt *statement = nullptr;
+    auto sqlString = sql.utf8(rt);
+    if (sqlite3_prepare_v2(db_->sqlite, sqlString.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(statement);
+        throw dbError("Failed to prepare query statement");
+    }
 
-    assert(sqlite3_data_count(statement.stmt) == 1);
-    int count = sqlite3_column_int(statement.stmt, 0);
-    return jsi::Value(count);
+    int handle = nextPreparedStatementHandle_++;
+    preparedStatements_[handle] = statement;
+    return handle;
+}
+
+void Database::release(int handle) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto found = preparedStatements_.find(handle);
+    if (found == preparedStatements_.end()) {
+        return;
+    }
+    resultShapes_.erase(found->second);
+    sqlite3_finalize(found->second);
+    preparedStatements_.erase(found);
+}
+
+sqlite3_stmt *Database::preparedStatement(int handle) {
+    auto found = preparedStatements_.find(handle);
+    if (found == preparedStatements_.end()) {
+        throw jsi::JSError(getRt(), "Prepared query " + std::to_string(handle) + " does not exist (or was released)");
+    }
+    return found->second;
+}
+
+SqliteStatement Database::executePrepared(int handle, jsi::Array &arguments) {
+    auto statement = preparedStatement(handle);
+    bindArgs(statement, arguments);
+    return SqliteStatement(statement);
+}
+
+jsi::Value Database::executeQuery(int handle, jsi::String &tableName, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        auto statement = preparedStatement(handle);
+        ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sqlite3_sql(statement), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false, statement);
+    }
+
+    auto statement = executePrepared(handle, arguments);
+    return queryResult(tableName.utf8(rt), statement.stmt);
+}
+
+jsi::Value Database::executeQueryAsArray(int handle, jsi::String &tableName, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        auto statement = preparedStatement(handle);
+        ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sqlite3_sql(statement), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, true, statement);
+    }
+
+    auto statement = executePrepared(handle, arguments);
+    return queryAsArrayResult(tableName.utf8(rt), statement.stmt);
+}
+
+jsi::Array Database::executeQueryIds(int handle, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        auto statement = preparedStatement(handle);
+        ReadQuery query = { ReadQueryKind::ids, "", sqlite3_sql(statement), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false, statement).getObject(rt).getArray(rt);
+    }
+
+    auto statement = executePrepared(handle, arguments);
+    return queryIdsResult(statement.stmt);
+}
+
+jsi::Array Database::executeUnsafeQueryRaw(int handle, jsi::Array &arguments) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto statement = executePrepared(handle, arguments);
+    return unsafeQueryRawResult(statement.stmt);
+}
+
+jsi::Value Database::executeCount(int handle, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (usesQueryCache_) {
+        auto statement = preparedStatement(handle);
+        ReadQuery query = { ReadQueryKind::count, "", sqlite3_sql(statement), argsFromJsi(rt, arguments) };
+        return cachedReadQueryToJsi(lock, query, false, statement);
+    }
+
+    auto statement = executePrepared(handle, arguments);
+    return countResult(statement.stmt);
 }
 
 // TODO: Remove non-json batch once we can tell that there's no serious perf regression
@@ -543,8 +1140,8 @@ void Database::batch(jsi::Array &operations) {
     const std::lock_guard<std::mutex> lock(mutex_);
     beginTransaction();
 
-    std::vector<std::string> addedIds = {};
-    std::vector<std::string> removedIds = {};
+    std::vector<std::pair<std::string, std::string>> addedIds = {};
+    std::vector<std::pair<std::string, std::string>> removedIds = {};
 
     try {
         size_t operationsCount = operations.length(rt);
@@ -554,18 +1151,26 @@ void Database::batch(jsi::Array &operations) {
             auto cacheBehavior = operation.getValueAtIndex(rt, 0).getNumber();
             auto table = cacheBehavior != 0 ? operation.getValueAtIndex(rt, 1).getString(rt).utf8(rt) : "";
             auto sql = operation.getValueAtIndex(rt, 2).getString(rt).utf8(rt);
+            if (cacheBehavior == 0 && mayChangeRowsUnnoticed(sql)) {
+                invalidateCachesAfterRawSql();
+            }
 
+            bool deletesRows = cacheBehavior == -1 && isDeleteSql(sql);
             jsi::Array argsBatches = operation.getValueAtIndex(rt, 3).getObject(rt).getArray(rt);
             size_t argsBatchesCount = argsBatches.length(rt);
             for (size_t j = 0; j < argsBatchesCount; j++) {
                 jsi::Array args = argsBatches.getValueAtIndex(rt, j).getObject(rt).getArray(rt);
-                executeUpdate(sql, args);
+                // NOTE: Only record operations use a fixed set of statements - raw SQL must be evictable
+                executeUpdate(sql, args, cacheBehavior != 0);
                 if (cacheBehavior != 0) {
                     auto id = args.getValueAtIndex(rt, 0).getString(rt).utf8(rt);
                     if (cacheBehavior == 1) {
-                        addedIds.push_back(cacheKey(table, id));
+                        addedIds.emplace_back(table, id);
                     } else if (cacheBehavior == -1) {
-                        removedIds.push_back(cacheKey(table, id));
+                        removedIds.emplace_back(table, id);
+                        if (deletesRows) {
+                            changeCapture_.recordDeletedId(table, id);
+                        }
                     }
                 }
             }
@@ -577,28 +1182,32 @@ void Database::batch(jsi::Array &operations) {
         throw;
     }
 
-    for (auto const &key : addedIds) {
-        markAsCached(key);
+    for (auto const &record : addedIds) {
+        markAsCached(record.first, record.second);
     }
 
-    for (auto const &key : removedIds) {
-        removeFromCache(key);
+    for (auto const &record : removedIds) {
+        removeFromCache(record.first, record.second);
     }
 }
 
 void Database::batchJSON(jsi::String &&jsiJson) {
-    using namespace simdjson;
-
     auto &rt = getRt();
+    auto json = simdjson::padded_string(jsiJson.utf8(rt));
     const std::lock_guard<std::mutex> lock(mutex_);
+    executeBatchJSON(json);
+}
+
+void Database::executeBatchJSON(simdjson::padded_string &json) {
+    using namespace simdjson;
+
     beginTransaction();
 
-    std::vector<std::string> addedIds = {};
-    std::vector<std::string> removedIds = {};
+    std::vector<std::pair<std::string, std::string>> addedIds = {};
+    std::vector<std::pair<std::string, std::string>> removedIds = {};
 
     try {
         ondemand::parser parser;
-        auto json = padded_string(jsiJson.utf8(rt));
         ondemand::document doc = parser.iterate(json);
 
         // NOTE: simdjson::ondemand processes forwards-only, hence the weird field enumeration
@@ -617,10 +1226,15 @@ void Database::batchJSON(jsi::String &&jsiJson) {
                     }
                 } else if (fieldIdx == 2) {
                     sql = (std::string_view) field;
+                    if (cacheBehavior == 0 && mayChangeRowsUnnoticed(sql)) {
+                        invalidateCachesAfterRawSql();
+                    }
                 } else if (fieldIdx == 3) {
                     ondemand::array argsBatches = field;
-                    auto stmt = prepareQuery(sql);
+                    // NOTE: Only record operations use a fixed set of statements - raw SQL must be evictable
+                    auto stmt = prepareQuery(sql, cacheBehavior != 0);
                     SqliteStatement statement(stmt);
+                    bool deletesRows = cacheBehavior == -1 && isDeleteSql(sql);
 
                     for (ondemand::array args : argsBatches) {
                         // NOTE: We must capture the ID once first parsed
@@ -628,9 +1242,12 @@ void Database::batchJSON(jsi::String &&jsiJson) {
                         executeUpdate(stmt);
                         sqlite3_reset(stmt);
                         if (cacheBehavior == 1) {
-                            addedIds.push_back(cacheKey(table, id));
+                            addedIds.emplace_back(table, id);
                         } else if (cacheBehavior == -1) {
-                            removedIds.push_back(cacheKey(table, id));
+                            removedIds.emplace_back(table, id);
+                            if (deletesRows) {
+                                changeCapture_.recordDeletedId(table, id);
+                            }
                         }
                     }
                 }
@@ -644,12 +1261,51 @@ void Database::batchJSON(jsi::String &&jsiJson) {
         throw;
     }
 
-    for (auto const &key : addedIds) {
-        markAsCached(key);
+    for (auto const &record : addedIds) {
+        markAsCached(record.first, record.second);
     }
 
-    for (auto const &key : removedIds) {
-        removeFromCache(key);
+    for (auto const &record : removedIds) {
+        removeFromCache(record.first, record.second);
+    }
+}
+
+void Database::batchBinary(const uint8_t *data, size_t size) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    executeBatchBinary(data, size);
+}
+
+void Database::executeBatchBinary(const uint8_t *data, size_t size) {
+    beginTransaction();
+
+    try {
+        BinaryBatchReader reader(data, size);
+        while (reader.hasNextOperation()) {
+            auto operation = reader.nextOperation();
+            if (operation.cacheBehavior != 0) {
+                throw std::invalid_argument("Binary batch only supports raw SQL operations - use batchRecords");
+            }
+            auto sql = std::string(operation.sql);
+            if (mayChangeRowsUnnoticed(sql)) {
+                invalidateCachesAfterRawSql();
+            }
+
+            // NOTE: Raw SQL must be evictable, so statements are not pinned
+            auto stmt = prepareQuery(sql);
+            SqliteStatement statement(stmt);
+
+            for (uint32_t i = 0; i < operation.argsBatchCount; i++) {
+                // NOTE: Strings are bound without copying, so the buffer must live until the statement is reset
+                bindBinaryArgs(stmt, reader);
+                executeUpdate(stmt);
+                sqlite3_reset(stmt);
+            }
+        }
+
+        commit();
+    } catch (const std::exception &ex) {
+        rollback();
+        throw;
     }
 }
 
@@ -862,7 +1518,9 @@ void Database::unsafeResetDatabase(jsi::String &schema, int schemaVersion) {
 
     beginTransaction();
     try {
-        cachedRecords_ = {};
+        cachedRecords_.clear();
+        invalidateCachesAfterRawSql();
+        resultShapes_.clear();
 
         // Reinitialize schema
         executeMultiple(schema.utf8(rt));
@@ -885,6 +1543,9 @@ void Database::migrate(jsi::String &migrationSql, int fromVersion, int toVersion
 
         executeMultiple(migrationSql.utf8(rt));
         setUserVersion(toVersion);
+        resultShapes_.clear();
+        rowCache_.clear();
+        liveQueries_.markAllDirty();
 
         commit();
     } catch (const std::exception &ex) {
@@ -897,21 +1558,84 @@ jsi::Value Database::getLocal(jsi::String &key) {
     auto &rt = getRt();
     const std::lock_guard<std::mutex> lock(mutex_);
 
-    auto args = jsi::Array::createWithElements(rt, key);
-    auto statement = executeQuery("select value from local_storage where key = ?", args);
-
-    if (getNextRowOrTrue(statement.stmt)) {
+    auto &localStorage = loadedLocalStorage();
+    auto found = localStorage.find(key.utf8(rt));
+    if (found == localStorage.end()) {
         return jsi::Value::null();
     }
 
-    assert(sqlite3_data_count(statement.stmt) == 1);
-    const char *text = (const char *)sqlite3_column_text(statement.stmt, 0);
+    return jsi::String::createFromUtf8(rt, found->second);
+}
 
-    if (!text) {
-        return jsi::Value::null();
+std::vector<std::optional<std::string>> Database::getLocalMany(const std::vector<std::string> &keys) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto &localStorage = loadedLocalStorage();
+    std::vector<std::optional<std::string>> values;
+    values.reserve(keys.size());
+    for (auto const &key : keys) {
+        auto found = localStorage.find(key);
+        if (found == localStorage.end()) {
+            values.push_back(std::nullopt);
+        } else {
+            values.push_back(found->second);
+        }
+    }
+    return values;
+}
+
+void Database::setLocal(const std::string &key, const std::string &value) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto &localStorage = loadedLocalStorage();
+    auto found = localStorage.find(key);
+    if (found != localStorage.end() && found->second == value) {
+        return; // NOTE: Setting the same value again (e.g. unchanged sync cursor) doesn't need a write
+    }
+
+    std::vector<SqliteValue> args = { key, value };
+    auto statement = SqliteStatement(prepareQuery("insert or replace into local_storage (key, value) values (?, ?)", true));
+    bindArgs(statement.stmt, args);
+    executeUpdate(statement.stmt);
+
+    localStorage[key] = value;
+}
+
+void Database::removeLocal(const std::string &key) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto &localStorage = loadedLocalStorage();
+    auto found = localStorage.find(key);
+    if (found == localStorage.end()) {
+        return;
+    }
+
+    std::vector<SqliteValue> args = { key };
+    auto statement = SqliteStatement(prepareQuery("delete from local_storage where key == ?", true));
+    bindArgs(statement.stmt, args);
+    executeUpdate(statement.stmt);
+
+    localStorage.erase(found);
+}
+
+std::unordered_map<std::string, std::string> &Database::loadedLocalStorage() {
+    if (localStorage_) {
+        return *localStorage_;
+    }
+
+    // NOTE: Local storage is small (a few keys for sync and app settings), so it's all loaded at once
+    std::unordered_map<std::string, std::string> localStorage;
+    auto statement = SqliteStatement(prepareQuery("select key, value from local_storage"));
+    while (!getNextRowOrTrue(statement.stmt)) {
+        auto key = (const char *)sqlite3_column_text(statement.stmt, 0);
+        auto value = (const char *)sqlite3_column_text(statement.stmt, 1);
+        if (key && value) {
+            localStorage.emplace(key, value);
+        }
     }
 
-    return jsi::String::createFromUtf8(rt, text);
+    localStorage_ = std::move(localStorage);
+    return *localStorage_;
 }
 
 } // namespace watermelondb
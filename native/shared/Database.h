@@ -1,75 +1,383 @@
 #pragma once
 
 #import <jsi/jsi.h>
+#import <atomic>
+#import <chrono>
+#import <condition_variable>
 #import <unordered_map>
 #import <unordered_set>
 #import <mutex>
+#import <optional>
+#import <variant>
 #import <sqlite3.h>
+#import <ReactCommon/CallInvoker.h>
 #import "simdjson.h"
 
 #import "Sqlite.h"
+#import "SqliteArray.h"
+#import "QueryResult.h"
+#import "LazyRow.h"
+#import "ChangeCapture.h"
+#import "LiveQueries.h"
+#import "ObservationMatcher.h"
+#import "RecordIdCache.h"
+#import "RowCache.h"
+#import "QueryResultCache.h"
+#import "QueryTables.h"
+#import "BinaryBatch.h"
+#import "RecordBatch.h"
+#import "WorkQueue.h"
+#import "ReadConnectionPool.h"
+#import "StatementCache.h"
 
 using namespace facebook;
 
 namespace watermelondb {
 
+// Reads value of a column of the current result row
+SqliteValue columnValue(sqlite3_stmt *statement, int i);
+
+// Binds a value to an argument (1-based index). Strings are not copied, so they must outlive statement execution.
+// Returns sqlite result code
+int bindValue(sqlite3_stmt *statement, int index, const SqliteValue &value);
+
+// Ids of records to find with findMany, by table
+using FindRequest = std::pair<std::string, std::vector<std::string>>;
+
+// Records of one table found by findMany. For each requested id, index of its row in `rows` (an id of a record
+// cached in JS, or a full row), or -1 if there's no such record
+struct FoundRecords {
+    QueryResult rows;
+    std::vector<int> rowIndexes;
+};
+
+// Query results in column-major layout, read off the JS thread. Each column has (only if it contains values of
+// this type) an array of numbers, an array of indexes into `strings` (-1 if value is not text), and a bitmap of
+// null values (bit set = null)
+struct ColumnarColumn {
+    std::string name;
+    std::vector<double> numbers;
+    std::vector<int32_t> strings;
+    std::vector<uint8_t> nulls;
+};
+
+struct ColumnarResult {
+    size_t rowCount = 0;
+    std::vector<ColumnarColumn> columns;
+    std::vector<std::string> strings; // deduplicated
+};
+
+// Changes of a table in a transaction, with ids of inserted and updated rows (by rowid)
+struct ResolvedTableChanges {
+    TableChanges rows;
+    std::unordered_map<int64_t, std::string> ids;
+};
+
+using ResolvedChangeSet = std::map<std::string, ResolvedTableChanges>;
+
+// Re-executed live query - ids of matching records (and their difference from last known ids), or their count,
+// depending on the query's kind
+struct LiveQueryResult {
+    int handle;
+    LiveQueryKind kind;
+    std::vector<std::string> ids;
+    IdsDiff diff;
+    int count = 0;
+};
+
+// Column names of a statement's results, converted to JS property names once, and then reused for every row
+// (and every execution) of the statement. Original names are kept to check that the statement's columns didn't
+// change since (see resultShape)
+struct ResultShape {
+    std::vector<std::string> sqlColumnNames;
+    std::vector<jsi::PropNameID> columnNames;
+};
+
+// How durable a batch's commit is, from least to most durable. Applies only to the batch's own transaction -
+// other transactions use connection's default (`pragma synchronous`)
+enum class Durability {
+    // Like normal, but commit never checkpoints WAL into the database (which syncs it) - with async JSI, a passive
+    // checkpoint is made on the worker thread after work dispatched earlier is done
+    deferred,
+    // synchronous = NORMAL - WAL is not synced on commit. Commit survives app crashes, but not necessarily an OS
+    // crash or power loss until WAL is synced (by a checkpoint, or the next `full` commit). Database is never corrupted
+    normal,
+    // synchronous = FULL - WAL is synced on every commit
+    full,
+};
+
+// Write dispatched asynchronously, to be executed in one transaction with other writes dispatched within the
+// write coalescing window (see configureWriteCoalescing). `fail` is called if the shared transaction fails
+struct CoalescedWrite {
+    std::optional<Durability> durability; // NOTE: group's transaction is as durable as its most durable write
+    std::function<void(void)> work;
+    std::function<void(const std::string &)> fail;
+    std::function<void(void)> onComplete;
+};
+
+struct WriteGroup {
+    std::vector<CoalescedWrite> writes;
+    bool isClosed = false; // NOTE: once closed, no more writes are added
+};
+
 class Database : public jsi::HostObject {
 public:
-    static void install(jsi::Runtime *runtime);
-    Database(jsi::Runtime *runtime, std::string path, bool usesExclusiveLocking);
+    static void install(jsi::Runtime *runtime, std::shared_ptr<react::CallInvoker> jsCallInvoker);
+    Database(jsi::Runtime *runtime, std::string path, bool usesExclusiveLocking, std::shared_ptr<react::CallInvoker> jsCallInvoker);
     ~Database();
     void destroy();
 
     jsi::Value find(jsi::String &tableName, jsi::String &id);
+    // Finds records of many ids (of one or more tables) at once, with a single query per table
+    std::vector<FoundRecords> findMany(const std::vector<FindRequest> &requests);
+    // Executes many reads in a single read transaction, so that all results come from the same snapshot. Reads use
+    // the passed read connection (when called off the JS thread), or the main one if nullptr is passed.
+    // NOTE: Query result cache is bypassed - its results could come from a different snapshot than the others
+    std::vector<ReadQueryResult> queryMany(ReadConnection *reader, std::vector<ReadQuery> &queries);
     jsi::Value query(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments);
     jsi::Value queryAsArray(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments);
     jsi::Array queryIds(jsi::String &sql, jsi::Array &arguments);
     jsi::Array unsafeQueryRaw(jsi::String &sql, jsi::Array &arguments);
     jsi::Value count(jsi::String &sql, jsi::Array &arguments);
+    // Like queryAsArray, but the result is serialized natively into one JSON string, to be decoded with
+    // JSON.parse - so that only one JSI value is created, regardless of the number of rows
+    jsi::Value queryAsJson(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments);
+    // Like unsafeQueryRaw, but returns LazyRow HostObjects, which convert values to JS only when accessed
+    jsi::Array unsafeQueryRawLazy(jsi::String &sql, jsi::Array &arguments);
+    // Returns results as numeric/string index arrays per column, not objects per row (see ColumnarResult).
+    // Records are not marked as cached
+    jsi::Value queryColumnar(jsi::String &sql, jsi::Array &arguments);
     void batch(jsi::Array &operations);
     void batchJSON(jsi::String &&operationsJson);
+    // Executes raw SQL batch encoded by encodeBinaryBatch (see BinaryBatch.h), reading it in place. Record
+    // operations are not supported - they're passed as raw records to batchRecords
+    void batchBinary(const uint8_t *data, size_t size);
     jsi::Value unsafeLoadFromSync(int jsonId, jsi::Object &schema, std::string preamble, std::string postamble);
     void unsafeResetDatabase(jsi::String &schema, int schemaVersion);
     jsi::Value getLocal(jsi::String &key);
+    // Local storage is read from a native cache (loaded on first use), and written through to the table
+    std::vector<std::optional<std::string>> getLocalMany(const std::vector<std::string> &keys);
+    void setLocal(const std::string &key, const std::string &value);
+    void removeLocal(const std::string &key);
     void executeMultiple(std::string sql);
 
+    // Prepared queries - statements compiled once, and then executed by their handle, so that SQL doesn't
+    // have to be passed and looked up every time. Handles must be released when no longer used
+    int prepare(jsi::String &sql);
+    void release(int handle);
+    jsi::Value executeQuery(int handle, jsi::String &tableName, jsi::Array &arguments);
+    jsi::Value executeQueryAsArray(int handle, jsi::String &tableName, jsi::Array &arguments);
+    jsi::Value executeQueryAsJson(int handle, jsi::String &tableName, jsi::Array &arguments);
+    jsi::Array executeQueryIds(int handle, jsi::Array &arguments);
+    jsi::Array executeUnsafeQueryRaw(int handle, jsi::Array &arguments);
+    jsi::Value executeCount(int handle, jsi::Array &arguments);
+    // Change capture - once enabled, rows changed by every committed transaction (including ones not made by
+    // batch) are collected, and returned (and forgotten) by drainChanges()
+    void enableChangeCapture();
+    std::vector<ResolvedChangeSet> drainChanges();
+    static jsi::Value changesToJsi(jsi::Runtime &rt, std::vector<ResolvedChangeSet> &changes);
+    // Live queries - queries observed by JS, which are marked as dirty when a transaction changing any of
+    // their tables commits, so that only those have to be re-executed. New queries are dirty, so the first refresh
+    // returns all their ids (as inserted). Handles must be unregistered when no longer observed
+    int registerLiveQuery(std::string sql, std::vector<SqliteValue> arguments, std::vector<std::string> tables, LiveQueryKind kind);
+    void unregisterLiveQuery(int handle);
+    std::vector<int> drainDirtyQueries();
+    // Re-executes dirty queries (and clears their dirty state). Runs off the JS thread, with the passed read
+    // connection, or the main one if nullptr is passed
+    std::vector<LiveQueryResult> refreshDirtyQueries(ReadConnection *reader);
+    // Replaces ids of refreshed `ids` queries with their difference from last known ids, and saves new ids as last
+    // known. Must be called in the same order as refreshDirtyQueries, so that diffs apply to results received by JS
+    void diffLiveQueryResults(std::vector<LiveQueryResult> &results);
+    static jsi::Array liveQueryResultsToJsi(jsi::Runtime &rt, std::vector<LiveQueryResult> &results);
+    // Observation matchers - conditions of simple queries (see ObservationMatcher), compiled once. Rows
+    // inserted or updated by committed transactions are checked against all matchers of their table in one pass,
+    // and ids of changed records are returned to JS split into matching and not matching (or deleted) ones
+    int registerMatcher(std::string table, std::string whereJson);
+    void unregisterMatcher(int handle);
+    std::vector<MatcherChanges> matchChangedRows();
+    // Stats of prepared statement caches of all connections (read connections in use by async reads are skipped)
+    StatementCacheStats statementCacheStats();
+    // Forgets ids of records released by JS, so that they're sent in full next time they're queried.
+    // Returns number of ids that were cached
+    size_t evictCachedRecords(std::string tableName, std::vector<std::string> ids);
+    RecordCacheStats recordCacheStats();
+    // Row cache - if enabled, rows read by find are kept (up to the limits), so that finding them again (e.g. after
+    // JS released them) doesn't have to step sqlite. Disabled by default (maxCount = 0)
+    void configureRowCache(size_t maxCount, size_t maxMemory);
+    RowCacheStats rowCacheStats();
+    // Query result cache - if enabled, results of query, queryIds and count are kept (up to maxMemory bytes)
+    // until a transaction changes one of the tables they read. Disabled by default (maxMemory = 0).
+    // NOTE: Tables read are found on a separate connection, so results aren't cached for private in-memory or
+    // exclusively locked databases
+    void configureQueryCache(size_t maxMemory);
+    QueryCacheStats queryCacheStats();
+    // Write coalescing - if enabled, async batches dispatched within `windowMs` of the first one are executed in
+    // one transaction (group commit), each in its own savepoint, so that a failed batch doesn't affect others.
+    // Disabled by default (windowMs = 0)
+    void configureWriteCoalescing(int windowMs);
+    // Record batches - once schema is registered, batches can be made of `[type, table, rawRecordOrId]` operations,
+    // and SQL and arguments are made natively (statements are prepared once per table). Index SQL is used for
+    // large batches, for which it's faster to drop indices and recreate them afterwards
+    void registerSchema(jsi::Object &schema, std::string dropIndicesSql, std::string createIndicesSql);
+    void batchRecords(jsi::Array &operations, bool recreatesIndices, std::optional<Durability> durability);
+    std::vector<RecordOperation> recordOperationsFromJsi(jsi::Runtime &rt, jsi::Array &operations);
+
+    // Runs `work` on the database's worker thread, and then `onComplete` on the JS thread. `work` must not
+    // touch the JS runtime. Returns false (and runs neither) if the database was already closed
+    bool dispatchAsync(std::function<void(void)> work, std::function<void(void)> onComplete);
+    // Like dispatchAsync, but for read-only work, which can run in parallel with other reads (but not writes).
+    // `read` gets one of the read connections (or nullptr, if they're not available - in that case, main
+    // connection should be used). Then, `complete` is called in order of dispatch (e.g. to update record cache),
+    // and `onComplete` on the JS thread
+    bool dispatchAsyncRead(std::function<void(ReadConnection *)> read, std::function<void(void)> complete, std::function<void(void)> onComplete);
+    // Like dispatchAsync, but for a batch, which may be coalesced with other writes (see configureWriteCoalescing).
+    // `onComplete` is only called after the shared transaction is committed
+    bool dispatchAsyncWrite(std::optional<Durability> durability, std::function<void(void)> work, std::function<void(const std::string &)> fail, std::function<void(void)> onComplete);
+    // Waits until work dispatched asynchronously is done, so that synchronous calls are executed in order
+    void waitForAsyncWork();
+
+    // Async variants - these run off the JS thread. Reads use the passed read connection, or the main one
+    // if nullptr is passed
+    QueryResult findAsync(std::string tableName, std::string id);
+    QueryResult queryAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    QueryResult queryIdsAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    QueryResult unsafeQueryRawAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    int countAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    std::vector<std::shared_ptr<LazyRow>> unsafeQueryRawLazyAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    ColumnarResult queryColumnarAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments);
+    // Replaces records already cached in JS with just their ids (like in `query`), and marks the rest as cached
+    void applyRecordCache(std::string tableName, QueryResult &result);
+    void applyRecordCache(std::vector<ReadQuery> &queries, std::vector<ReadQueryResult> &results);
+    void batchJSONAsync(simdjson::padded_string &json);
+    void batchBinaryAsync(std::vector<uint8_t> &data);
+    void batchRecordsAsync(std::vector<RecordOperation> &operations, bool recreatesIndices, std::optional<Durability> durability);
+    std::optional<std::string> getLocalAsync(std::string key);
+
+    // Conversion between JS values and values usable off the JS thread
+    static std::vector<SqliteValue> argsFromJsi(jsi::Runtime &rt, jsi::Array &arguments);
+    static std::shared_ptr<SqliteValueArray> arrayArgFromJsi(jsi::Runtime &rt, jsi::Array &array);
+    static jsi::Array recordsToJsi(jsi::Runtime &rt, QueryResult &result, bool asArrays);
+    static jsi::Value findResultToJsi(jsi::Runtime &rt, QueryResult &result);
+    static std::vector<std::string> stringsFromJsi(jsi::Runtime &rt, const jsi::Array &strings);
+    static jsi::Array localValuesToJsi(jsi::Runtime &rt, std::vector<std::optional<std::string>> &values);
+    static std::vector<FindRequest> findRequestsFromJsi(jsi::Runtime &rt, jsi::Array &requests);
+    static jsi::Array foundRecordsToJsi(jsi::Runtime &rt, std::vector<FoundRecords> &results);
+    static std::vector<ReadQuery> readQueriesFromJsi(jsi::Runtime &rt, jsi::Array &queries);
+    static jsi::Array readQueryResultsToJsi(jsi::Runtime &rt, std::vector<ReadQueryResult> &results);
+    static jsi::Array idsToJsi(jsi::Runtime &rt, QueryResult &result);
+    static std::string queryResultToJson(QueryResult &result);
+    static jsi::Array lazyRowsToJsi(jsi::Runtime &rt, std::vector<std::shared_ptr<LazyRow>> &rows);
+    static jsi::Value columnarResultToJsi(jsi::Runtime &rt, ColumnarResult &result);
+
 private:
-    bool initialized_;
-    bool isDestroyed_;
+    bool initialized_ = false;
+    bool isDestroyed_ = false;
     std::mutex mutex_;
     jsi::Runtime *runtime_; // TODO: std::shared_ptr would be better, but I don't know how to make it from void* in RCTCxxBridge
     std::unique_ptr<SqliteDb> db_;
-    std::unordered_map<std::string, sqlite3_stmt *> cachedStatements_; // NOTE: may contain null pointers!
-    std::unordered_set<std::string> cachedRecords_;
+    std::unordered_map<sqlite3_stmt *, ResultShape> resultShapes_; // NOTE: must outlive statementCache_
+    // NOTE: Shapes of statements finalized off the JS thread, to be released on the JS thread (see resultShape)
+    std::vector<ResultShape> retiredResultShapes_;
+    StatementCache statementCache_;
+    std::unordered_map<int, sqlite3_stmt *> preparedStatements_;
+    int nextPreparedStatementHandle_ = 1;
+    RecordIdCache cachedRecords_;
+    RowCache rowCache_;
+    QueryResultCache queryCache_;
+    std::unique_ptr<QueryTables> queryTables_; // NOTE: null if tables of queries can't be found (results aren't cached)
+    std::atomic<bool> usesQueryCache_ { false }; // NOTE: So that reads don't need the lock to check
+    std::optional<std::unordered_map<std::string, std::string>> localStorage_; // NOTE: nullopt if not loaded
+    std::unordered_map<std::string, std::shared_ptr<const RegisteredTable>> registeredTables_;
+    std::string dropIndicesSql_;
+    std::string createIndicesSql_;
+    ChangeCapture changeCapture_;
+    LiveQueryRegistry liveQueries_;
+    ObservationMatcherRegistry matchers_;
+    std::shared_ptr<react::CallInvoker> jsCallInvoker_;
+    WorkQueue asyncQueue_;
+    std::unique_ptr<ReadConnectionPool> readPool_; // NOTE: null if parallel reads are not possible
+    bool isInWriteGroup_ = false; // NOTE: if true, batch transactions are savepoints of the group's transaction
+    std::mutex writeGroupMutex_;
+    std::condition_variable writeGroupClosed_;
+    std::chrono::milliseconds writeCoalescingWindow_ { 0 }; // NOTE: guarded by writeGroupMutex_
+    std::shared_ptr<WriteGroup> openWriteGroup_; // NOTE: guarded by writeGroupMutex_
+    int defaultSynchronous_ = 0; // NOTE: connection's `pragma synchronous` level
+    Durability defaultDurability_ = Durability::full;
+    Durability durability_ = Durability::full; // NOTE: of the current (or last) transaction
+    bool isCheckpointScheduled_ = false;
 
     jsi::Runtime &getRt();
-    jsi::JSError dbError(std::string description);
+    DatabaseError dbError(std::string description);
 
-    sqlite3_stmt* prepareQuery(std::string sql);
+    sqlite3_stmt* prepareQuery(std::string sql, bool pinned = false);
     void bindArgs(sqlite3_stmt *statement, jsi::Array &arguments);
+    void bindArgs(sqlite3_stmt *statement, std::vector<SqliteValue> &arguments);
+    // Prepares and binds a read-only statement on the read connection, or on the main connection (locking it)
+    // if reader is nullptr. If a `prepared` statement (of the main connection) is passed, it's bound instead
+    SqliteStatement executeReadQuery(ReadConnection *reader, std::unique_lock<std::mutex> &lock, std::string &sql, std::vector<SqliteValue> &arguments, sqlite3_stmt *prepared = nullptr);
+    // Like executeReadQuery, but returns result from the query result cache (if enabled), or caches it
+    // NOTE: If `prepared` statement of query's SQL is passed, it's executed on cache miss instead of preparing the SQL
+    ReadQueryResult cachedReadQuery(ReadConnection *reader, std::unique_lock<std::mutex> &lock, ReadQuery query, sqlite3_stmt *prepared = nullptr);
+    jsi::Value cachedReadQueryToJsi(std::unique_lock<std::mutex> &lock, ReadQuery query, bool asArrays, sqlite3_stmt *prepared = nullptr);
+    sqlite3_stmt *preparedStatement(int handle);
     std::string bindArgsAndReturnId(sqlite3_stmt *statement, simdjson::ondemand::array &args);
     SqliteStatement executeQuery(std::string sql, jsi::Array &arguments);
+    SqliteStatement executePrepared(int handle, jsi::Array &arguments);
     void executeUpdate(sqlite3_stmt *statement);
-    void executeUpdate(std::string sql, jsi::Array &arguments);
+    void executeUpdate(std::string sql, jsi::Array &arguments, bool pinned);
     void executeUpdate(std::string sql);
     void getRow(sqlite3_stmt *stmt);
     bool getNextRowOrTrue(sqlite3_stmt *stmt);
+    const ResultShape &resultShape(sqlite3_stmt *statement);
     jsi::Object resultDictionary(sqlite3_stmt *statement);
     jsi::Array resultArray(sqlite3_stmt *statement);
     jsi::Array resultColumns(sqlite3_stmt *statement);
+    std::vector<std::shared_ptr<LazyRow>> readLazyRows(sqlite3_stmt *statement);
+    ColumnarResult readColumnarResult(sqlite3_stmt *statement);
     jsi::Array arrayFromStd(std::vector<jsi::Value> &vector);
+    jsi::Value queryResult(std::string tableName, sqlite3_stmt *statement);
+    jsi::Value queryAsArrayResult(std::string tableName, sqlite3_stmt *statement);
+    jsi::Array queryIdsResult(sqlite3_stmt *statement);
+    jsi::Array unsafeQueryRawResult(sqlite3_stmt *statement);
+    jsi::Value countResult(sqlite3_stmt *statement);
+    // Same as applyRecordCache, for callers that already hold the lock
+    void replaceCachedRecords(std::string tableName, QueryResult &result);
+    std::unordered_map<int64_t, std::string> recordIdsByRowid(const std::string &table, TableChanges &changes);
+    QueryResult readQueryResult(sqlite3_stmt *statement);
+    QueryResult readQueryIdsResult(sqlite3_stmt *statement);
+    int readCountResult(sqlite3_stmt *statement);
+    ReadQueryResult readResultOfKind(sqlite3_stmt *statement, ReadQueryKind kind);
+    void executeBatchJSON(simdjson::padded_string &json);
+    void executeBatchBinary(const uint8_t *data, size_t size);
+    void executeRecordBatch(std::vector<RecordOperation> &operations, bool recreatesIndices, std::optional<Durability> durability);
+    void bindBinaryArgs(sqlite3_stmt *statement, BinaryBatchReader &reader);
 
-    void beginTransaction();
+    // NOTE: If durability is not passed, connection's default is used
+    void beginTransaction(std::optional<Durability> durability = std::nullopt);
     void commit();
     void rollback();
+    void setDurability(Durability durability);
+    void scheduleCheckpoint();
+    // Closes the group of coalesced writes, so that writes dispatched after other work are not executed before it
+    void closeWriteGroup();
+    void executeWriteGroup(WriteGroup &group);
 
     int getUserVersion();
     void setUserVersion(int newVersion);
     void migrate(jsi::String &migrationSql, int fromVersion, int toVersion);
 
-    bool isCached(std::string cacheKey);
-    void markAsCached(std::string cacheKey);
-    void removeFromCache(std::string cacheKey);
+    bool isCached(const std::string &tableName, std::string_view id);
+    void markAsCached(const std::string &tableName, std::string_view id);
+    void removeFromCache(const std::string &tableName, std::string_view id);
+    // Finds a record using the row cache (and caches it if it wasn't)
+    QueryResult findWithRowCache(const std::string &tableName, const std::string &id);
+    std::unordered_map<std::string, std::string> &loadedLocalStorage();
+    // Drops data cached natively (and marks live queries and matchers as changed) that could have been changed by
+    // raw SQL without sqlite hooks noticing
+    void invalidateCachesAfterRawSql();
+    // Like executeMultiple, but for SQL known not to change any rows (e.g. dropping and creating indices)
+    void executeMultipleWithoutInvalidation(const std::string &sql);
+    FoundRecords findManyInTable(const std::string &tableName, const std::vector<std::string> &ids);
 };
 
 } // namespace watermelondb
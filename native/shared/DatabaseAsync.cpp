@@ -0,0 +1,738 @@
+#include "Database.h"
+#include "DatabasePlatform.h"
+#include <iterator>
+
+namespace watermelondb {
+
+using platform::consoleError;
+using platform::consoleLog;
+
+
+bool Database::dispatchAsync(std::function<void(void)> work, std::function<void(void)> onComplete) {
+    closeWriteGroup();
+    assert(jsCallInvoker_ && "Async methods are only installed if CallInvoker is available");
+
+    return asyncQueue_.dispatch([this, work = std::move(work), onComplete = std::move(onComplete), jsCallInvoker = jsCallInvoker_]() mutable {
+        // NOTE: Reads dispatched earlier must be done before work that may be a write
+        if (readPool_) {
+            readPool_->waitUntilIdle();
+        }
+        work();
+        // NOTE: onComplete is moved, not copied, so that anything JS-related it holds is only ever
+        // released on the JS thread
+        jsCallInvoker->invokeAsync(std::move(onComplete));
+    });
+}
+
+bool Database::dispatchAsyncRead(std::function<void(ReadConnection *)> read, std::function<void(void)> complete, std::function<void(void)> onComplete) {
+    if (!readPool_) {
+        return dispatchAsync([read = std::move(read), complete = std::move(complete)]() {
+            read(nullptr);
+            complete();
+        }, std::move(onComplete));
+    }
+
+    // NOTE: Reads are dispatched to the pool via the serial queue, so that they start after all writes dispatched
+    // earlier are done. Consecutive reads are then executed in parallel
+    closeWriteGroup();
+    return asyncQueue_.dispatch([this, read = std::move(read), complete = std::move(complete), onComplete = std::move(onComplete), jsCallInvoker = jsCallInvoker_]() mutable {
+        // NOTE: Pool is destroyed after asyncQueue_ is drained, so this can't fail
+        readPool_->dispatch(std::move(read), [complete = std::move(complete), onComplete = std::move(onComplete), jsCallInvoker]() mutable {
+            complete();
+            jsCallInvoker->invokeAsync(std::move(onComplete));
+        });
+    });
+}
+
+bool Database::dispatchAsyncWrite(std::optional<Durability> durability, std::function<void(void)> work, std::function<void(const std::string &)> fail, std::function<void(void)> onComplete) {
+    std::shared_ptr<WriteGroup> group;
+    {
+        const std::lock_guard<std::mutex> lock(writeGroupMutex_);
+        if (openWriteGroup_) {
+            openWriteGroup_->writes.push_back({ durability, std::move(work), std::move(fail), std::move(onComplete) });
+            return true;
+        }
+        if (writeCoalescingWindow_.count() > 0) {
+            group = std::make_shared<WriteGroup>();
+            group->writes.push_back({ durability, std::move(work), std::move(fail), std::move(onComplete) });
+            openWriteGroup_ = group;
+        }
+    }
+
+    if (!group) {
+        return dispatchAsync(std::move(work), std::move(onComplete));
+    }
+
+    bool isDispatched = asyncQueue_.dispatch([this, group, jsCallInvoker = jsCallInvoker_]() {
+        executeWriteGroup(*group);
+        // NOTE: In order of dispatch, and only after all writes are committed
+        for (auto &write : group->writes) {
+            jsCallInvoker->invokeAsync(std::move(write.onComplete));
+        }
+    });
+    if (!isDispatched) {
+        // NOTE: Writes are only added to the group on JS thread, so it only has this write
+        closeWriteGroup();
+    }
+    return isDispatched;
+}
+
+void Database::closeWriteGroup() {
+    const std::lock_guard<std::mutex> lock(writeGroupMutex_);
+    if (openWriteGroup_) {
+        openWriteGroup_->isClosed = true;
+        openWriteGroup_ = nullptr;
+        writeGroupClosed_.notify_all();
+    }
+}
+
+void Database::executeWriteGroup(WriteGroup &group) {
+    {
+        // NOTE: Waits for more writes, unless other work is dispatched first (it must not wait for the window)
+        std::unique_lock<std::mutex> lock(writeGroupMutex_);
+        writeGroupClosed_.wait_for(lock, writeCoalescingWindow_, [&group]() { return group.isClosed; });
+        group.isClosed = true;
+        if (openWriteGroup_.get() == &group) {
+            openWriteGroup_ = nullptr;
+        }
+    }
+
+    // NOTE: Reads dispatched earlier must be done before work that may be a write
+    if (readPool_) {
+        readPool_->waitUntilIdle();
+    }
+
+    if (group.writes.size() == 1) {
+        group.writes[0].work();
+        return;
+    }
+
+    auto durability = defaultDurability_;
+    for (auto const &write : group.writes) {
+        durability = std::max(durability, write.durability.value_or(defaultDurability_));
+    }
+
+    std::optional<std::string> error;
+    try {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        beginTransaction(durability);
+        isInWriteGroup_ = true;
+    } catch (const std::exception &ex) {
+        error = ex.what();
+    }
+
+    if (!error) {
+        for (auto &write : group.writes) {
+            write.work();
+        }
+
+        const std::lock_guard<std::mutex> lock(mutex_);
+        isInWriteGroup_ = false;
+        try {
+            if (sqlite3_get_autocommit(db_->sqlite)) {
+                throw DatabaseError("Transaction of coalesced writes was rolled back");
+            }
+            commit();
+        } catch (const std::exception &ex) {
+            rollback();
+            error = ex.what();
+        }
+    }
+
+    if (error) {
+        for (auto &write : group.writes) {
+            write.fail(*error);
+        }
+    }
+}
+
+void Database::scheduleCheckpoint() {
+    if (!jsCallInvoker_ || isCheckpointScheduled_) {
+        return;
+    }
+    isCheckpointScheduled_ = true;
+    // NOTE: Passive checkpoint doesn't wait for readers, and doesn't block them
+    asyncQueue_.dispatch([this]() {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        isCheckpointScheduled_ = false;
+        if (sqlite3_wal_checkpoint_v2(db_->sqlite, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr) != SQLITE_OK) {
+            consoleError("Failed to checkpoint WAL after deferred commits: " + std::string(sqlite3_errmsg(db_->sqlite)));
+        }
+    });
+}
+
+void Database::waitForAsyncWork() {
+    closeWriteGroup();
+    if (jsCallInvoker_) {
+        asyncQueue_.waitUntilIdle();
+        // NOTE: Reads are only dispatched to the pool from asyncQueue_, so nothing new will be added here
+        if (readPool_) {
+            readPool_->waitUntilIdle();
+        }
+    }
+}
+
+// MARK: - Conversion
+
+std::vector<SqliteValue> Database::argsFromJsi(jsi::Runtime &rt, jsi::Array &arguments) {
+    size_t argsCount = arguments.length(rt);
+    std::vector<SqliteValue> args;
+    args.reserve(argsCount);
+
+    for (size_t i = 0; i < argsCount; i++) {
+        jsi::Value value = arguments.getValueAtIndex(rt, i);
+
+        if (value.isNull() || value.isUndefined()) {
+            args.push_back(std::monostate());
+        } else if (value.isString()) {
+            args.push_back(value.getString(rt).utf8(rt));
+        } else if (value.isNumber()) {
+            args.push_back(value.getNumber());
+        } else if (value.isBool()) {
+            args.push_back((int64_t) value.getBool());
+        } else if (value.isObject() && value.getObject(rt).isArray(rt)) {
+            jsi::Array array = value.getObject(rt).getArray(rt);
+            args.push_back(arrayArgFromJsi(rt, array));
+        } else if (value.isObject()) {
+            throw jsi::JSError(rt, "Invalid argument type (object) for query");
+        } else {
+            throw jsi::JSError(rt, "Invalid argument type (unknown) for query");
+        }
+    }
+
+    return args;
+}
+
+std::shared_ptr<SqliteValueArray> Database::arrayArgFromJsi(jsi::Runtime &rt, jsi::Array &array) {
+    auto values = argsFromJsi(rt, array);
+    for (auto const &value : values) {
+        if (std::holds_alternative<std::shared_ptr<SqliteValueArray>>(value)) {
+            throw jsi::JSError(rt, "Invalid argument type (nested array) for query");
+        }
+    }
+    return std::make_shared<SqliteValueArray>(SqliteValueArray { std::move(values) });
+}
+
+int bindValue(sqlite3_stmt *statement, int index, const SqliteValue &value) {
+    if (std::holds_alternative<std::monostate>(value)) {
+        return sqlite3_bind_null(statement, index);
+    } else if (auto text = std::get_if<std::string>(&value)) {
+        return sqlite3_bind_text(statement, index, text->c_str(), (int) text->length(), SQLITE_STATIC);
+    } else if (auto number = std::get_if<double>(&value)) {
+        return sqlite3_bind_double(statement, index, *number);
+    } else if (auto array = std::get_if<std::shared_ptr<SqliteValueArray>>(&value)) {
+        return bindArray(statement, index, *array);
+    }
+    return sqlite3_bind_int64(statement, index, std::get<int64_t>(value));
+}
+
+void Database::bindArgs(sqlite3_stmt *statement, std::vector<SqliteValue> &arguments) {
+    int argsCount = sqlite3_bind_parameter_count(statement);
+
+    if (argsCount != arguments.size()) {
+        sqlite3_reset(statement);
+        throw DatabaseError("Number of args passed to query doesn't match number of arg placeholders");
+    }
+
+    for (int i = 0; i < argsCount; i++) {
+        // NOTE: Arguments outlive statement execution
+        int bindResult = bindValue(statement, i + 1, arguments[i]);
+
+        if (bindResult != SQLITE_OK) {
+            sqlite3_reset(statement);
+            throw sqliteError(sqlite3_db_handle(statement), "Failed to bind an argument for query");
+        }
+    }
+}
+
+SqliteValue columnValue(sqlite3_stmt *statement, int i) {
+    auto type = sqlite3_column_type(statement, i);
+    if (type == SQLITE_INTEGER) {
+        return (int64_t) sqlite3_column_int64(statement, i);
+    } else if (type == SQLITE_FLOAT) {
+        return sqlite3_column_double(statement, i);
+    } else if (type == SQLITE_TEXT) {
+        const char *text = (const char *)sqlite3_column_text(statement, i);
+        if (text) {
+            return std::string(text, sqlite3_column_bytes(statement, i));
+        }
+        return std::monostate();
+    } else if (type == SQLITE_NULL) {
+        return std::monostate();
+    }
+    throw DatabaseError("Unable to fetch record from database - unknown column type (WatermelonDB does not support blobs or custom sqlite types");
+}
+
+jsi::Value valueToJsi(jsi::Runtime &rt, SqliteValue &value) {
+    if (auto text = std::get_if<std::string>(&value)) {
+        return jsi::String::createFromUtf8(rt, *text);
+    } else if (auto number = std::get_if<double>(&value)) {
+        return jsi::Value(*number);
+    } else if (auto integer = std::get_if<int64_t>(&value)) {
+        return jsi::Value((double) *integer);
+    }
+    return jsi::Value::null();
+}
+
+// Reads all rows of an executed statement
+QueryResult Database::readQueryResult(sqlite3_stmt *statement) {
+    QueryResult result;
+
+    while (true) {
+        if (getNextRowOrTrue(statement)) {
+            break;
+        }
+
+        int columnCount = sqlite3_column_count(statement);
+        if (result.columnNames.empty()) {
+            for (int i = 0; i < columnCount; i++) {
+                const char *column = sqlite3_column_name(statement, i);
+                assert(column);
+                result.columnNames.push_back(column);
+            }
+        }
+
+        for (int i = 0; i < columnCount; i++) {
+            result.values.push_back(columnValue(statement, i));
+        }
+        result.isCachedId.push_back(false);
+    }
+
+    return result;
+}
+
+std::vector<jsi::PropNameID> columnNamesToJsi(jsi::Runtime &rt, QueryResult &result) {
+    std::vector<jsi::PropNameID> names;
+    names.reserve(result.columnNames.size());
+    for (auto const &column : result.columnNames) {
+        names.push_back(jsi::PropNameID::forUtf8(rt, column));
+    }
+    return names;
+}
+
+jsi::Object recordToJsi(jsi::Runtime &rt, QueryResult &result, std::vector<jsi::PropNameID> &columnNames, size_t &valueIdx) {
+    jsi::Object record(rt);
+    for (auto const &column : columnNames) {
+        record.setProperty(rt, column, valueToJsi(rt, result.values[valueIdx++]));
+    }
+    return record;
+}
+
+jsi::Array Database::recordsToJsi(jsi::Runtime &rt, QueryResult &result, bool asArrays) {
+    size_t rowCount = result.isCachedId.size();
+    size_t columnCount = result.columnNames.size();
+
+    // NOTE: Same format as query/queryAsArray
+    size_t offset = asArrays && rowCount ? 1 : 0;
+    jsi::Array records(rt, rowCount + offset);
+
+    if (asArrays && rowCount) {
+        jsi::Array columns(rt, columnCount);
+        for (size_t i = 0; i < columnCount; i++) {
+            columns.setValueAtIndex(rt, i, jsi::String::createFromUtf8(rt, result.columnNames[i]));
+        }
+        records.setValueAtIndex(rt, 0, std::move(columns));
+    }
+
+    // NOTE: Property names are created once, not for every row
+    auto columnNames = asArrays ? std::vector<jsi::PropNameID>() : columnNamesToJsi(rt, result);
+
+    size_t valueIdx = 0;
+    for (size_t row = 0; row < rowCount; row++) {
+        if (result.isCachedId[row]) {
+            auto &id = std::get<std::string>(result.values[valueIdx++]);
+            records.setValueAtIndex(rt, row + offset, jsi::String::createFromAscii(rt, id));
+        } else if (asArrays) {
+            jsi::Array record(rt, columnCount);
+            for (size_t i = 0; i < columnCount; i++) {
+                record.setValueAtIndex(rt, i, valueToJsi(rt, result.values[valueIdx++]));
+            }
+            records.setValueAtIndex(rt, row + offset, std::move(record));
+        } else {
+            records.setValueAtIndex(rt, row + offset, recordToJsi(rt, result, columnNames, valueIdx));
+        }
+    }
+
+    return records;
+}
+
+jsi::Value Database::findResultToJsi(jsi::Runtime &rt, QueryResult &result) {
+    if (result.isCachedId.empty()) {
+        return jsi::Value::null();
+    } else if (result.isCachedId[0]) {
+        return jsi::String::createFromAscii(rt, std::get<std::string>(result.values[0]));
+    }
+    size_t valueIdx = 0;
+    auto columnNames = columnNamesToJsi(rt, result);
+    return recordToJsi(rt, result, columnNames, valueIdx);
+}
+
+std::vector<std::string> Database::stringsFromJsi(jsi::Runtime &rt, const jsi::Array &strings) {
+    std::vector<std::string> result;
+    result.reserve(strings.size(rt));
+    for (size_t i = 0, len = strings.size(rt); i < len; i++) {
+        result.push_back(strings.getValueAtIndex(rt, i).getString(rt).utf8(rt));
+    }
+    return result;
+}
+
+jsi::Array Database::localValuesToJsi(jsi::Runtime &rt, std::vector<std::optional<std::string>> &values) {
+    jsi::Array jsiValues(rt, values.size());
+    for (size_t i = 0, len = values.size(); i < len; i++) {
+        if (values[i]) {
+            jsiValues.setValueAtIndex(rt, i, jsi::String::createFromUtf8(rt, *values[i]));
+        } else {
+            jsiValues.setValueAtIndex(rt, i, jsi::Value::null());
+        }
+    }
+    return jsiValues;
+}
+
+std::vector<FindRequest> Database::findRequestsFromJsi(jsi::Runtime &rt, jsi::Array &requests) {
+    std::vector<FindRequest> findRequests;
+    for (size_t i = 0, len = requests.size(rt); i < len; i++) {
+        jsi::Array request = requests.getValueAtIndex(rt, i).getObject(rt).getArray(rt);
+        auto tableName = request.getValueAtIndex(rt, 0).getString(rt).utf8(rt);
+        auto ids = stringsFromJsi(rt, request.getValueAtIndex(rt, 1).getObject(rt).getArray(rt));
+        findRequests.emplace_back(std::move(tableName), std::move(ids));
+    }
+    return findRequests;
+}
+
+// Returns an array (of found records, ids of cached records, or nulls, in order of requested ids) per table
+jsi::Array Database::foundRecordsToJsi(jsi::Runtime &rt, std::vector<FoundRecords> &results) {
+    jsi::Array jsiResults(rt, results.size());
+    for (size_t i = 0, len = results.size(); i < len; i++) {
+        auto &found = results[i];
+        auto records = recordsToJsi(rt, found.rows, false);
+        jsi::Array tableResults(rt, found.rowIndexes.size());
+        for (size_t j = 0, idsLen = found.rowIndexes.size(); j < idsLen; j++) {
+            int rowIndex = found.rowIndexes[j];
+            if (rowIndex == -1) {
+                tableResults.setValueAtIndex(rt, j, jsi::Value::null());
+            } else {
+                tableResults.setValueAtIndex(rt, j, records.getValueAtIndex(rt, rowIndex));
+            }
+        }
+        jsiResults.setValueAtIndex(rt, i, std::move(tableResults));
+    }
+    return jsiResults;
+}
+
+std::vector<ReadQuery> Database::readQueriesFromJsi(jsi::Runtime &rt, jsi::Array &queries) {
+    std::vector<ReadQuery> readQueries;
+    for (size_t i = 0, len = queries.size(rt); i < len; i++) {
+        jsi::Object query = queries.getValueAtIndex(rt, i).getObject(rt);
+        auto kind = query.getProperty(rt, "kind").getString(rt).utf8(rt);
+        jsi::Array arguments = query.getProperty(rt, "args").getObject(rt).getArray(rt);
+
+        ReadQuery readQuery;
+        if (kind == "query") {
+            readQuery.kind = ReadQueryKind::records;
+            readQuery.table = query.getProperty(rt, "table").getString(rt).utf8(rt);
+        } else if (kind == "ids") {
+            readQuery.kind = ReadQueryKind::ids;
+        } else if (kind == "count") {
+            readQuery.kind = ReadQueryKind::count;
+        } else if (kind == "raw") {
+            readQuery.kind = ReadQueryKind::raw;
+        } else {
+            throw jsi::JSError(rt, "Invalid query kind: " + kind);
+        }
+        readQuery.sql = query.getProperty(rt, "sql").getString(rt).utf8(rt);
+        readQuery.arguments = argsFromJsi(rt, arguments);
+        readQueries.push_back(std::move(readQuery));
+    }
+    return readQueries;
+}
+
+jsi::Array Database::readQueryResultsToJsi(jsi::Runtime &rt, std::vector<ReadQueryResult> &results) {
+    jsi::Array jsiResults(rt, results.size());
+    for (size_t i = 0, len = results.size(); i < len; i++) {
+        auto &result = results[i];
+        if (result.kind == ReadQueryKind::count) {
+            jsiResults.setValueAtIndex(rt, i, jsi::Value(result.count));
+        } else if (result.kind == ReadQueryKind::ids) {
+            jsiResults.setValueAtIndex(rt, i, idsToJsi(rt, result.rows));
+        } else {
+            jsiResults.setValueAtIndex(rt, i, recordsToJsi(rt, result.rows, false));
+        }
+    }
+    return jsiResults;
+}
+
+jsi::Array Database::idsToJsi(jsi::Runtime &rt, QueryResult &result) {
+    jsi::Array ids(rt, result.values.size());
+    for (size_t i = 0, len = result.values.size(); i < len; i++) {
+        ids.setValueAtIndex(rt, i, jsi::String::createFromAscii(rt, std::get<std::string>(result.values[i])));
+    }
+    return ids;
+}
+
+// MARK: - Async methods
+
+QueryResult Database::findAsync(std::string tableName, std::string id) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    if (isCached(tableName, id)) {
+        QueryResult result;
+        result.values.push_back(id);
+        result.isCachedId.push_back(true);
+        return result;
+    }
+    if (rowCache_.isEnabled()) {
+        return findWithRowCache(tableName, id);
+    }
+
+    std::vector<SqliteValue> args = { id };
+    auto statement = SqliteStatement(prepareQuery("select * from `" + tableName + "` where id == ? limit 1"));
+    bindArgs(statement.stmt, args);
+
+    QueryResult result;
+    if (getNextRowOrTrue(statement.stmt)) {
+        return result;
+    }
+    int columnCount = sqlite3_column_count(statement.stmt);
+    for (int i = 0; i < columnCount; i++) {
+        result.columnNames.push_back(sqlite3_column_name(statement.stmt, i));
+        result.values.push_back(columnValue(statement.stmt, i));
+    }
+    result.isCachedId.push_back(false);
+
+    markAsCached(tableName, id);
+    return result;
+}
+
+SqliteStatement Database::executeReadQuery(ReadConnection *reader, std::unique_lock<std::mutex> &lock, std::string &sql, std::vector<SqliteValue> &arguments, sqlite3_stmt *prepared) {
+    // NOTE: Prepared statements belong to the main connection, so they're only passed with the lock held
+    sqlite3_stmt *statement = prepared;
+    if (!statement && reader) {
+        statement = reader->prepareQuery(sql);
+        // NOTE: unsafeQueryRaw can be used for writes, and those can only be done on the main connection
+        if (!sqlite3_stmt_readonly(statement)) {
+            statement = nullptr;
+        }
+    }
+
+    if (!statement) {
+        if (!lock.owns_lock()) {
+            lock.lock();
+        }
+        statement = prepareQuery(sql);
+    }
+
+    bindArgs(statement, arguments);
+    return SqliteStatement(statement);
+}
+
+ReadQueryResult Database::cachedReadQuery(ReadConnection *reader, std::unique_lock<std::mutex> &lock, ReadQuery query, sqlite3_stmt *prepared) {
+    if (!usesQueryCache_) {
+        auto statement = executeReadQuery(reader, lock, query.sql, query.arguments, prepared);
+        return readResultOfKind(statement.stmt, query.kind);
+    }
+
+    bool wasLocked = lock.owns_lock();
+    if (!wasLocked) {
+        lock.lock();
+    }
+    auto key = QueryResultCache::keyFor(query);
+    if (auto cached = queryCache_.get(key)) {
+        return *cached;
+    }
+    auto version = queryCache_.version();
+    if (!wasLocked) {
+        lock.unlock();
+    }
+
+    auto statement = executeReadQuery(reader, lock, query.sql, query.arguments, prepared);
+    auto result = std::make_shared<ReadQueryResult>(readResultOfKind(statement.stmt, query.kind));
+
+    // NOTE: unsafe queries could make changes, so only results of read-only statements are cached
+    if (sqlite3_stmt_readonly(statement.stmt)) {
+        if (!lock.owns_lock()) {
+            lock.lock();
+        }
+        auto tables = queryTables_ ? queryTables_->tablesReadBy(query.sql) : std::nullopt;
+        if (tables) {
+            queryCache_.put(std::move(key), *tables, version, result);
+        }
+    }
+    return *result;
+}
+
+jsi::Value Database::cachedReadQueryToJsi(std::unique_lock<std::mutex> &lock, ReadQuery query, bool asArrays, sqlite3_stmt *prepared) {
+    auto &rt = getRt();
+    auto result = cachedReadQuery(nullptr, lock, query, prepared);
+    if (result.kind == ReadQueryKind::count) {
+        return jsi::Value(result.count);
+    } else if (result.kind == ReadQueryKind::ids) {
+        return idsToJsi(rt, result.rows);
+    }
+
+    if (result.kind == ReadQueryKind::records) {
+        replaceCachedRecords(query.table, result.rows);
+    }
+    return recordsToJsi(rt, result.rows, asArrays);
+}
+
+QueryResult Database::queryAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    return cachedReadQuery(reader, lock, { ReadQueryKind::records, "", sql, arguments }).rows;
+}
+
+void Database::applyRecordCache(std::string tableName, QueryResult &result) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    replaceCachedRecords(tableName, result);
+}
+
+void Database::replaceCachedRecords(std::string tableName, QueryResult &result) {
+    size_t columnCount = result.columnNames.size();
+    if (!columnCount) {
+        return;
+    }
+    assert(result.columnNames[0] == "id");
+
+    auto &cachedIds = cachedRecords_.table(tableName);
+    std::vector<SqliteValue> values;
+    values.reserve(result.values.size());
+    for (size_t row = 0, rowCount = result.isCachedId.size(); row < rowCount; row++) {
+        auto rowBegin = result.values.begin() + row * columnCount;
+        auto id = std::get_if<std::string>(&*rowBegin);
+        if (!id) {
+            throw DatabaseError("Failed to get ID of a record");
+        }
+
+        if (!cachedIds.insert(*id)) {
+            values.push_back(std::move(*id));
+            result.isCachedId[row] = true;
+        } else {
+            std::move(rowBegin, rowBegin + columnCount, std::back_inserter(values));
+        }
+    }
+    result.values = std::move(values);
+}
+
+QueryResult Database::queryIdsAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    return cachedReadQuery(reader, lock, { ReadQueryKind::ids, "", sql, arguments }).rows;
+}
+
+QueryResult Database::readQueryIdsResult(sqlite3_stmt *statement) {
+    QueryResult result;
+    while (true) {
+        if (getNextRowOrTrue(statement)) {
+            break;
+        }
+
+        assert(std::string(sqlite3_column_name(statement, 0)) == "id");
+
+        const char *idText = (const char *)sqlite3_column_text(statement, 0);
+        if (!idText) {
+            throw DatabaseError("Failed to get ID of a record");
+        }
+
+        result.values.push_back(std::string(idText));
+        result.isCachedId.push_back(true);
+    }
+    return result;
+}
+
+QueryResult Database::unsafeQueryRawAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    auto statement = executeReadQuery(reader, lock, sql, arguments);
+    return readQueryResult(statement.stmt);
+}
+
+std::vector<std::shared_ptr<LazyRow>> Database::unsafeQueryRawLazyAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    auto statement = executeReadQuery(reader, lock, sql, arguments);
+    return readLazyRows(statement.stmt);
+}
+
+int Database::countAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    return cachedReadQuery(reader, lock, { ReadQueryKind::count, "", sql, arguments }).count;
+}
+
+int Database::readCountResult(sqlite3_stmt *statement) {
+    getRow(statement);
+
+    assert(sqlite3_data_count(statement) == 1);
+    return sqlite3_column_int(statement, 0);
+}
+
+ReadQueryResult Database::readResultOfKind(sqlite3_stmt *statement, ReadQueryKind kind) {
+    ReadQueryResult result;
+    result.kind = kind;
+    if (kind == ReadQueryKind::count) {
+        result.count = readCountResult(statement);
+    } else if (kind == ReadQueryKind::ids) {
+        result.rows = readQueryIdsResult(statement);
+    } else {
+        result.rows = readQueryResult(statement);
+    }
+    return result;
+}
+
+std::vector<ReadQueryResult> Database::queryMany(ReadConnection *reader, std::vector<ReadQuery> &queries) {
+    // NOTE: Without a read connection, queries are executed on the main connection, with the lock held for all of
+    // them. All writes are made on that connection with the lock held, so that's consistent too
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    sqlite3 *db = reader ? reader->db.sqlite : db_->sqlite;
+    if (!reader) {
+        lock.lock();
+    }
+
+    auto execute = [&](const char *sql) {
+        if (sqlite3_exec(db, sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+            throw sqliteError(db, std::string("Failed to execute ") + sql);
+        }
+    };
+
+    std::vector<ReadQueryResult> results;
+    results.reserve(queries.size());
+    execute("begin");
+    try {
+        for (auto &query : queries) {
+            auto stmt = reader ? reader->prepareQuery(query.sql) : prepareQuery(query.sql);
+            SqliteStatement statement(stmt);
+            if (!sqlite3_stmt_readonly(stmt)) {
+                throw std::invalid_argument("Only reads can be executed with queryMany");
+            }
+            bindArgs(stmt, query.arguments);
+
+            results.push_back(readResultOfKind(stmt, query.kind));
+        }
+    } catch (const std::exception &) {
+        sqlite3_exec(db, "rollback", nullptr, nullptr, nullptr);
+        throw;
+    }
+    // NOTE: Nothing was written, so committing a read transaction only releases the snapshot
+    execute("commit");
+    return results;
+}
+
+void Database::applyRecordCache(std::vector<ReadQuery> &queries, std::vector<ReadQueryResult> &results) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].kind == ReadQueryKind::records) {
+            replaceCachedRecords(queries[i].table, results[i].rows);
+        }
+    }
+}
+
+void Database::batchJSONAsync(simdjson::padded_string &json) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    executeBatchJSON(json);
+}
+
+void Database::batchBinaryAsync(std::vector<uint8_t> &data) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    executeBatchBinary(data.data(), data.size());
+}
+
+std::optional<std::string> Database::getLocalAsync(std::string key) {
+    return getLocalMany({ key })[0];
+}
+
+} // namespace watermelondb
@@ -0,0 +1,338 @@
+#include "Database.h"
+
+namespace watermelondb {
+
+static std::string quotedTable(const std::string &table) {
+    std::string quoted = "\"";
+    for (char character : table) {
+        quoted += character;
+        if (character == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+// MARK: - Change capture
+
+void Database::enableChangeCapture() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    changeCapture_.attach(db_->sqlite);
+    changeCapture_.setCollectsChanges(true);
+}
+
+std::vector<ResolvedChangeSet> Database::drainChanges() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<ResolvedChangeSet> resolvedChanges;
+    for (auto &changeSet : changeCapture_.drain()) {
+        ResolvedChangeSet resolvedChangeSet;
+        for (auto &table : changeSet) {
+            auto &changes = resolvedChangeSet[table.first];
+            changes.ids = recordIdsByRowid(table.first, table.second);
+            changes.rows = std::move(table.second);
+        }
+        resolvedChanges.push_back(std::move(resolvedChangeSet));
+    }
+    return resolvedChanges;
+}
+
+// NOTE: Ids are read after the transaction, so rows that have since been deleted are skipped
+std::unordered_map<int64_t, std::string> Database::recordIdsByRowid(const std::string &table, TableChanges &changes) {
+    std::unordered_map<int64_t, std::string> ids;
+    if (changes.inserted.empty() && changes.updated.empty()) {
+        return ids;
+    }
+
+    auto rowids = std::make_shared<SqliteValueArray>();
+    for (auto rowid : changes.inserted) {
+        rowids->values.push_back(rowid);
+    }
+    for (auto rowid : changes.updated) {
+        rowids->values.push_back(rowid);
+    }
+
+    // NOTE: Table could have been dropped since (or it's not a table of records)
+    sqlite3_stmt *statement;
+    try {
+        statement = prepareQuery("select rowid, \"id\" from " + quotedTable(table) + " where rowid in watermelon_array(?)");
+    } catch (const std::exception &) {
+        return ids;
+    }
+
+    std::vector<SqliteValue> arguments = { rowids };
+    bindArgs(statement, arguments);
+    SqliteStatement statementReset(statement);
+    while (!getNextRowOrTrue(statement)) {
+        const char *id = (const char *)sqlite3_column_text(statement, 1);
+        if (id) {
+            ids[sqlite3_column_int64(statement, 0)] = id;
+        }
+    }
+    return ids;
+}
+
+jsi::Value Database::changesToJsi(jsi::Runtime &rt, std::vector<ResolvedChangeSet> &changes) {
+    auto rowidsToJsi = [&rt](std::vector<int64_t> &rowids) {
+        jsi::Array array(rt, rowids.size());
+        for (size_t i = 0; i < rowids.size(); i++) {
+            array.setValueAtIndex(rt, i, jsi::Value((double) rowids[i]));
+        }
+        return array;
+    };
+    auto idsToJsi = [&rt](std::vector<int64_t> &rowids, std::unordered_map<int64_t, std::string> &ids) {
+        std::vector<jsi::Value> values;
+        for (auto rowid : rowids) {
+            auto found = ids.find(rowid);
+            if (found != ids.end()) {
+                values.push_back(jsi::String::createFromUtf8(rt, found->second));
+            }
+        }
+        jsi::Array array(rt, values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            array.setValueAtIndex(rt, i, std::move(values[i]));
+        }
+        return array;
+    };
+
+    jsi::Array jsiChanges(rt, changes.size());
+    for (size_t i = 0; i < changes.size(); i++) {
+        jsi::Object changeSet(rt);
+        for (auto &table : changes[i]) {
+            auto &rows = table.second.rows;
+            auto &ids = table.second.ids;
+
+            jsi::Array deletedIds(rt, rows.deletedIds.size());
+            for (size_t j = 0; j < rows.deletedIds.size(); j++) {
+                deletedIds.setValueAtIndex(rt, j, jsi::String::createFromUtf8(rt, rows.deletedIds[j]));
+            }
+
+            jsi::Object tableChanges(rt);
+            tableChanges.setProperty(rt, "inserted", idsToJsi(rows.inserted, ids));
+            tableChanges.setProperty(rt, "updated", idsToJsi(rows.updated, ids));
+            tableChanges.setProperty(rt, "deleted", std::move(deletedIds));
+            tableChanges.setProperty(rt, "insertedRowids", rowidsToJsi(rows.inserted));
+            tableChanges.setProperty(rt, "updatedRowids", rowidsToJsi(rows.updated));
+            tableChanges.setProperty(rt, "deletedRowids", rowidsToJsi(rows.deleted));
+            changeSet.setProperty(rt, jsi::String::createFromUtf8(rt, table.first), std::move(tableChanges));
+        }
+        jsiChanges.setValueAtIndex(rt, i, std::move(changeSet));
+    }
+    return jsiChanges;
+}
+
+// MARK: - Live queries
+
+int Database::registerLiveQuery(std::string sql, std::vector<SqliteValue> arguments, std::vector<std::string> tables, LiveQueryKind kind) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    // NOTE: Dirty state is tracked using change capture hooks, so that changes not made by batch are noticed too
+    changeCapture_.attach(db_->sqlite);
+    return liveQueries_.add({ std::move(sql), std::move(arguments), std::move(tables), kind });
+}
+
+void Database::unregisterLiveQuery(int handle) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    liveQueries_.remove(handle);
+}
+
+std::vector<int> Database::drainDirtyQueries() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return liveQueries_.takeDirty();
+}
+
+std::vector<LiveQueryResult> Database::refreshDirtyQueries(ReadConnection *reader) {
+    std::vector<std::pair<int, LiveQuery>> queries;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        queries = liveQueries_.takeDirtyQueries();
+    }
+
+    // NOTE: Queries are executed without holding the lock (executeReadQuery locks the main connection if needed),
+    // so a change committed in the meantime marks the query as dirty again
+    std::vector<LiveQueryResult> results;
+    try {
+        for (auto &query : queries) {
+            LiveQueryResult result;
+            result.handle = query.first;
+            result.kind = query.second.kind;
+            if (query.second.kind == LiveQueryKind::count) {
+                result.count = countAsync(reader, query.second.sql, query.second.arguments);
+            } else {
+                auto ids = queryIdsAsync(reader, query.second.sql, query.second.arguments);
+                result.ids.reserve(ids.values.size());
+                for (auto &id : ids.values) {
+                    result.ids.push_back(std::move(std::get<std::string>(id)));
+                }
+            }
+            results.push_back(std::move(result));
+        }
+    } catch (const std::exception &) {
+        // NOTE: Results of queries executed so far are discarded, so they all have to be refreshed again
+        std::vector<int> handles;
+        for (auto &query : queries) {
+            handles.push_back(query.first);
+        }
+        const std::lock_guard<std::mutex> lock(mutex_);
+        liveQueries_.markDirty(handles);
+        throw;
+    }
+    return results;
+}
+
+void Database::diffLiveQueryResults(std::vector<LiveQueryResult> &results) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<LiveQueryResult> diffedResults;
+    for (auto &result : results) {
+        if (result.kind == LiveQueryKind::ids) {
+            auto diff = liveQueries_.updateIds(result.handle, std::move(result.ids));
+            result.ids = {};
+            if (!diff) {
+                continue; // unregistered in the meantime
+            }
+            result.diff = std::move(*diff);
+        }
+        diffedResults.push_back(std::move(result));
+    }
+    results = std::move(diffedResults);
+}
+
+jsi::Array Database::liveQueryResultsToJsi(jsi::Runtime &rt, std::vector<LiveQueryResult> &results) {
+    auto numbersToJsi = [&rt](std::vector<int> &numbers) {
+        jsi::Array array(rt, numbers.size());
+        for (size_t i = 0; i < numbers.size(); i++) {
+            array.setValueAtIndex(rt, i, jsi::Value(numbers[i]));
+        }
+        return array;
+    };
+
+    jsi::Array jsiResults(rt, results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        auto &result = results[i];
+        jsi::Object jsiResult(rt);
+        jsiResult.setProperty(rt, "handle", jsi::Value(result.handle));
+        if (result.kind == LiveQueryKind::count) {
+            jsiResult.setProperty(rt, "count", jsi::Value(result.count));
+        } else {
+            auto &diff = result.diff;
+            jsi::Array insertedIds(rt, diff.insertedIds.size());
+            for (size_t j = 0; j < diff.insertedIds.size(); j++) {
+                insertedIds.setValueAtIndex(rt, j, jsi::String::createFromUtf8(rt, diff.insertedIds[j]));
+            }
+
+            jsi::Object jsiDiff(rt);
+            jsiDiff.setProperty(rt, "length", jsi::Value((double) diff.length));
+            jsiDiff.setProperty(rt, "insertedIds", std::move(insertedIds));
+            jsiDiff.setProperty(rt, "insertedPositions", numbersToJsi(diff.insertedPositions));
+            jsiDiff.setProperty(rt, "removedPositions", numbersToJsi(diff.removedPositions));
+            jsiDiff.setProperty(rt, "movedRanges", numbersToJsi(diff.movedRanges));
+            jsiResult.setProperty(rt, "diff", std::move(jsiDiff));
+        }
+        jsiResults.setValueAtIndex(rt, i, std::move(jsiResult));
+    }
+    return jsiResults;
+}
+
+// MARK: - Observation matchers
+
+int Database::registerMatcher(std::string table, std::string whereJson) {
+    auto matcher = ObservationMatcher::compile(std::move(table), whereJson);
+    const std::lock_guard<std::mutex> lock(mutex_);
+    changeCapture_.attach(db_->sqlite);
+    return matchers_.add(std::move(matcher));
+}
+
+void Database::unregisterMatcher(int handle) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    matchers_.remove(handle);
+}
+
+std::vector<MatcherChanges> Database::matchChangedRows() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<MatcherChanges> matches;
+    for (auto &table : matchers_.takeChangedRows()) {
+        auto matchers = matchers_.matchersOf(table.first);
+        if (matchers.empty()) {
+            continue;
+        }
+
+        auto &changes = table.second;
+        std::vector<MatcherChanges> tableMatches;
+        for (auto &matcher : matchers) {
+            tableMatches.push_back({ matcher.first, {}, {}, changes.hasUnknownDeletions });
+        }
+
+        std::unordered_set<std::string> existingIds;
+        if (!changes.rowids.empty()) {
+            auto rowids = std::make_shared<SqliteValueArray>();
+            for (auto rowid : changes.rowids) {
+                rowids->values.push_back(rowid);
+            }
+
+            // NOTE: Table could have been dropped since
+            sqlite3_stmt *statement;
+            try {
+                statement = prepareQuery("select * from " + quotedTable(table.first) + " where rowid in watermelon_array(?)");
+            } catch (const std::exception &) {
+                continue;
+            }
+            std::vector<SqliteValue> arguments = { rowids };
+            bindArgs(statement, arguments);
+            SqliteStatement statementReset(statement);
+
+            // Columns of each matcher are looked up by name once per table, not per row
+            std::unordered_map<std::string, int> statementColumns;
+            int columnCount = sqlite3_column_count(statement);
+            for (int i = 0; i < columnCount; i++) {
+                statementColumns[sqlite3_column_name(statement, i)] = i;
+            }
+            int idColumn = statementColumns.count("id") ? statementColumns["id"] : -1;
+            if (idColumn == -1) {
+                continue; // not a table of records
+            }
+
+            std::vector<std::vector<int>> columnIndexes;
+            for (auto &matcher : matchers) {
+                std::vector<int> indexes;
+                for (auto const &column : matcher.second->columns()) {
+                    auto found = statementColumns.find(column);
+                    indexes.push_back(found == statementColumns.end() ? -1 : found->second);
+                }
+                columnIndexes.push_back(std::move(indexes));
+            }
+
+            std::vector<SqliteValue> row(columnCount);
+            while (!getNextRowOrTrue(statement)) {
+                for (int i = 0; i < columnCount; i++) {
+                    row[i] = columnValue(statement, i);
+                }
+                auto id = std::get_if<std::string>(&row[idColumn]);
+                if (!id) {
+                    continue;
+                }
+                existingIds.insert(*id);
+                for (size_t i = 0; i < matchers.size(); i++) {
+                    auto &ids = matchers[i].second->matches(row, columnIndexes[i]) ?
+                        tableMatches[i].matchingIds : tableMatches[i].unmatchedIds;
+                    ids.push_back(*id);
+                }
+            }
+        }
+
+        // NOTE: A record could have been deleted, and then created again with the same id
+        for (auto const &id : changes.deletedIds) {
+            if (existingIds.count(id)) {
+                continue;
+            }
+            for (auto &match : tableMatches) {
+                match.unmatchedIds.push_back(id);
+            }
+        }
+
+        std::move(tableMatches.begin(), tableMatches.end(), std::back_inserter(matches));
+    }
+    return matches;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,138 @@
+#include "Database.h"
+#include <cstring>
+
+namespace watermelondb {
+
+// MARK: - Reading
+
+ColumnarResult Database::readColumnarResult(sqlite3_stmt *statement) {
+    ColumnarResult result;
+    int columnCount = sqlite3_column_count(statement);
+    result.columns.resize(columnCount);
+    for (int i = 0; i < columnCount; i++) {
+        const char *column = sqlite3_column_name(statement, i);
+        assert(column);
+        result.columns[i].name = column;
+    }
+
+    std::unordered_map<std::string, int32_t> stringIndexes;
+    std::string key; // NOTE: reused, so that looking up strings already in the table doesn't allocate
+
+    size_t row = 0;
+    while (!getNextRowOrTrue(statement)) {
+        for (int i = 0; i < columnCount; i++) {
+            auto &column = result.columns[i];
+
+            // NOTE: Arrays are only allocated if a column has values of their type, and are filled in lazily
+            // (vector::resize grows geometrically, so it's amortized constant time)
+            auto type = sqlite3_column_type(statement, i);
+            if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) {
+                column.numbers.resize(row + 1, 0);
+                column.numbers[row] = sqlite3_column_double(statement, i);
+            } else if (type == SQLITE_TEXT) {
+                const char *text = (const char *)sqlite3_column_text(statement, i);
+                key.assign(text, sqlite3_column_bytes(statement, i));
+
+                int32_t index;
+                auto found = stringIndexes.find(key);
+                if (found != stringIndexes.end()) {
+                    index = found->second;
+                } else {
+                    index = (int32_t) result.strings.size();
+                    result.strings.push_back(key);
+                    stringIndexes.emplace(key, index);
+                }
+
+                column.strings.resize(row + 1, -1);
+                column.strings[row] = index;
+            } else if (type == SQLITE_NULL) {
+                column.nulls.resize(row / 8 + 1, 0);
+                column.nulls[row / 8] |= 1 << (row % 8);
+            } else {
+                throw DatabaseError("Unable to fetch record from database - unknown column type (WatermelonDB does not support blobs or custom sqlite types");
+            }
+        }
+        row++;
+    }
+
+    result.rowCount = row;
+    for (auto &column : result.columns) {
+        if (!column.numbers.empty()) {
+            column.numbers.resize(row, 0);
+        }
+        if (!column.strings.empty()) {
+            column.strings.resize(row, -1);
+        }
+        if (!column.nulls.empty()) {
+            column.nulls.resize((row + 7) / 8, 0);
+        }
+    }
+
+    return result;
+}
+
+// MARK: - Conversion to JS
+
+// NOTE: RN 0.63's JSI can't wrap native memory in an ArrayBuffer (no jsi::MutableBuffer), so the buffer
+// is allocated by JS, and then filled in place
+jsi::Value typedArrayFromStd(jsi::Runtime &rt, jsi::Function &arrayBufferConstructor, jsi::Function &typedArrayConstructor, const void *data, size_t byteLength) {
+    jsi::Object buffer = arrayBufferConstructor.callAsConstructor(rt, (double) byteLength).getObject(rt);
+    if (byteLength) {
+        std::memcpy(buffer.getArrayBuffer(rt).data(rt), data, byteLength);
+    }
+    return typedArrayConstructor.callAsConstructor(rt, buffer);
+}
+
+jsi::Value Database::columnarResultToJsi(jsi::Runtime &rt, ColumnarResult &result) {
+    auto global = rt.global();
+    auto arrayBufferConstructor = global.getPropertyAsFunction(rt, "ArrayBuffer");
+    auto float64ArrayConstructor = global.getPropertyAsFunction(rt, "Float64Array");
+    auto int32ArrayConstructor = global.getPropertyAsFunction(rt, "Int32Array");
+    auto uint8ArrayConstructor = global.getPropertyAsFunction(rt, "Uint8Array");
+
+    jsi::Array columns(rt, result.columns.size());
+    for (size_t i = 0; i < result.columns.size(); i++) {
+        auto &column = result.columns[i];
+        jsi::Object jsiColumn(rt);
+        jsiColumn.setProperty(rt, "name", jsi::String::createFromUtf8(rt, column.name));
+        jsiColumn.setProperty(rt, "numbers", column.numbers.empty() ? jsi::Value::null() :
+            typedArrayFromStd(rt, arrayBufferConstructor, float64ArrayConstructor, column.numbers.data(), column.numbers.size() * sizeof(double)));
+        jsiColumn.setProperty(rt, "strings", column.strings.empty() ? jsi::Value::null() :
+            typedArrayFromStd(rt, arrayBufferConstructor, int32ArrayConstructor, column.strings.data(), column.strings.size() * sizeof(int32_t)));
+        jsiColumn.setProperty(rt, "nulls", column.nulls.empty() ? jsi::Value::null() :
+            typedArrayFromStd(rt, arrayBufferConstructor, uint8ArrayConstructor, column.nulls.data(), column.nulls.size()));
+        columns.setValueAtIndex(rt, i, std::move(jsiColumn));
+    }
+
+    jsi::Array strings(rt, result.strings.size());
+    for (size_t i = 0; i < result.strings.size(); i++) {
+        strings.setValueAtIndex(rt, i, jsi::String::createFromUtf8(rt, result.strings[i]));
+    }
+
+    jsi::Object jsiResult(rt);
+    jsiResult.setProperty(rt, "rowCount", (double) result.rowCount);
+    jsiResult.setProperty(rt, "columns", std::move(columns));
+    jsiResult.setProperty(rt, "strings", std::move(strings));
+    return jsiResult;
+}
+
+// MARK: - Queries
+
+jsi::Value Database::queryColumnar(jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    ColumnarResult result;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        auto statement = executeQuery(sql.utf8(rt), arguments);
+        result = readColumnarResult(statement.stmt);
+    }
+    return columnarResultToJsi(rt, result);
+}
+
+ColumnarResult Database::queryColumnarAsync(ReadConnection *reader, std::string sql, std::vector<SqliteValue> arguments) {
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    auto statement = executeReadQuery(reader, lock, sql, arguments);
+    return readColumnarResult(statement.stmt);
+}
+
+} // namespace watermelondb
@@ -28,6 +28,8 @@ jsi::Value runBlock(facebook::jsi::Runtime &rt, std::function<jsi::Value(void)>
             retValue = block();
         } catch (const jsi::JSError &error) {
             retValue = makeError(rt, error.getMessage());
+        } catch (const DatabaseError &error) {
+            retValue = makeError(rt, error.what());
         } catch (const std::exception &ex) {
             std::string exceptionString("Exception in HostFunction: ");
             exceptionString += ex.what();
@@ -37,7 +39,11 @@ jsi::Value runBlock(facebook::jsi::Runtime &rt, std::function<jsi::Value(void)>
             retValue = makeError(rt, exceptionString);
         }
         #else
-        retValue = block();
+        try {
+            retValue = block();
+        } catch (const DatabaseError &error) {
+            throw jsi::JSError(rt, error.what());
+        }
         #endif
     });
     return retValue;
@@ -65,16 +71,200 @@ void createMethod(jsi::Runtime &runtime, jsi::Object &object, const char *method
     object.setProperty(runtime, name, function);
 }
 
-void Database::install(jsi::Runtime *runtime) {
+// Durability hint of a batch - 'full', 'normal', 'deferred', or null/undefined for connection's default
+std::optional<Durability> durabilityFromJsi(jsi::Runtime &rt, const jsi::Value &value) {
+    if (value.isNull() || value.isUndefined()) {
+        return std::nullopt;
+    }
+    auto durability = value.getString(rt).utf8(rt);
+    if (durability == "full") {
+        return Durability::full;
+    } else if (durability == "normal") {
+        return Durability::normal;
+    } else if (durability == "deferred") {
+        return Durability::deferred;
+    }
+    throw jsi::JSError(rt, "Invalid batch durability: " + durability);
+}
+
+std::string errorMessage(const std::exception &ex) {
+    if (auto jsError = dynamic_cast<const jsi::JSError *>(&ex)) {
+        return jsError->getMessage();
+    }
+    return ex.what();
+}
+
+// Async methods return a Promise. `func` is called on the JS thread to read arguments, and returns a block of
+// native work, which is executed on the database's worker thread (and must not touch JS runtime). That block
+// returns another block, which converts the result to a JS value back on the JS thread.
+// Async read methods work the same way, except that native work is split in two: the first block is executed
+// on a read connection, in parallel with other reads, and the block it returns is then executed in order of dispatch
+using AsyncMarshaller = std::function<jsi::Value(jsi::Runtime &rt)>;
+using AsyncWork = std::function<AsyncMarshaller(void)>;
+using AsyncReadWork = std::function<AsyncWork(ReadConnection *reader)>;
+using jsiAsyncFunction = std::function<AsyncWork(jsi::Runtime &rt, const jsi::Value *args)>;
+using jsiAsyncReadFunction = std::function<AsyncReadWork(jsi::Runtime &rt, const jsi::Value *args)>;
+
+struct PromiseCallbacks {
+    jsi::Function resolve;
+    jsi::Function reject;
+};
+
+struct AsyncOutcome {
+    AsyncMarshaller marshal;
+    std::optional<std::string> error;
+
+    void run(std::function<void(void)> block) {
+        if (error) {
+            return;
+        }
+        try {
+            block();
+        } catch (const std::exception &ex) {
+            error = ex.what();
+        }
+    }
+};
+
+static const char *databaseClosedError = "Database is closed";
+
+jsi::Value createPromise(jsi::Runtime &rt, std::shared_ptr<PromiseCallbacks> &callbacks) {
+    auto executor = jsi::Function::createFromHostFunction(rt, jsi::PropNameID::forAscii(rt, "executor"), 2,
+        [&callbacks](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *args, size_t count) {
+            callbacks = std::make_shared<PromiseCallbacks>(PromiseCallbacks {
+                args[0].getObject(rt).getFunction(rt),
+                args[1].getObject(rt).getFunction(rt),
+            });
+            return jsi::Value::undefined();
+        });
+    jsi::Value promise = rt.global().getPropertyAsFunction(rt, "Promise").callAsConstructor(rt, executor);
+    assert(callbacks);
+    return promise;
+}
+
+// Returns a block that settles the promise with the outcome of async work, to be called on the JS thread
+std::function<void(void)> promiseSettler(jsi::Runtime &rt, std::shared_ptr<PromiseCallbacks> callbacks, std::shared_ptr<AsyncOutcome> outcome) {
+    jsi::Runtime *runtime = &rt;
+    return [runtime, callbacks, outcome]() {
+        auto &rt = *runtime;
+        watermelonCallWithJSCLockHolder(rt, [&]() {
+            if (outcome->error) {
+                callbacks->reject.call(rt, makeError(rt, *outcome->error));
+                return;
+            }
+            try {
+                callbacks->resolve.call(rt, outcome->marshal(rt));
+            } catch (const std::exception &ex) {
+                callbacks->reject.call(rt, makeError(rt, errorMessage(ex)));
+            }
+        });
+    };
+}
+
+void createAsyncMethod(jsi::Runtime &runtime, jsi::Object &object, std::shared_ptr<Database> database, const char *methodName, unsigned int argCount, jsiAsyncFunction func) {
+    createMethod(runtime, object, methodName, argCount, [database, func](jsi::Runtime &rt, const jsi::Value *args) {
+        std::shared_ptr<PromiseCallbacks> callbacks;
+        jsi::Value promise = createPromise(rt, callbacks);
+
+        AsyncWork work;
+        try {
+            work = func(rt, args);
+        } catch (const std::exception &ex) {
+            callbacks->reject.call(rt, makeError(rt, errorMessage(ex)));
+            return promise;
+        }
+
+        auto outcome = std::make_shared<AsyncOutcome>();
+        bool isDispatched = database->dispatchAsync([work = std::move(work), outcome]() {
+            outcome->run([&]() {
+                outcome->marshal = work();
+            });
+        }, promiseSettler(rt, callbacks, outcome));
+        if (!isDispatched) {
+            callbacks->reject.call(rt, makeError(rt, databaseClosedError));
+        }
+        return promise;
+    });
+}
+
+// Like createAsyncMethod, but for batches - work may be coalesced with other writes into one transaction
+// (see Database::configureWriteCoalescing), and the promise is only settled after it's committed.
+// If durabilityArgument is not -1, it's the index of the batch's durability hint (see durabilityFromJsi)
+void createAsyncWriteMethod(jsi::Runtime &runtime, jsi::Object &object, std::shared_ptr<Database> database, const char *methodName, unsigned int argCount, jsiAsyncFunction func, int durabilityArgument = -1) {
+    createMethod(runtime, object, methodName, argCount, [database, func, durabilityArgument](jsi::Runtime &rt, const jsi::Value *args) {
+        std::shared_ptr<PromiseCallbacks> callbacks;
+        jsi::Value promise = createPromise(rt, callbacks);
+
+        AsyncWork work;
+        std::optional<Durability> durability;
+        try {
+            if (durabilityArgument != -1) {
+                durability = durabilityFromJsi(rt, args[durabilityArgument]);
+            }
+            work = func(rt, args);
+        } catch (const std::exception &ex) {
+            callbacks->reject.call(rt, makeError(rt, errorMessage(ex)));
+            return promise;
+        }
+
+        auto outcome = std::make_shared<AsyncOutcome>();
+        bool isDispatched = database->dispatchAsyncWrite(durability, [work = std::move(work), outcome]() {
+            outcome->run([&]() {
+                outcome->marshal = work();
+            });
+        }, [outcome](const std::string &error) {
+            if (!outcome->error) {
+                outcome->error = error;
+            }
+        }, promiseSettler(rt, callbacks, outcome));
+        if (!isDispatched) {
+            callbacks->reject.call(rt, makeError(rt, databaseClosedError));
+        }
+        return promise;
+    });
+}
+
+void createAsyncReadMethod(jsi::Runtime &runtime, jsi::Object &object, std::shared_ptr<Database> database, const char *methodName, unsigned int argCount, jsiAsyncReadFunction func) {
+    createMethod(runtime, object, methodName, argCount, [database, func](jsi::Runtime &rt, const jsi::Value *args) {
+        std::shared_ptr<PromiseCallbacks> callbacks;
+        jsi::Value promise = createPromise(rt, callbacks);
+
+        AsyncReadWork read;
+        try {
+            read = func(rt, args);
+        } catch (const std::exception &ex) {
+            callbacks->reject.call(rt, makeError(rt, errorMessage(ex)));
+            return promise;
+        }
+
+        auto outcome = std::make_shared<AsyncOutcome>();
+        auto complete = std::make_shared<AsyncWork>();
+        bool isDispatched = database->dispatchAsyncRead([read = std::move(read), outcome, complete](ReadConnection *reader) {
+            outcome->run([&]() {
+                *complete = read(reader);
+            });
+        }, [outcome, complete]() {
+            outcome->run([&]() {
+                outcome->marshal = (*complete)();
+            });
+        }, promiseSettler(rt, callbacks, outcome));
+        if (!isDispatched) {
+            callbacks->reject.call(rt, makeError(rt, databaseClosedError));
+        }
+        return promise;
+    });
+}
+
+void Database::install(jsi::Runtime *runtime, std::shared_ptr<react::CallInvoker> jsCallInvoker) {
     jsi::Runtime &rt = *runtime;
     auto globalObject = rt.global();
-    createMethod(rt, globalObject, "nativeWatermelonCreateAdapter", 2, [runtime](jsi::Runtime &rt, const jsi::Value *args) {
+    createMethod(rt, globalObject, "nativeWatermelonCreateAdapter", 2, [runtime, jsCallInvoker](jsi::Runtime &rt, const jsi::Value *args) {
         std::string dbPath = args[0].getString(rt).utf8(rt);
         bool usesExclusiveLocking = args[1].getBool();
 
         jsi::Object adapter(rt);
 
-        std::shared_ptr<Database> database = std::make_shared<Database>(runtime, dbPath, usesExclusiveLocking);
+        std::shared_ptr<Database> database = std::make_shared<Database>(runtime, dbPath, usesExclusiveLocking, jsCallInvoker);
         adapter.setProperty(rt, "database", jsi::Object::createFromHostObject(rt, database));
 
         // FIXME: Important hack!
@@ -127,7 +317,17 @@ void Database::install(jsi::Runtime *runtime) {
             }
         });
 
-        createMethod(rt, adapter, "initialize", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        // NOTE: Synchronous methods wait for previously dispatched async work, so that all calls are executed
+        // in order. Methods that don't read or write data (stats and configuration) don't need to be ordered, so
+        // they're created with createMethod, and don't block JS thread until async work is done
+        auto createSyncMethod = [&rt, &adapter, database](const char *methodName, unsigned int argCount, jsiFunction func) {
+            createMethod(rt, adapter, methodName, argCount, [database, func](jsi::Runtime &rt, const jsi::Value *args) {
+                database->waitForAsyncWork();
+                return func(rt, args);
+            });
+        };
+
+        createSyncMethod("initialize", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             jsi::String dbName = args[0].getString(rt);
             int expectedVersion = (int)args[1].getNumber();
 
@@ -151,7 +351,7 @@ void Database::install(jsi::Runtime *runtime) {
 
             return response;
         });
-        createMethod(rt, adapter, "setUpWithSchema", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("setUpWithSchema", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
             jsi::String dbName = args[0].getString(rt);
             jsi::String schema = args[1].getString(rt);
             int schemaVersion = (int)args[2].getNumber();
@@ -166,7 +366,7 @@ void Database::install(jsi::Runtime *runtime) {
             database->initialized_ = true;
             return jsi::Value::undefined();
         });
-        createMethod(rt, adapter, "setUpWithMigrations", 4, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("setUpWithMigrations", 4, [database](jsi::Runtime &rt, const jsi::Value *args) {
             jsi::String dbName = args[0].getString(rt);
             jsi::String migrationSchema = args[1].getString(rt);
             int fromVersion = (int)args[2].getNumber();
@@ -182,61 +382,179 @@ void Database::install(jsi::Runtime *runtime) {
             database->initialized_ = true;
             return jsi::Value::undefined();
         });
-        createMethod(rt, adapter, "find", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("find", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String tableName = args[0].getString(rt);
             jsi::String id = args[1].getString(rt);
             return database->find(tableName, id);
         });
-        createMethod(rt, adapter, "query", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("findMany", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::Array requests = args[0].getObject(rt).getArray(rt);
+            auto results = database->findMany(Database::findRequestsFromJsi(rt, requests));
+            return Database::foundRecordsToJsi(rt, results);
+        });
+        createSyncMethod("queryMany", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::Array queries = args[0].getObject(rt).getArray(rt);
+            auto readQueries = Database::readQueriesFromJsi(rt, queries);
+            auto results = database->queryMany(nullptr, readQueries);
+            database->applyRecordCache(readQueries, results);
+            return Database::readQueryResultsToJsi(rt, results);
+        });
+        createSyncMethod("query", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String tableName = args[0].getString(rt);
             jsi::String sql = args[1].getString(rt);
             jsi::Array arguments = args[2].getObject(rt).getArray(rt);
             return database->query(tableName, sql, arguments);
         });
-        createMethod(rt, adapter, "queryAsArray", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("queryAsArray", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String tableName = args[0].getString(rt);
             jsi::String sql = args[1].getString(rt);
             jsi::Array arguments = args[2].getObject(rt).getArray(rt);
             return database->queryAsArray(tableName, sql, arguments);
         });
-        createMethod(rt, adapter, "queryIds", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("queryIds", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String sql = args[0].getString(rt);
             jsi::Array arguments = args[1].getObject(rt).getArray(rt);
             return database->queryIds(sql, arguments);
         });
-        createMethod(rt, adapter, "unsafeQueryRaw", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("unsafeQueryRaw", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String sql = args[0].getString(rt);
             jsi::Array arguments = args[1].getObject(rt).getArray(rt);
             return database->unsafeQueryRaw(sql, arguments);
         });
-        createMethod(rt, adapter, "count", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("count", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String sql = args[0].getString(rt);
             jsi::Array arguments = args[1].getObject(rt).getArray(rt);
             return database->count(sql, arguments);
         });
-        createMethod(rt, adapter, "batch", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("queryAsJSON", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::String tableName = args[0].getString(rt);
+            jsi::String sql = args[1].getString(rt);
+            jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+            return database->queryAsJson(tableName, sql, arguments);
+        });
+        createSyncMethod("unsafeQueryRawLazy", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::String sql = args[0].getString(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            return database->unsafeQueryRawLazy(sql, arguments);
+        });
+        createSyncMethod("queryColumnar", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::String sql = args[0].getString(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            return database->queryColumnar(sql, arguments);
+        });
+        createSyncMethod("prepare", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::String sql = args[0].getString(rt);
+            return jsi::Value(database->prepare(sql));
+        });
+        createSyncMethod("release", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            database->release((int)args[0].getNumber());
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("executeQuery", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::String tableName = args[1].getString(rt);
+            jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+            return database->executeQuery(handle, tableName, arguments);
+        });
+        createSyncMethod("executeQueryAsArray", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::String tableName = args[1].getString(rt);
+            jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+            return database->executeQueryAsArray(handle, tableName, arguments);
+        });
+        createSyncMethod("executeQueryAsJSON", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::String tableName = args[1].getString(rt);
+            jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+            return database->executeQueryAsJson(handle, tableName, arguments);
+        });
+        createSyncMethod("executeQueryIds", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            return database->executeQueryIds(handle, arguments);
+        });
+        createSyncMethod("executeUnsafeQueryRaw", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            return database->executeUnsafeQueryRaw(handle, arguments);
+        });
+        createSyncMethod("executeCount", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            int handle = (int)args[0].getNumber();
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            return database->executeCount(handle, arguments);
+        });
+        createSyncMethod("batch", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::Array operations = args[0].getObject(rt).getArray(rt);
             database->batch(operations);
             return jsi::Value::undefined();
         });
-        createMethod(rt, adapter, "batchJSON", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("batchJSON", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             database->batchJSON(args[0].getString(rt));
             return jsi::Value::undefined();
         });
-        createMethod(rt, adapter, "getLocal", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("batchBinary", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::ArrayBuffer buffer = args[0].getObject(rt).getArrayBuffer(rt);
+            database->batchBinary(buffer.data(rt), buffer.size(rt));
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("registerSchema", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::Object schema = args[0].getObject(rt);
+            database->registerSchema(schema, args[1].getString(rt).utf8(rt), args[2].getString(rt).utf8(rt));
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("batchRecords", 3, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            jsi::Array operations = args[0].getObject(rt).getArray(rt);
+            database->batchRecords(operations, args[1].getBool(), durabilityFromJsi(rt, args[2]));
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("getLocal", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String key = args[0].getString(rt);
             return database->getLocal(key);
         });
-        createMethod(rt, adapter, "unsafeLoadFromSync", 4, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("getLocalMany", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto values = database->getLocalMany(Database::stringsFromJsi(rt, args[0].getObject(rt).getArray(rt)));
+            return Database::localValuesToJsi(rt, values);
+        });
+        createSyncMethod("setLocal", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto key = args[0].getString(rt).utf8(rt);
+            auto value = args[1].getString(rt).utf8(rt);
+            database->setLocal(key, value);
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("removeLocal", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto key = args[0].getString(rt).utf8(rt);
+            database->removeLocal(key);
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("unsafeLoadFromSync", 4, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             auto jsonId = (int) args[0].getNumber();
             auto schema = args[1].getObject(rt);
@@ -244,13 +562,13 @@ void Database::install(jsi::Runtime *runtime) {
             auto postamble = args[3].getString(rt).utf8(rt);
             return database->unsafeLoadFromSync(jsonId, schema, preamble, postamble);
         });
-        createMethod(rt, adapter, "unsafeExecuteMultiple", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("unsafeExecuteMultiple", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             auto sqlString = args[0].getString(rt).utf8(rt);
             database->executeMultiple(sqlString);
             return jsi::Value::undefined();
         });
-        createMethod(rt, adapter, "unsafeResetDatabase", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("unsafeResetDatabase", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             jsi::String schema = args[0].getString(rt);
             int schemaVersion = (int)args[1].getNumber();
@@ -264,13 +582,423 @@ void Database::install(jsi::Runtime *runtime) {
                 std::abort();
             }
         });
-        createMethod(rt, adapter, "unsafeClose", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+        createSyncMethod("enableChangeCapture", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            database->enableChangeCapture();
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("drainChanges", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto changes = database->drainChanges();
+            return Database::changesToJsi(rt, changes);
+        });
+        createSyncMethod("registerLiveQuery", 4, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            jsi::Array jsiTables = args[2].getObject(rt).getArray(rt);
+            auto kind = args[3].getString(rt).utf8(rt);
+
+            std::vector<std::string> tables;
+            for (size_t i = 0, len = jsiTables.size(rt); i < len; i++) {
+                tables.push_back(jsiTables.getValueAtIndex(rt, i).getString(rt).utf8(rt));
+            }
+            if (kind != "ids" && kind != "count") {
+                throw jsi::JSError(rt, "Invalid live query kind");
+            }
+            auto liveQueryKind = kind == "count" ? LiveQueryKind::count : LiveQueryKind::ids;
+            return jsi::Value(database->registerLiveQuery(sql, Database::argsFromJsi(rt, arguments), tables, liveQueryKind));
+        });
+        createSyncMethod("unregisterLiveQuery", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            database->unregisterLiveQuery((int)args[0].getNumber());
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("drainDirtyQueries", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto handles = database->drainDirtyQueries();
+            jsi::Array jsiHandles(rt, handles.size());
+            for (size_t i = 0; i < handles.size(); i++) {
+                jsiHandles.setValueAtIndex(rt, i, jsi::Value(handles[i]));
+            }
+            return jsiHandles;
+        });
+        createSyncMethod("refreshDirtyQueries", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto results = database->refreshDirtyQueries(nullptr);
+            database->diffLiveQueryResults(results);
+            return Database::liveQueryResultsToJsi(rt, results);
+        });
+        createSyncMethod("registerMatcher", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto table = args[0].getString(rt).utf8(rt);
+            auto whereJson = args[1].getString(rt).utf8(rt);
+            return jsi::Value(database->registerMatcher(table, whereJson));
+        });
+        createSyncMethod("unregisterMatcher", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            database->unregisterMatcher((int)args[0].getNumber());
+            return jsi::Value::undefined();
+        });
+        createSyncMethod("matchChangedRows", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto matches = database->matchChangedRows();
+            auto idsToJsi = [&rt](const std::vector<std::string> &ids) {
+                jsi::Array jsiIds(rt, ids.size());
+                for (size_t i = 0; i < ids.size(); i++) {
+                    jsiIds.setValueAtIndex(rt, i, jsi::String::createFromUtf8(rt, ids[i]));
+                }
+                return jsiIds;
+            };
+            jsi::Array jsiMatches(rt, matches.size());
+            for (size_t i = 0; i < matches.size(); i++) {
+                jsi::Object match(rt);
+                match.setProperty(rt, "handle", jsi::Value(matches[i].handle));
+                match.setProperty(rt, "ids", idsToJsi(matches[i].matchingIds));
+                match.setProperty(rt, "unmatchedIds", idsToJsi(matches[i].unmatchedIds));
+                match.setProperty(rt, "hasUnknownDeletions", jsi::Value(matches[i].hasUnknownDeletions));
+                jsiMatches.setValueAtIndex(rt, i, std::move(match));
+            }
+            return jsiMatches;
+        });
+        createSyncMethod("evictCachedRecords", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto tableName = args[0].getString(rt).utf8(rt);
+            jsi::Array jsiIds = args[1].getObject(rt).getArray(rt);
+            std::vector<std::string> ids;
+            for (size_t i = 0, len = jsiIds.size(rt); i < len; i++) {
+                ids.push_back(jsiIds.getValueAtIndex(rt, i).getString(rt).utf8(rt));
+            }
+            return jsi::Value((double) database->evictCachedRecords(tableName, ids));
+        });
+        createMethod(rt, adapter, "getRecordCacheStats", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto stats = database->recordCacheStats();
+
+            jsi::Object response(rt);
+            response.setProperty(rt, "tables", (double) stats.tables);
+            response.setProperty(rt, "records", (double) stats.records);
+            response.setProperty(rt, "memoryUsed", (double) stats.memoryUsed);
+            return response;
+        });
+        createMethod(rt, adapter, "configureRowCache", 2, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto maxCount = args[0].getNumber();
+            auto maxMemory = args[1].getNumber();
+            if (maxCount < 0 || maxMemory < 0) {
+                throw jsi::JSError(rt, "Invalid row cache limits");
+            }
+            database->configureRowCache((size_t) maxCount, (size_t) maxMemory);
+            return jsi::Value::undefined();
+        });
+        createMethod(rt, adapter, "getRowCacheStats", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto stats = database->rowCacheStats();
+            uint64_t lookups = stats.hits + stats.misses;
+
+            jsi::Object response(rt);
+            response.setProperty(rt, "hits", (double) stats.hits);
+            response.setProperty(rt, "misses", (double) stats.misses);
+            response.setProperty(rt, "hitRate", lookups ? (double) stats.hits / lookups : 0.0);
+            response.setProperty(rt, "evictions", (double) stats.evictions);
+            response.setProperty(rt, "invalidations", (double) stats.invalidations);
+            response.setProperty(rt, "rows", (double) stats.rows);
+            response.setProperty(rt, "memoryUsed", (double) stats.memoryUsed);
+            return response;
+        });
+        createMethod(rt, adapter, "configureQueryCache", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            assert(database->initialized_);
+            auto maxMemory = args[0].getNumber();
+            if (maxMemory < 0) {
+                throw jsi::JSError(rt, "Invalid query cache size");
+            }
+            database->configureQueryCache((size_t) maxMemory);
+            return jsi::Value::undefined();
+        });
+        createMethod(rt, adapter, "configureWriteCoalescing", 1, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto windowMs = args[0].getNumber();
+            if (windowMs < 0) {
+                throw jsi::JSError(rt, "Invalid write coalescing window");
+            }
+            database->configureWriteCoalescing((int) windowMs);
+            return jsi::Value::undefined();
+        });
+        createMethod(rt, adapter, "getQueryCacheStats", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto stats = database->queryCacheStats();
+            uint64_t lookups = stats.hits + stats.misses;
+
+            jsi::Object response(rt);
+            response.setProperty(rt, "hits", (double) stats.hits);
+            response.setProperty(rt, "misses", (double) stats.misses);
+            response.setProperty(rt, "hitRate", lookups ? (double) stats.hits / lookups : 0.0);
+            response.setProperty(rt, "evictions", (double) stats.evictions);
+            response.setProperty(rt, "invalidations", (double) stats.invalidations);
+            response.setProperty(rt, "entries", (double) stats.entries);
+            response.setProperty(rt, "memoryUsed", (double) stats.memoryUsed);
+            return response;
+        });
+        createMethod(rt, adapter, "getStatementCacheStats", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
+            auto stats = database->statementCacheStats();
+            uint64_t lookups = stats.hits + stats.misses;
+
+            jsi::Object response(rt);
+            response.setProperty(rt, "hits", (double) stats.hits);
+            response.setProperty(rt, "misses", (double) stats.misses);
+            response.setProperty(rt, "hitRate", lookups ? (double) stats.hits / lookups : 0.0);
+            response.setProperty(rt, "evictions", (double) stats.evictions);
+            response.setProperty(rt, "liveStatements", (double) stats.liveStatements);
+            response.setProperty(rt, "pinnedStatements", (double) stats.pinnedStatements);
+            response.setProperty(rt, "memoryUsed", (double) stats.memoryUsed);
+            return response;
+        });
+        createSyncMethod("unsafeClose", 0, [database](jsi::Runtime &rt, const jsi::Value *args) {
             assert(database->initialized_);
             database->destroy();
             database->initialized_ = false;
             return jsi::Value::undefined();
         });
 
+        // NOTE: Async methods need CallInvoker to settle promises on JS thread. It's not available on Android, so
+        // async methods are not installed there, and JS falls back to synchronous methods
+        if (!jsCallInvoker) {
+            return adapter;
+        }
+
+        // NOTE: Raw pointer is safe to use in async work, because destroying the database waits for it to finish
+        Database *db = database.get();
+        createAsyncMethod(rt, adapter, database, "findAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto tableName = args[0].getString(rt).utf8(rt);
+            auto id = args[1].getString(rt).utf8(rt);
+            return [db, tableName, id]() -> AsyncMarshaller {
+                auto result = std::make_shared<QueryResult>(db->findAsync(tableName, id));
+                return [result](jsi::Runtime &rt) {
+                    return Database::findResultToJsi(rt, *result);
+                };
+            };
+        });
+        createAsyncMethod(rt, adapter, database, "findManyAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            jsi::Array requests = args[0].getObject(rt).getArray(rt);
+            auto findRequests = Database::findRequestsFromJsi(rt, requests);
+            return [db, findRequests]() -> AsyncMarshaller {
+                auto results = std::make_shared<std::vector<FoundRecords>>(db->findMany(findRequests));
+                return [results](jsi::Runtime &rt) {
+                    return Database::foundRecordsToJsi(rt, *results);
+                };
+            };
+        });
+        auto createQueryAsyncMethod = [&rt, &adapter, database, db](const char *methodName, bool asArrays) {
+            createAsyncReadMethod(rt, adapter, database, methodName, 3, [db, asArrays](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+                assert(db->initialized_);
+                auto tableName = args[0].getString(rt).utf8(rt);
+                auto sql = args[1].getString(rt).utf8(rt);
+                jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+                auto argsVector = Database::argsFromJsi(rt, arguments);
+                return [db, asArrays, tableName, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                    auto result = std::make_shared<QueryResult>(db->queryAsync(reader, sql, argsVector));
+                    return [db, asArrays, tableName, result]() -> AsyncMarshaller {
+                        // NOTE: Done in order of dispatch, so that JS and native record caches stay consistent
+                        db->applyRecordCache(tableName, *result);
+                        return [result, asArrays](jsi::Runtime &rt) {
+                            return Database::recordsToJsi(rt, *result, asArrays);
+                        };
+                    };
+                };
+            });
+        };
+        createQueryAsyncMethod("queryAsync", false);
+        createQueryAsyncMethod("queryAsArrayAsync", true);
+        createAsyncReadMethod(rt, adapter, database, "queryAsJSONAsync", 3, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto tableName = args[0].getString(rt).utf8(rt);
+            auto sql = args[1].getString(rt).utf8(rt);
+            jsi::Array arguments = args[2].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, tableName, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                auto result = std::make_shared<QueryResult>(db->queryAsync(reader, sql, argsVector));
+                return [db, tableName, result]() -> AsyncMarshaller {
+                    db->applyRecordCache(tableName, *result);
+                    // NOTE: Serialized off the JS thread
+                    auto json = std::make_shared<std::string>(Database::queryResultToJson(*result));
+                    return [json](jsi::Runtime &rt) {
+                        return jsi::String::createFromUtf8(rt, *json);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "queryIdsAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                auto result = std::make_shared<QueryResult>(db->queryIdsAsync(reader, sql, argsVector));
+                return [result]() -> AsyncMarshaller {
+                    return [result](jsi::Runtime &rt) {
+                        return Database::idsToJsi(rt, *result);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "unsafeQueryRawAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                auto result = std::make_shared<QueryResult>(db->unsafeQueryRawAsync(reader, sql, argsVector));
+                return [result]() -> AsyncMarshaller {
+                    return [result](jsi::Runtime &rt) {
+                        return Database::recordsToJsi(rt, *result, false);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "queryManyAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            jsi::Array queries = args[0].getObject(rt).getArray(rt);
+            auto readQueries = std::make_shared<std::vector<ReadQuery>>(Database::readQueriesFromJsi(rt, queries));
+            return [db, readQueries](ReadConnection *reader) -> AsyncWork {
+                auto results = std::make_shared<std::vector<ReadQueryResult>>(db->queryMany(reader, *readQueries));
+                return [db, readQueries, results]() -> AsyncMarshaller {
+                    // NOTE: Done in order of dispatch, so that JS and native record caches stay consistent
+                    db->applyRecordCache(*readQueries, *results);
+                    return [results](jsi::Runtime &rt) {
+                        return Database::readQueryResultsToJsi(rt, *results);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "countAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                int count = db->countAsync(reader, sql, argsVector);
+                return [count]() -> AsyncMarshaller {
+                    return [count](jsi::Runtime &rt) {
+                        return jsi::Value(count);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "refreshDirtyQueriesAsync", 0, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            return [db](ReadConnection *reader) -> AsyncWork {
+                auto results = std::make_shared<std::vector<LiveQueryResult>>(db->refreshDirtyQueries(reader));
+                return [db, results]() -> AsyncMarshaller {
+                    db->diffLiveQueryResults(*results);
+                    return [results](jsi::Runtime &rt) {
+                        return Database::liveQueryResultsToJsi(rt, *results);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "unsafeQueryRawLazyAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                auto rows = std::make_shared<std::vector<std::shared_ptr<LazyRow>>>(db->unsafeQueryRawLazyAsync(reader, sql, argsVector));
+                return [rows]() -> AsyncMarshaller {
+                    return [rows](jsi::Runtime &rt) {
+                        return Database::lazyRowsToJsi(rt, *rows);
+                    };
+                };
+            };
+        });
+        createAsyncReadMethod(rt, adapter, database, "queryColumnarAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncReadWork {
+            assert(db->initialized_);
+            auto sql = args[0].getString(rt).utf8(rt);
+            jsi::Array arguments = args[1].getObject(rt).getArray(rt);
+            auto argsVector = Database::argsFromJsi(rt, arguments);
+            return [db, sql, argsVector](ReadConnection *reader) -> AsyncWork {
+                auto result = std::make_shared<ColumnarResult>(db->queryColumnarAsync(reader, sql, argsVector));
+                return [result]() -> AsyncMarshaller {
+                    return [result](jsi::Runtime &rt) {
+                        return Database::columnarResultToJsi(rt, *result);
+                    };
+                };
+            };
+        });
+        createAsyncWriteMethod(rt, adapter, database, "batchJSONAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto json = std::make_shared<simdjson::padded_string>(args[0].getString(rt).utf8(rt));
+            return [db, json]() -> AsyncMarshaller {
+                db->batchJSONAsync(*json);
+                return [](jsi::Runtime &rt) {
+                    return jsi::Value::undefined();
+                };
+            };
+        });
+        createAsyncWriteMethod(rt, adapter, database, "batchBinaryAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            // NOTE: JS memory can't be accessed off the JS thread, so the buffer is copied (once, unlike JSON)
+            jsi::ArrayBuffer buffer = args[0].getObject(rt).getArrayBuffer(rt);
+            auto data = std::make_shared<std::vector<uint8_t>>(buffer.data(rt), buffer.data(rt) + buffer.size(rt));
+            return [db, data]() -> AsyncMarshaller {
+                db->batchBinaryAsync(*data);
+                return [](jsi::Runtime &rt) {
+                    return jsi::Value::undefined();
+                };
+            };
+        });
+        createAsyncWriteMethod(rt, adapter, database, "batchRecordsAsync", 3, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            jsi::Array operationsJsi = args[0].getObject(rt).getArray(rt);
+            auto operations = std::make_shared<std::vector<RecordOperation>>(db->recordOperationsFromJsi(rt, operationsJsi));
+            bool recreatesIndices = args[1].getBool();
+            auto durability = durabilityFromJsi(rt, args[2]);
+            return [db, operations, recreatesIndices, durability]() -> AsyncMarshaller {
+                db->batchRecordsAsync(*operations, recreatesIndices, durability);
+                return [](jsi::Runtime &rt) {
+                    return jsi::Value::undefined();
+                };
+            };
+        }, 2);
+        createAsyncMethod(rt, adapter, database, "getLocalAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto key = args[0].getString(rt).utf8(rt);
+            return [db, key]() -> AsyncMarshaller {
+                auto value = db->getLocalAsync(key);
+                return [value](jsi::Runtime &rt) -> jsi::Value {
+                    if (!value) {
+                        return jsi::Value::null();
+                    }
+                    return jsi::String::createFromUtf8(rt, *value);
+                };
+            };
+        });
+        createAsyncMethod(rt, adapter, database, "getLocalManyAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto keys = Database::stringsFromJsi(rt, args[0].getObject(rt).getArray(rt));
+            return [db, keys]() -> AsyncMarshaller {
+                auto values = std::make_shared<std::vector<std::optional<std::string>>>(db->getLocalMany(keys));
+                return [values](jsi::Runtime &rt) -> jsi::Value {
+                    return Database::localValuesToJsi(rt, *values);
+                };
+            };
+        });
+        createAsyncMethod(rt, adapter, database, "setLocalAsync", 2, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto key = args[0].getString(rt).utf8(rt);
+            auto value = args[1].getString(rt).utf8(rt);
+            return [db, key, value]() -> AsyncMarshaller {
+                db->setLocal(key, value);
+                return [](jsi::Runtime &rt) {
+                    return jsi::Value::undefined();
+                };
+            };
+        });
+        createAsyncMethod(rt, adapter, database, "removeLocalAsync", 1, [db](jsi::Runtime &rt, const jsi::Value *args) -> AsyncWork {
+            assert(db->initialized_);
+            auto key = args[0].getString(rt).utf8(rt);
+            return [db, key]() -> AsyncMarshaller {
+                db->removeLocal(key);
+                return [](jsi::Runtime &rt) {
+                    return jsi::Value::undefined();
+                };
+            };
+        });
+
         return adapter;
     });
 
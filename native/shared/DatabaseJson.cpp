@@ -0,0 +1,149 @@
+#include "Database.h"
+#include <cmath>
+#include <cstdio>
+
+namespace watermelondb {
+
+// MARK: - JSON encoding
+
+void appendJsonString(std::string &json, const std::string &string) {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    json += '"';
+    for (char character : string) {
+        switch (character) {
+        case '"':
+            json += "\\\"";
+            break;
+        case '\\':
+            json += "\\\\";
+            break;
+        case '\n':
+            json += "\\n";
+            break;
+        case '\r':
+            json += "\\r";
+            break;
+        case '\t':
+            json += "\\t";
+            break;
+        default:
+            if ((unsigned char) character < 0x20) {
+                json += "\\u00";
+                json += hexDigits[(character >> 4) & 0xf];
+                json += hexDigits[character & 0xf];
+            } else {
+                // NOTE: UTF-8 is passed through as-is
+                json += character;
+            }
+        }
+    }
+    json += '"';
+}
+
+void appendJsonValue(std::string &json, const SqliteValue &value) {
+    if (auto text = std::get_if<std::string>(&value)) {
+        appendJsonString(json, *text);
+    } else if (auto integer = std::get_if<int64_t>(&value)) {
+        json += std::to_string(*integer);
+    } else if (auto number = std::get_if<double>(&value)) {
+        if (std::isnan(*number)) {
+            json += "null";
+        } else if (std::isinf(*number)) {
+            // NOTE: Not valid in JSON, but JSON.parse turns out-of-range numbers into Infinity
+            json += *number > 0 ? "1e999" : "-1e999";
+        } else {
+            // NOTE: 17 significant digits are enough for any double to be parsed back to the same value
+            char buffer[32];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.17g", *number);
+            json.append(buffer, length);
+        }
+    } else {
+        json += "null";
+    }
+}
+
+// NOTE: Same format as queryAsArray (see decodeQueryResult.js)
+std::string Database::queryResultToJson(QueryResult &result) {
+    size_t rowCount = result.isCachedId.size();
+    size_t columnCount = result.columnNames.size();
+
+    std::string json;
+    // NOTE: Rough estimate, just to avoid most reallocations
+    json.reserve(16 + rowCount * columnCount * 8);
+    json += '[';
+    if (rowCount) {
+        json += '[';
+        for (size_t i = 0; i < columnCount; i++) {
+            if (i) {
+                json += ',';
+            }
+            appendJsonString(json, result.columnNames[i]);
+        }
+        json += ']';
+    }
+
+    size_t valueIdx = 0;
+    for (size_t row = 0; row < rowCount; row++) {
+        json += ',';
+        if (result.isCachedId[row]) {
+            appendJsonValue(json, result.values[valueIdx++]);
+            continue;
+        }
+
+        json += '[';
+        for (size_t i = 0; i < columnCount; i++) {
+            if (i) {
+                json += ',';
+            }
+            appendJsonValue(json, result.values[valueIdx++]);
+        }
+        json += ']';
+    }
+    json += ']';
+
+    return json;
+}
+
+// MARK: - Queries
+
+jsi::Value Database::queryAsJson(jsi::String &tableName, jsi::String &sql, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::string json;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        QueryResult result;
+        if (usesQueryCache_) {
+            ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sql.utf8(rt), argsFromJsi(rt, arguments) };
+            result = cachedReadQuery(nullptr, lock, query).rows;
+        } else {
+            auto statement = executeQuery(sql.utf8(rt), arguments);
+            result = readQueryResult(statement.stmt);
+        }
+        replaceCachedRecords(tableName.utf8(rt), result);
+        json = queryResultToJson(result);
+    }
+    return jsi::String::createFromUtf8(rt, json);
+}
+
+jsi::Value Database::executeQueryAsJson(int handle, jsi::String &tableName, jsi::Array &arguments) {
+    auto &rt = getRt();
+    std::string json;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        QueryResult result;
+        if (usesQueryCache_) {
+            auto statement = preparedStatement(handle);
+            ReadQuery query = { ReadQueryKind::records, tableName.utf8(rt), sqlite3_sql(statement), argsFromJsi(rt, arguments) };
+            result = cachedReadQuery(nullptr, lock, query, statement).rows;
+        } else {
+            auto statement = executePrepared(handle, arguments);
+            result = readQueryResult(statement.stmt);
+        }
+        replaceCachedRecords(tableName.utf8(rt), result);
+        json = queryResultToJson(result);
+    }
+    return jsi::String::createFromUtf8(rt, json);
+}
+
+} // namespace watermelondb
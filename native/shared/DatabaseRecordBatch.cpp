@@ -0,0 +1,237 @@
+#include "Database.h"
+
+namespace watermelondb {
+
+// MARK: - Schema
+
+void Database::registerSchema(jsi::Object &schema, std::string dropIndicesSql, std::string createIndicesSql) {
+    auto &rt = getRt();
+    std::unordered_map<std::string, std::shared_ptr<const RegisteredTable>> tables;
+    size_t maxVariables = (size_t) sqlite3_limit(db_->sqlite, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+
+    auto tablesObj = schema.getProperty(rt, "tables").getObject(rt);
+    auto tableNames = tablesObj.getPropertyNames(rt);
+    for (size_t i = 0, len = tableNames.size(rt); i < len; i++) {
+        auto tableName = tableNames.getValueAtIndex(rt, i).getString(rt);
+        auto tableObj = tablesObj.getProperty(rt, tableName).getObject(rt);
+        auto columnArr = tableObj.getProperty(rt, "columnArray").getObject(rt).getArray(rt);
+
+        std::vector<std::string> columns;
+        for (size_t j = 0, columnsLen = columnArr.size(rt); j < columnsLen; j++) {
+            auto columnObj = columnArr.getValueAtIndex(rt, j).getObject(rt);
+            columns.push_back(columnObj.getProperty(rt, "name").getString(rt).utf8(rt));
+        }
+
+        auto name = tableName.utf8(rt);
+        tables[name] = std::make_shared<const RegisteredTable>(name, std::move(columns), maxVariables);
+    }
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+    registeredTables_ = std::move(tables);
+    dropIndicesSql_ = dropIndicesSql;
+    createIndicesSql_ = createIndicesSql;
+}
+
+// MARK: - Conversion
+
+static SqliteValue recordValueFromJsi(jsi::Runtime &rt, const jsi::Value &value) {
+    // NOTE: Values are read like batch arguments (e.g. undefined is null)
+    if (value.isNull() || value.isUndefined()) {
+        return std::monostate();
+    } else if (value.isString()) {
+        return value.getString(rt).utf8(rt);
+    } else if (value.isNumber()) {
+        return value.getNumber();
+    } else if (value.isBool()) {
+        return (int64_t) value.getBool();
+    }
+    throw jsi::JSError(rt, "Invalid value type of a record field - only strings, numbers, booleans and null are allowed");
+}
+
+static std::string recordIdFromJsi(jsi::Runtime &rt, const jsi::Value &value) {
+    if (!value.isString()) {
+        throw jsi::JSError(rt, "Invalid record id - ids must be strings");
+    }
+    return value.getString(rt).utf8(rt);
+}
+
+static RecordOperationType recordOperationTypeFromJsi(jsi::Runtime &rt, jsi::String &&typeJsi) {
+    auto type = typeJsi.utf8(rt);
+    if (type == "create") {
+        return RecordOperationType::create;
+    } else if (type == "update") {
+        return RecordOperationType::update;
+    } else if (type == "markAsDeleted") {
+        return RecordOperationType::markAsDeleted;
+    } else if (type == "destroyPermanently") {
+        return RecordOperationType::destroyPermanently;
+    }
+    throw jsi::JSError(rt, "unknown batch operation type");
+}
+
+std::vector<RecordOperation> Database::recordOperationsFromJsi(jsi::Runtime &rt, jsi::Array &operations) {
+    // NOTE: Property names of columns are made once per table, not for every record
+    struct TableProps {
+        std::shared_ptr<const RegisteredTable> table;
+        std::vector<jsi::PropNameID> columns;
+    };
+    std::unordered_map<std::string, TableProps> tableProps;
+    auto idProp = jsi::PropNameID::forAscii(rt, "id");
+    auto statusProp = jsi::PropNameID::forAscii(rt, "_status");
+    auto changedProp = jsi::PropNameID::forAscii(rt, "_changed");
+
+    size_t operationsCount = operations.length(rt);
+    std::vector<RecordOperation> recordOperations;
+    recordOperations.reserve(operationsCount);
+
+    for (size_t i = 0; i < operationsCount; i++) {
+        jsi::Array operation = operations.getValueAtIndex(rt, i).getObject(rt).getArray(rt);
+        auto type = recordOperationTypeFromJsi(rt, operation.getValueAtIndex(rt, 0).getString(rt));
+        auto tableName = operation.getValueAtIndex(rt, 1).getString(rt).utf8(rt);
+
+        auto props = tableProps.find(tableName);
+        if (props == tableProps.end()) {
+            auto table = registeredTables_.find(tableName);
+            if (table == registeredTables_.end()) {
+                throw jsi::JSError(rt, "Table " + tableName + " is not in the registered schema");
+            }
+            std::vector<jsi::PropNameID> columns;
+            columns.reserve(table->second->columns.size());
+            for (auto const &column : table->second->columns) {
+                columns.push_back(jsi::PropNameID::forUtf8(rt, column));
+            }
+            props = tableProps.emplace(tableName, TableProps { table->second, std::move(columns) }).first;
+        }
+
+        RecordOperation recordOperation = { type, props->second.table, {} };
+        auto &values = recordOperation.values;
+        jsi::Value rawOrId = operation.getValueAtIndex(rt, 2);
+
+        if (type == RecordOperationType::create || type == RecordOperationType::update) {
+            jsi::Object raw = rawOrId.getObject(rt);
+            auto &columns = props->second.columns;
+            values.reserve(columns.size() + 3);
+            if (type == RecordOperationType::create) {
+                values.push_back(recordIdFromJsi(rt, raw.getProperty(rt, idProp)));
+            }
+            values.push_back(recordValueFromJsi(rt, raw.getProperty(rt, statusProp)));
+            values.push_back(recordValueFromJsi(rt, raw.getProperty(rt, changedProp)));
+            for (auto const &column : columns) {
+                values.push_back(recordValueFromJsi(rt, raw.getProperty(rt, column)));
+            }
+            if (type == RecordOperationType::update) {
+                values.push_back(recordIdFromJsi(rt, raw.getProperty(rt, idProp)));
+            }
+        } else {
+            values.push_back(recordIdFromJsi(rt, rawOrId));
+        }
+
+        recordOperations.push_back(std::move(recordOperation));
+    }
+
+    return recordOperations;
+}
+
+// MARK: - Batch
+
+void Database::batchRecords(jsi::Array &operations, bool recreatesIndices, std::optional<Durability> durability) {
+    auto &rt = getRt();
+    auto recordOperations = recordOperationsFromJsi(rt, operations);
+    const std::lock_guard<std::mutex> lock(mutex_);
+    executeRecordBatch(recordOperations, recreatesIndices, durability);
+}
+
+void Database::batchRecordsAsync(std::vector<RecordOperation> &operations, bool recreatesIndices, std::optional<Durability> durability) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    executeRecordBatch(operations, recreatesIndices, durability);
+}
+
+void Database::executeRecordBatch(std::vector<RecordOperation> &operations, bool recreatesIndices, std::optional<Durability> durability) {
+    beginTransaction(durability);
+
+    std::vector<std::pair<std::string, std::string>> addedIds = {};
+    std::vector<std::pair<std::string, std::string>> removedIds = {};
+
+    try {
+        // NOTE: For large batches, it's profitable to delete all indices and then recreate them
+        if (recreatesIndices) {
+            executeMultipleWithoutInvalidation(dropIndicesSql_);
+        }
+
+        // NOTE: Consecutive operations of the same type on the same table reuse the statement
+        const std::string *previousSql = nullptr;
+        sqlite3_stmt *stmt = nullptr;
+        for (size_t i = 0; i < operations.size();) {
+            auto &operation = operations[i];
+            auto &table = *operation.table;
+
+            // NOTE: Deletes are still executed one by one - `where id in (...)` (of a bound array, or a list of
+            // arguments) turned out to be slower (with sqlite 3.50, see deleteChunks benchmark of native/linux)
+            size_t rows = 1;
+            if (operation.type == RecordOperationType::create && table.rowsPerInsert > 1) {
+                while (rows < table.rowsPerInsert && i + rows < operations.size() &&
+                       operations[i + rows].type == RecordOperationType::create &&
+                       operations[i + rows].table == operation.table) {
+                    rows++;
+                }
+                if (rows < table.rowsPerInsert) {
+                    rows = table.tailRowsPerInsert && rows >= table.tailRowsPerInsert ? table.tailRowsPerInsert : 1;
+                }
+            }
+
+            auto &sql = rows == 1 ? operation.sql() :
+                rows == table.rowsPerInsert ? table.multiRowInsertSql : table.tailInsertSql;
+            if (&sql != previousSql) {
+                stmt = prepareQuery(sql, true);
+                previousSql = &sql;
+            }
+
+            SqliteStatement statement(stmt);
+            if (rows == 1) {
+                bindArgs(stmt, operation.values);
+            } else {
+                int argumentIndex = 1;
+                for (size_t j = i; j < i + rows; j++) {
+                    for (auto const &value : operations[j].values) {
+                        if (bindValue(stmt, argumentIndex++, value) != SQLITE_OK) {
+                            throw dbError("Failed to bind an argument for query");
+                        }
+                    }
+                }
+            }
+            executeUpdate(stmt);
+
+            for (size_t j = i; j < i + rows; j++) {
+                auto &recordOperation = operations[j];
+                if (recordOperation.type == RecordOperationType::create) {
+                    addedIds.emplace_back(table.name, recordOperation.id());
+                } else if (recordOperation.type != RecordOperationType::update) {
+                    removedIds.emplace_back(table.name, recordOperation.id());
+                    // NOTE: Records marked as deleted are only updated
+                    if (recordOperation.type == RecordOperationType::destroyPermanently) {
+                        changeCapture_.recordDeletedId(table.name, recordOperation.id());
+                    }
+                }
+            }
+            i += rows;
+        }
+
+        if (recreatesIndices) {
+            executeMultipleWithoutInvalidation(createIndicesSql_);
+        }
+        commit();
+    } catch (const std::exception &ex) {
+        rollback();
+        throw;
+    }
+
+    for (auto const &record : addedIds) {
+        markAsCached(record.first, record.second);
+    }
+
+    for (auto const &record : removedIds) {
+        removeFromCache(record.first, record.second);
+    }
+}
+
+} // namespace watermelondb
@@ -0,0 +1,109 @@
+#include "LazyRow.h"
+#include "Database.h"
+#include <cstring>
+
+namespace watermelondb {
+
+static const char lazyValueNull = 0;
+static const char lazyValueNumber = 1;
+static const char lazyValueText = 2;
+
+LazyRow::LazyRow(std::shared_ptr<LazyRowColumns> columns, sqlite3_stmt *statement) : columns_(columns) {
+    size_t columnCount = columns_->names.size();
+    size_t headerSize = (columnCount + 1) * sizeof(uint32_t);
+
+    // NOTE: Sized up front, so that the buffer is allocated once
+    size_t size = headerSize;
+    for (size_t i = 0; i < columnCount; i++) {
+        auto type = sqlite3_column_type(statement, (int) i);
+        if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) {
+            size += 1 + sizeof(double);
+        } else if (type == SQLITE_TEXT) {
+            sqlite3_column_text(statement, (int) i); // NOTE: bytes are only known after conversion to text
+            size += 1 + sqlite3_column_bytes(statement, (int) i);
+        } else if (type == SQLITE_NULL) {
+            size += 1;
+        } else {
+            throw DatabaseError("Unable to fetch record from database - unknown column type (WatermelonDB does not support blobs or custom sqlite types");
+        }
+    }
+    buffer_.resize(size);
+
+    char *data = &buffer_[0];
+    uint32_t offset = (uint32_t) headerSize;
+    for (size_t i = 0; i < columnCount; i++) {
+        std::memcpy(data + i * sizeof(uint32_t), &offset, sizeof(uint32_t));
+
+        auto type = sqlite3_column_type(statement, (int) i);
+        if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) {
+            double value = sqlite3_column_double(statement, (int) i);
+            data[offset] = lazyValueNumber;
+            std::memcpy(data + offset + 1, &value, sizeof(double));
+            offset += 1 + sizeof(double);
+        } else if (type == SQLITE_TEXT) {
+            const char *text = (const char *)sqlite3_column_text(statement, (int) i);
+            int length = sqlite3_column_bytes(statement, (int) i);
+            data[offset] = lazyValueText;
+            std::memcpy(data + offset + 1, text, length);
+            offset += 1 + length;
+        } else {
+            data[offset] = lazyValueNull;
+            offset += 1;
+        }
+    }
+    std::memcpy(data + columnCount * sizeof(uint32_t), &offset, sizeof(uint32_t));
+}
+
+jsi::Value LazyRow::valueAt(jsi::Runtime &rt, size_t column) {
+    const char *data = buffer_.data();
+    uint32_t start, end;
+    std::memcpy(&start, data + column * sizeof(uint32_t), sizeof(uint32_t));
+    std::memcpy(&end, data + (column + 1) * sizeof(uint32_t), sizeof(uint32_t));
+
+    char type = data[start];
+    if (type == lazyValueNumber) {
+        double value;
+        std::memcpy(&value, data + start + 1, sizeof(double));
+        return jsi::Value(value);
+    } else if (type == lazyValueText) {
+        return jsi::String::createFromUtf8(rt, (const uint8_t *)(data + start + 1), end - start - 1);
+    }
+    return jsi::Value::null();
+}
+
+jsi::Value LazyRow::get(jsi::Runtime &rt, const jsi::PropNameID &name) {
+    auto nameString = name.utf8(rt);
+
+    auto found = columns_->indexes.find(nameString);
+    if (found != columns_->indexes.end()) {
+        return valueAt(rt, found->second);
+    }
+
+    if (nameString == "toRaw") {
+        auto row = shared_from_this();
+        return jsi::Function::createFromHostFunction(rt, name, 0, [row](jsi::Runtime &rt, const jsi::Value &, const jsi::Value *, size_t) {
+            return row->toRaw(rt);
+        });
+    }
+
+    return jsi::Value::undefined();
+}
+
+std::vector<jsi::PropNameID> LazyRow::getPropertyNames(jsi::Runtime &rt) {
+    std::vector<jsi::PropNameID> names;
+    names.reserve(columns_->names.size());
+    for (auto const &column : columns_->names) {
+        names.push_back(jsi::PropNameID::forUtf8(rt, column));
+    }
+    return names;
+}
+
+jsi::Object LazyRow::toRaw(jsi::Runtime &rt) {
+    jsi::Object raw(rt);
+    for (size_t i = 0; i < columns_->names.size(); i++) {
+        raw.setProperty(rt, columns_->names[i].c_str(), valueAt(rt, i));
+    }
+    return raw;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,42 @@
+#pragma once
+
+#import <jsi/jsi.h>
+#import <memory>
+#import <string>
+#import <unordered_map>
+#import <vector>
+#import <sqlite3.h>
+
+using namespace facebook;
+
+namespace watermelondb {
+
+// Column names of a query result, shared by all of its rows
+struct LazyRowColumns {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, size_t> indexes;
+};
+
+// A query result row exposed to JS as a HostObject. Values are copied into a compact native buffer, and only
+// converted to JS values when accessed. `row.toRaw()` returns a plain object with all values (e.g. to make a
+// Model). Rows don't reference the statement or the database, so they're safe to keep after the query, and
+// can be created off the JS thread
+class LazyRow : public jsi::HostObject, public std::enable_shared_from_this<LazyRow> {
+public:
+    // Copies the current row of the statement
+    LazyRow(std::shared_ptr<LazyRowColumns> columns, sqlite3_stmt *statement);
+
+    jsi::Value get(jsi::Runtime &rt, const jsi::PropNameID &name) override;
+    std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &rt) override;
+    jsi::Object toRaw(jsi::Runtime &rt);
+
+private:
+    std::shared_ptr<LazyRowColumns> columns_;
+    // uint32_t offsets of values (columnCount + 1 of them), followed by values. Each value is a type byte
+    // followed by a double (numbers), UTF-8 bytes (text), or nothing (null)
+    std::string buffer_;
+
+    jsi::Value valueAt(jsi::Runtime &rt, size_t column);
+};
+
+} // namespace watermelondb
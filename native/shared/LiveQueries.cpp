@@ -0,0 +1,159 @@
+#include "LiveQueries.h"
+#include <algorithm>
+
+namespace watermelondb {
+
+int LiveQueryRegistry::add(LiveQuery query) {
+    int handle = nextHandle_++;
+    for (auto const &table : query.tables) {
+        handlesByTable_[table].insert(handle);
+    }
+    queries_.emplace(handle, std::move(query));
+    dirty_.insert(handle);
+    return handle;
+}
+
+void LiveQueryRegistry::remove(int handle) {
+    auto found = queries_.find(handle);
+    if (found == queries_.end()) {
+        return;
+    }
+
+    for (auto const &table : found->second.tables) {
+        auto handles = handlesByTable_.find(table);
+        if (handles != handlesByTable_.end()) {
+            handles->second.erase(handle);
+            if (handles->second.empty()) {
+                handlesByTable_.erase(handles);
+            }
+        }
+    }
+    queries_.erase(found);
+    dirty_.erase(handle);
+    lastIds_.erase(handle);
+}
+
+bool LiveQueryRegistry::isEmpty() {
+    return queries_.empty();
+}
+
+void LiveQueryRegistry::markChanged(const ChangeSet &changes) {
+    for (auto const &table : changes) {
+        auto handles = handlesByTable_.find(table.first);
+        if (handles != handlesByTable_.end()) {
+            dirty_.insert(handles->second.begin(), handles->second.end());
+        }
+    }
+}
+
+void LiveQueryRegistry::markDirty(const std::vector<int> &handles) {
+    for (auto handle : handles) {
+        if (queries_.count(handle)) {
+            dirty_.insert(handle);
+        }
+    }
+}
+
+void LiveQueryRegistry::markAllDirty() {
+    for (auto const &query : queries_) {
+        dirty_.insert(query.first);
+    }
+}
+
+std::vector<int> LiveQueryRegistry::takeDirty() {
+    std::vector<int> handles(dirty_.begin(), dirty_.end());
+    dirty_.clear();
+    return handles;
+}
+
+std::vector<std::pair<int, LiveQuery>> LiveQueryRegistry::takeDirtyQueries() {
+    std::vector<std::pair<int, LiveQuery>> queries;
+    for (auto handle : dirty_) {
+        queries.emplace_back(handle, queries_.at(handle));
+    }
+    dirty_.clear();
+    return queries;
+}
+
+std::optional<IdsDiff> LiveQueryRegistry::updateIds(int handle, std::vector<std::string> ids) {
+    if (!queries_.count(handle)) {
+        return std::nullopt;
+    }
+
+    auto &lastIds = lastIds_[handle];
+    auto diff = diffIds(lastIds, ids);
+    lastIds = std::move(ids);
+    return diff;
+}
+
+IdsDiff diffIds(const std::vector<std::string> &previous, const std::vector<std::string> &next) {
+    IdsDiff diff;
+    diff.length = next.size();
+
+    std::unordered_map<std::string, int> nextPositions;
+    nextPositions.reserve(next.size());
+    for (size_t i = 0; i < next.size(); i++) {
+        nextPositions.emplace(next[i], (int) i);
+    }
+
+    // New positions of kept ids, in previous order (-1 if removed)
+    std::vector<int> newPositions(previous.size(), -1);
+    std::vector<bool> isKept(next.size(), false);
+    for (size_t i = 0; i < previous.size(); i++) {
+        auto found = nextPositions.find(previous[i]);
+        if (found == nextPositions.end()) {
+            diff.removedPositions.push_back((int) i);
+        } else {
+            newPositions[i] = found->second;
+            isKept[found->second] = true;
+        }
+    }
+    for (size_t i = 0; i < next.size(); i++) {
+        if (!isKept[i]) {
+            diff.insertedIds.push_back(next[i]);
+            diff.insertedPositions.push_back((int) i);
+        }
+    }
+
+    // Longest increasing subsequence of new positions (patience sorting) - those ids are not moved
+    std::vector<int> tails; // previous index of the last id of the best subsequence of each length
+    std::vector<int> predecessors(previous.size(), -1);
+    for (size_t i = 0; i < previous.size(); i++) {
+        if (newPositions[i] == -1) {
+            continue;
+        }
+        auto length = std::lower_bound(tails.begin(), tails.end(), newPositions[i], [&](int index, int position) {
+            return newPositions[index] < position;
+        }) - tails.begin();
+        predecessors[i] = length > 0 ? tails[length - 1] : -1;
+        if (length == (long) tails.size()) {
+            tails.push_back((int) i);
+        } else {
+            tails[length] = (int) i;
+        }
+    }
+    std::vector<bool> isMoved(previous.size(), false);
+    for (size_t i = 0; i < previous.size(); i++) {
+        isMoved[i] = newPositions[i] != -1;
+    }
+    for (int i = tails.empty() ? -1 : tails.back(); i != -1; i = predecessors[i]) {
+        isMoved[i] = false;
+    }
+
+    // Moved ids that are next to each other in both lists are reported as one range
+    for (size_t i = 0; i < previous.size(); i++) {
+        if (!isMoved[i]) {
+            continue;
+        }
+        size_t count = 1;
+        while (i + count < previous.size() && isMoved[i + count] &&
+               newPositions[i + count] == newPositions[i] + (int) count) {
+            count++;
+        }
+        diff.movedRanges.insert(diff.movedRanges.end(), { (int) i, newPositions[i], (int) count });
+        i += count - 1;
+    }
+    return diff;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,70 @@
+#pragma once
+
+#import <optional>
+#import <set>
+#import <string>
+#import <unordered_map>
+#import <unordered_set>
+#import <vector>
+
+#import "ChangeCapture.h"
+#import "SqliteArray.h"
+
+namespace watermelondb {
+
+enum class LiveQueryKind { ids, count };
+
+// A query observed by JS. It's marked as dirty when a transaction that changes any of its tables is committed,
+// or when raw SQL that could change rows without sqlite hooks noticing is executed
+struct LiveQuery {
+    std::string sql;
+    std::vector<SqliteValue> arguments;
+    std::vector<std::string> tables; // including joined tables
+    LiveQueryKind kind;
+};
+
+// Difference between two lists of (unique) record ids. To get the new list (of `length` ids), put inserted
+// ids at their positions, and ids moved from a range of previous list at the range starting at `to`, and then
+// fill the remaining positions with the rest of previous ids (not removed or moved), keeping their order
+struct IdsDiff {
+    size_t length = 0;
+    std::vector<std::string> insertedIds;
+    std::vector<int> insertedPositions; // in the new list, ascending
+    std::vector<int> removedPositions; // in the previous list, ascending
+    std::vector<int> movedRanges; // (from, to, count) triples
+};
+
+// NOTE: Only the smallest number of ids is reported as moved (ids not in the longest subsequence of ids
+// which kept their relative order), so an id inserted at the top of a sorted list doesn't move all others
+IdsDiff diffIds(const std::vector<std::string> &previous, const std::vector<std::string> &next);
+
+// Registered live queries, with tracking of which ones may have changed results since last checked (new
+// queries are dirty, since they weren't checked yet), and last known ids of `ids` queries.
+// NOTE: Not thread-safe - must be used with the database locked
+class LiveQueryRegistry {
+public:
+    int add(LiveQuery query);
+    void remove(int handle);
+    bool isEmpty();
+
+    // Marks queries that depend on any of the changed tables as dirty. Queries that don't are not visited
+    void markChanged(const ChangeSet &changes);
+    void markDirty(const std::vector<int> &handles);
+    void markAllDirty();
+    // Returns handles of dirty queries (in registration order), and clears their dirty state
+    std::vector<int> takeDirty();
+    // Like takeDirty, but with queries, so that they can be re-executed
+    std::vector<std::pair<int, LiveQuery>> takeDirtyQueries();
+    // Saves new ids of the query, and returns their difference from the last known ones (or nothing if the query
+    // is no longer registered)
+    std::optional<IdsDiff> updateIds(int handle, std::vector<std::string> ids);
+
+private:
+    int nextHandle_ = 1;
+    std::unordered_map<int, LiveQuery> queries_;
+    std::unordered_map<std::string, std::unordered_set<int>> handlesByTable_;
+    std::set<int> dirty_;
+    std::unordered_map<int, std::vector<std::string>> lastIds_;
+};
+
+} // namespace watermelondb
@@ -0,0 +1,403 @@
+#include "ObservationMatcher.h"
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include "simdjson.h"
+
+namespace watermelondb {
+
+static bool isNull(const SqliteValue &value) {
+    return std::holds_alternative<std::monostate>(value);
+}
+
+static bool isNumber(const SqliteValue &value) {
+    return std::holds_alternative<int64_t>(value) || std::holds_alternative<double>(value);
+}
+
+static double numberValue(const SqliteValue &value) {
+    if (auto integer = std::get_if<int64_t>(&value)) {
+        return (double) *integer;
+    }
+    return std::get<double>(value);
+}
+
+// Returns <0, 0, >0 like strcmp, or nothing if values can't be compared (null, or different types)
+static std::optional<int> compareValues(const SqliteValue &left, const SqliteValue &right) {
+    if (isNumber(left) && isNumber(right)) {
+        if (std::holds_alternative<int64_t>(left) && std::holds_alternative<int64_t>(right)) {
+            auto a = std::get<int64_t>(left), b = std::get<int64_t>(right);
+            return a < b ? -1 : a > b ? 1 : 0;
+        }
+        auto a = numberValue(left), b = numberValue(right);
+        return a < b ? -1 : a > b ? 1 : 0;
+    }
+
+    auto leftString = std::get_if<std::string>(&left);
+    auto rightString = std::get_if<std::string>(&right);
+    if (leftString && rightString) {
+        return leftString->compare(*rightString);
+    }
+    return std::nullopt;
+}
+
+static bool valuesEqual(const SqliteValue &left, const SqliteValue &right) {
+    if (isNull(left) || isNull(right)) {
+        return isNull(left) && isNull(right);
+    }
+    auto comparison = compareValues(left, right);
+    return comparison && *comparison == 0;
+}
+
+static bool isOneOf(const SqliteValue &value, const std::vector<SqliteValue> &values) {
+    return std::any_of(values.begin(), values.end(), [&](const SqliteValue &other) {
+        return valuesEqual(value, other);
+    });
+}
+
+static size_t utf8CharLength(unsigned char character) {
+    if (character < 0x80) {
+        return 1;
+    } else if ((character >> 5) == 0x6) {
+        return 2;
+    } else if ((character >> 4) == 0xe) {
+        return 3;
+    } else if ((character >> 3) == 0x1e) {
+        return 4;
+    }
+    return 1;
+}
+
+static char asciiLower(char character) {
+    return character >= 'A' && character <= 'Z' ? character + ('a' - 'A') : character;
+}
+
+// Same as sqlite's LIKE - `%` matches any number of characters, `_` matches one character, and ASCII letters
+// are case-insensitive
+static bool likeMatches(std::string_view value, std::string_view pattern) {
+    size_t v = 0, p = 0;
+    size_t wildcardP = std::string_view::npos, wildcardV = 0;
+    while (v < value.size()) {
+        if (p < pattern.size() && pattern[p] == '%') {
+            wildcardP = ++p;
+            wildcardV = v;
+        } else if (p < pattern.size() && pattern[p] == '_') {
+            v += utf8CharLength(value[v]);
+            p++;
+        } else if (p < pattern.size() && asciiLower(pattern[p]) == asciiLower(value[v])) {
+            v++;
+            p++;
+        } else if (wildcardP != std::string_view::npos) {
+            // Backtrack - let the last % match one more character
+            wildcardV += utf8CharLength(value[wildcardV]);
+            v = wildcardV;
+            p = wildcardP;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+static bool like(const SqliteValue &value, const SqliteValue &pattern) {
+    auto patternString = std::get_if<std::string>(&pattern);
+    if (!patternString) {
+        return false;
+    }
+    auto valueString = std::get_if<std::string>(&value);
+    return likeMatches(valueString ? *valueString : "", *patternString);
+}
+
+static MatcherOperator operatorFromName(std::string_view name) {
+    static const std::unordered_map<std::string_view, MatcherOperator> operators = {
+        { "eq", MatcherOperator::eq },
+        { "notEq", MatcherOperator::notEq },
+        { "gt", MatcherOperator::gt },
+        { "gte", MatcherOperator::gte },
+        { "weakGt", MatcherOperator::weakGt },
+        { "lt", MatcherOperator::lt },
+        { "lte", MatcherOperator::lte },
+        { "oneOf", MatcherOperator::oneOf },
+        { "notIn", MatcherOperator::notIn },
+        { "between", MatcherOperator::between },
+        { "like", MatcherOperator::like },
+        { "notLike", MatcherOperator::notLike },
+        { "includes", MatcherOperator::includes },
+    };
+    auto found = operators.find(name);
+    if (found == operators.end()) {
+        throw std::invalid_argument("Unknown query operator " + std::string(name));
+    }
+    return found->second;
+}
+
+static SqliteValue valueFromJson(simdjson::ondemand::value value) {
+    using namespace simdjson;
+    switch ((ondemand::json_type) value.type()) {
+        case ondemand::json_type::null:
+            return std::monostate();
+        case ondemand::json_type::boolean:
+            // NOTE: Booleans are stored as 1/0
+            return (int64_t) ((bool) value ? 1 : 0);
+        case ondemand::json_type::number:
+            return (double) value;
+        case ondemand::json_type::string:
+            return std::string((std::string_view) value);
+        default:
+            throw std::invalid_argument("Invalid value in query");
+    }
+}
+
+
+// MARK: - Compilation
+
+int ObservationMatcher::columnIndex(std::string_view column) {
+    auto found = std::find(columns_.begin(), columns_.end(), column);
+    if (found != columns_.end()) {
+        return (int) (found - columns_.begin());
+    }
+    columns_.push_back(std::string(column));
+    return (int) columns_.size() - 1;
+}
+
+ObservationMatcher ObservationMatcher::compile(std::string table, std::string_view whereJson) {
+    using namespace simdjson;
+
+    ObservationMatcher matcher;
+    matcher.table_ = std::move(table);
+
+    // NOTE: simdjson::ondemand processes forwards-only, so fields are collected in any order, and validated
+    // once the whole clause is read
+    std::function<MatcherNode(ondemand::object)> compileWhere = [&](ondemand::object where) -> MatcherNode {
+        MatcherNode node;
+        std::string type;
+        bool hasRight = false;
+        for (auto field : where) {
+            std::string_view key = field.unescaped_key();
+            if (key == "type") {
+                type = (std::string_view) field.value();
+            } else if (key == "left") {
+                node.leftColumn = matcher.columnIndex((std::string_view) field.value());
+            } else if (key == "conditions") {
+                for (ondemand::object condition : (ondemand::array) field.value()) {
+                    node.conditions.push_back(compileWhere(condition));
+                }
+            } else if (key == "comparison") {
+                for (auto comparisonField : (ondemand::object) field.value()) {
+                    std::string_view comparisonKey = comparisonField.unescaped_key();
+                    if (comparisonKey == "operator") {
+                        node.comparisonOperator = operatorFromName((std::string_view) comparisonField.value());
+                    } else if (comparisonKey == "right") {
+                        for (auto rightField : (ondemand::object) comparisonField.value()) {
+                            std::string_view rightKey = rightField.unescaped_key();
+                            if (rightKey == "value") {
+                                node.value = valueFromJson(rightField.value());
+                                hasRight = true;
+                            } else if (rightKey == "values") {
+                                for (ondemand::value value : (ondemand::array) rightField.value()) {
+                                    node.values.push_back(valueFromJson(value));
+                                }
+                                hasRight = true;
+                            } else if (rightKey == "column") {
+                                node.rightColumn = matcher.columnIndex((std::string_view) rightField.value());
+                                hasRight = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (type == "where") {
+            if (node.leftColumn == -1 || !hasRight) {
+                throw std::invalid_argument("Invalid Q.where");
+            }
+            auto op = node.comparisonOperator;
+            if (op == MatcherOperator::between && node.values.size() != 2) {
+                throw std::invalid_argument("Invalid Q.between");
+            }
+            node.type = MatcherNode::Type::where;
+        } else if (type == "and") {
+            node.type = MatcherNode::Type::all;
+        } else if (type == "or") {
+            node.type = MatcherNode::Type::any;
+        } else if (type == "on") {
+            throw std::invalid_argument("Illegal Q.on found -- nested Q.ons require explicit Q.experimentalJoinTables declaration");
+        } else {
+            throw std::invalid_argument("Illegal clause " + type);
+        }
+        return node;
+    };
+
+    ondemand::parser parser;
+    padded_string json(whereJson);
+    ondemand::document doc = parser.iterate(json);
+    matcher.root_.type = MatcherNode::Type::all;
+    for (ondemand::object where : doc) {
+        matcher.root_.conditions.push_back(compileWhere(where));
+    }
+    return matcher;
+}
+
+// MARK: - Evaluation
+
+bool ObservationMatcher::matches(const std::vector<SqliteValue> &row, const std::vector<int> &columnIndexes) const {
+    return matches(root_, row, columnIndexes);
+}
+
+bool ObservationMatcher::matches(const MatcherNode &node, const std::vector<SqliteValue> &row, const std::vector<int> &columnIndexes) const {
+    static const SqliteValue null = std::monostate();
+    auto column = [&](int index) -> const SqliteValue & {
+        int rowIndex = columnIndexes[index];
+        return rowIndex == -1 ? null : row[rowIndex];
+    };
+
+    switch (node.type) {
+        case MatcherNode::Type::all:
+            for (auto const &condition : node.conditions) {
+                if (!matches(condition, row, columnIndexes)) {
+                    return false;
+                }
+            }
+            return true;
+        case MatcherNode::Type::any:
+            for (auto const &condition : node.conditions) {
+                if (matches(condition, row, columnIndexes)) {
+                    return true;
+                }
+            }
+            return false;
+        case MatcherNode::Type::where:
+            break;
+    }
+
+    auto &left = column(node.leftColumn);
+    auto &right = node.rightColumn == -1 ? node.value : column(node.rightColumn);
+    auto comparison = [&]() { return compareValues(left, right); };
+
+    switch (node.comparisonOperator) {
+        case MatcherOperator::eq:
+            return valuesEqual(left, right);
+        case MatcherOperator::notEq:
+            return !valuesEqual(left, right);
+        case MatcherOperator::gt: {
+            auto result = comparison();
+            return result && *result > 0;
+        }
+        case MatcherOperator::gte: {
+            auto result = comparison();
+            return result && *result >= 0;
+        }
+        case MatcherOperator::weakGt: {
+            // Same as gt, but also true if left is not null, and right is
+            auto result = comparison();
+            return (result && *result > 0) || (!isNull(left) && isNull(right));
+        }
+        case MatcherOperator::lt: {
+            auto result = comparison();
+            return result && *result < 0;
+        }
+        case MatcherOperator::lte: {
+            auto result = comparison();
+            return result && *result <= 0;
+        }
+        case MatcherOperator::oneOf:
+            return isOneOf(left, node.values);
+        case MatcherOperator::notIn:
+            return !isNull(left) && !isOneOf(left, node.values);
+        case MatcherOperator::between: {
+            auto lower = compareValues(left, node.values[0]);
+            auto upper = compareValues(left, node.values[1]);
+            return lower && upper && *lower >= 0 && *upper <= 0;
+        }
+        case MatcherOperator::like:
+            return like(left, right);
+        case MatcherOperator::notLike:
+            return !isNull(left) && !like(left, right);
+        case MatcherOperator::includes: {
+            auto leftString = std::get_if<std::string>(&left);
+            auto rightString = std::get_if<std::string>(&right);
+            return leftString && rightString && leftString->find(*rightString) != std::string::npos;
+        }
+    }
+    return false;
+}
+
+// MARK: - Registry
+
+int ObservationMatcherRegistry::add(ObservationMatcher matcher) {
+    int handle = nextHandle_++;
+    handlesByTable_[matcher.table()].push_back(handle);
+    matchers_.emplace(handle, std::move(matcher));
+    return handle;
+}
+
+void ObservationMatcherRegistry::remove(int handle) {
+    auto found = matchers_.find(handle);
+    if (found == matchers_.end()) {
+        return;
+    }
+
+    auto &table = found->second.table();
+    auto &handles = handlesByTable_[table];
+    handles.erase(std::remove(handles.begin(), handles.end(), handle), handles.end());
+    if (handles.empty()) {
+        handlesByTable_.erase(table);
+        changedRows_.erase(table);
+    }
+    matchers_.erase(found);
+}
+
+void ObservationMatcherRegistry::markChanged(const ChangeSet &changes) {
+    for (auto const &table : changes) {
+        if (!handlesByTable_.count(table.first)) {
+            continue;
+        }
+        auto &changed = changedRows_[table.first];
+        auto &rowids = changed.rowids;
+        rowids.insert(rowids.end(), table.second.inserted.begin(), table.second.inserted.end());
+        rowids.insert(rowids.end(), table.second.updated.begin(), table.second.updated.end());
+        auto &deletedIds = changed.deletedIds;
+        deletedIds.insert(deletedIds.end(), table.second.deletedIds.begin(), table.second.deletedIds.end());
+        // NOTE: Only rows deleted by batch have known ids
+        if (table.second.deleted.size() > table.second.deletedIds.size()) {
+            changed.hasUnknownDeletions = true;
+        }
+    }
+}
+
+void ObservationMatcherRegistry::markUnknownDeletions() {
+    for (auto const &table : handlesByTable_) {
+        changedRows_[table.first].hasUnknownDeletions = true;
+    }
+}
+
+std::unordered_map<std::string, MatcherTableChanges> ObservationMatcherRegistry::takeChangedRows() {
+    std::unordered_map<std::string, MatcherTableChanges> changedRows;
+    std::swap(changedRows, changedRows_);
+    for (auto &table : changedRows) {
+        auto &rowids = table.second.rowids;
+        std::sort(rowids.begin(), rowids.end());
+        rowids.erase(std::unique(rowids.begin(), rowids.end()), rowids.end());
+        auto &deletedIds = table.second.deletedIds;
+        std::sort(deletedIds.begin(), deletedIds.end());
+        deletedIds.erase(std::unique(deletedIds.begin(), deletedIds.end()), deletedIds.end());
+    }
+    return changedRows;
+}
+
+std::vector<std::pair<int, const ObservationMatcher *>> ObservationMatcherRegistry::matchersOf(const std::string &table) {
+    std::vector<std::pair<int, const ObservationMatcher *>> matchers;
+    auto handles = handlesByTable_.find(table);
+    if (handles != handlesByTable_.end()) {
+        for (auto handle : handles->second) {
+            matchers.emplace_back(handle, &matchers_.at(handle));
+        }
+    }
+    return matchers;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,93 @@
+#pragma once
+
+#import <string>
+#import <string_view>
+#import <unordered_map>
+#import <vector>
+
+#import "ChangeCapture.h"
+#import "SqliteArray.h"
+
+namespace watermelondb {
+
+enum class MatcherOperator { eq, notEq, gt, gte, weakGt, lt, lte, oneOf, notIn, between, like, notLike, includes };
+
+// Compiled Q.where/Q.and/Q.or clause. Columns are indexes into ObservationMatcher::columns()
+struct MatcherNode {
+    enum class Type { all, any, where };
+
+    Type type = Type::all;
+    std::vector<MatcherNode> conditions; // all/any
+    int leftColumn = -1;
+    int rightColumn = -1; // if compared to another column
+    MatcherOperator comparisonOperator = MatcherOperator::eq;
+    SqliteValue value;
+    std::vector<SqliteValue> values; // oneOf/notIn/between
+};
+
+// Native equivalent of src/observation/encodeMatcher - conditions of a simple query (no joins, sortBy, etc.),
+// compiled once, and then evaluated against raw rows.
+// NOTE: Like in SQL (and unlike in JS), values of different types (number vs text) are never equal or
+// comparable, and booleans are compared as 1/0
+class ObservationMatcher {
+public:
+    // Compiles JSON-serialized `QueryDescription.where` (an array of conditions). Throws if conditions can't
+    // be evaluated by a matcher (e.g. Q.on, Q.unsafeSqlExpr)
+    static ObservationMatcher compile(std::string table, std::string_view whereJson);
+
+    const std::string &table() const { return table_; }
+    // Names of columns used by conditions
+    const std::vector<std::string> &columns() const { return columns_; }
+    // Checks if row matches conditions. `columnIndexes` maps columns() to indexes of `row` (or -1 if the row
+    // doesn't have the column - it's treated as null)
+    bool matches(const std::vector<SqliteValue> &row, const std::vector<int> &columnIndexes) const;
+
+private:
+    std::string table_;
+    std::vector<std::string> columns_;
+    MatcherNode root_;
+
+    int columnIndex(std::string_view column);
+    bool matches(const MatcherNode &node, const std::vector<SqliteValue> &row, const std::vector<int> &columnIndexes) const;
+};
+
+// Rows of a table changed since its matchers were last checked
+struct MatcherTableChanges {
+    std::vector<int64_t> rowids; // inserted or updated
+    std::vector<std::string> deletedIds; // records deleted by batch (destroyPermanently)
+    // NOTE: Ids of rows deleted by other queries (including raw SQL) can't be known (see ChangeCapture.h)
+    bool hasUnknownDeletions = false;
+};
+
+// Changed records of a matcher's table. Every matcher of a table with changed rows is reported, because a record
+// that no longer matches (or was deleted) changes results of a query just like a newly matching one
+struct MatcherChanges {
+    int handle;
+    std::vector<std::string> matchingIds;
+    std::vector<std::string> unmatchedIds; // changed, but not matching, or deleted
+    bool hasUnknownDeletions;
+};
+
+// Registered matchers, with rows changed since they were last checked.
+// NOTE: Not thread-safe - must be used with the database locked
+class ObservationMatcherRegistry {
+public:
+    int add(ObservationMatcher matcher);
+    void remove(int handle);
+    // Remembers changed rows of tables that have matchers
+    void markChanged(const ChangeSet &changes);
+    // Marks all tables that have matchers as having rows deleted with unknown ids, e.g. after raw SQL
+    void markUnknownDeletions();
+    // Returns changed rows (by table), and forgets them
+    std::unordered_map<std::string, MatcherTableChanges> takeChangedRows();
+    // Matchers of the table (by handle)
+    std::vector<std::pair<int, const ObservationMatcher *>> matchersOf(const std::string &table);
+
+private:
+    int nextHandle_ = 1;
+    std::unordered_map<int, ObservationMatcher> matchers_;
+    std::unordered_map<std::string, std::vector<int>> handlesByTable_;
+    std::unordered_map<std::string, MatcherTableChanges> changedRows_;
+};
+
+} // namespace watermelondb
@@ -0,0 +1,34 @@
+#pragma once
+
+#import <string>
+#import <vector>
+
+#import "SqliteArray.h"
+
+namespace watermelondb {
+
+// Query results, read off the JS thread, to be converted to JS values later
+struct QueryResult {
+    std::vector<std::string> columnNames;
+    std::vector<SqliteValue> values; // row-major. Rows of cached records only contain the id
+    std::vector<bool> isCachedId; // for each row
+};
+
+// Read query (e.g. made with queryMany) - `records` are results of `query` (with records cached in JS replaced
+// by ids, so `table` must be passed), `ids` of `queryIds`, `count` of `count`, and `raw` of `unsafeQueryRaw`
+enum class ReadQueryKind { records, ids, count, raw };
+
+struct ReadQuery {
+    ReadQueryKind kind;
+    std::string table;
+    std::string sql;
+    std::vector<SqliteValue> arguments;
+};
+
+struct ReadQueryResult {
+    ReadQueryKind kind;
+    QueryResult rows;
+    int count = 0;
+};
+
+} // namespace watermelondb
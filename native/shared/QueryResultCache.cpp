@@ -0,0 +1,161 @@
+#include "QueryResultCache.h"
+
+namespace watermelondb {
+
+// Appends a value to a cache key, prefixed with its type (and length), so that different arguments can't
+// produce the same key
+static void appendKey(std::string &key, const SqliteValue &value) {
+    if (std::holds_alternative<std::monostate>(value)) {
+        key += 'n';
+    } else if (auto integer = std::get_if<int64_t>(&value)) {
+        key += 'i';
+        key.append(reinterpret_cast<const char *>(integer), sizeof(int64_t));
+    } else if (auto number = std::get_if<double>(&value)) {
+        key += 'd';
+        key.append(reinterpret_cast<const char *>(number), sizeof(double));
+    } else if (auto text = std::get_if<std::string>(&value)) {
+        uint64_t length = text->size();
+        key += 's';
+        key.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        key += *text;
+    } else if (auto array = std::get_if<std::shared_ptr<SqliteValueArray>>(&value)) {
+        uint64_t length = (*array)->values.size();
+        key += 'a';
+        key.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        for (auto const &element : (*array)->values) {
+            appendKey(key, element);
+        }
+    }
+}
+
+static size_t memoryUsedBy(const ReadQueryResult &result) {
+    size_t memoryUsed = sizeof(ReadQueryResult) + result.rows.values.size() * sizeof(SqliteValue) +
+                        result.rows.isCachedId.size() / 8;
+    for (auto const &column : result.rows.columnNames) {
+        memoryUsed += column.capacity();
+    }
+    for (auto const &value : result.rows.values) {
+        if (auto text = std::get_if<std::string>(&value)) {
+            memoryUsed += text->capacity();
+        }
+    }
+    return memoryUsed;
+}
+
+std::string QueryResultCache::keyFor(const ReadQuery &query) {
+    std::string key;
+    key += (char) query.kind;
+    // NOTE: Records are cached as read from the database, so table only matters when they're returned
+    key += query.sql;
+    key += '\0';
+    for (auto const &argument : query.arguments) {
+        appendKey(key, argument);
+    }
+    return key;
+}
+
+void QueryResultCache::setMaxMemory(size_t maxMemory) {
+    maxMemory_ = maxMemory;
+    if (!maxMemory) {
+        clear();
+    } else {
+        evictIfNeeded();
+    }
+}
+
+std::shared_ptr<const ReadQueryResult> QueryResultCache::get(const std::string &key) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    auto found = entriesByKey_.find(key);
+    if (found == entriesByKey_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+
+    stats_.hits++;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->result;
+}
+
+void QueryResultCache::put(std::string key, const std::vector<std::string> &tables, uint64_t version, std::shared_ptr<const ReadQueryResult> result) {
+    if (!isEnabled() || tables.empty() || version < clearedVersion_) {
+        return;
+    }
+    for (auto const &table : tables) {
+        auto tableVersion = tableVersions_.find(table);
+        if (tableVersion != tableVersions_.end() && tableVersion->second > version) {
+            return; // NOTE: Changed while the query was executed, so result may be outdated already
+        }
+    }
+
+    auto found = entriesByKey_.find(key);
+    if (found != entriesByKey_.end()) {
+        erase(found->second);
+    }
+
+    size_t memoryUsed = sizeof(Entry) + key.size() * 2 + memoryUsedBy(*result);
+    for (auto const &table : tables) {
+        memoryUsed += table.capacity();
+    }
+
+    entries_.push_front(Entry { key, tables, std::move(result), memoryUsed });
+    entriesByKey_[std::move(key)] = entries_.begin();
+    memoryUsed_ += memoryUsed;
+    evictIfNeeded();
+}
+
+void QueryResultCache::markChanged(const ChangeSet &changes) {
+    if (changes.empty()) {
+        return;
+    }
+
+    version_++;
+    for (auto const &table : changes) {
+        tableVersions_[table.first] = version_;
+    }
+
+    for (auto entry = entries_.begin(); entry != entries_.end();) {
+        auto current = entry++;
+        for (auto const &table : current->tables) {
+            if (changes.count(table)) {
+                stats_.invalidations++;
+                erase(current);
+                break;
+            }
+        }
+    }
+}
+
+void QueryResultCache::clear() {
+    version_++;
+    clearedVersion_ = version_;
+    tableVersions_.clear();
+    stats_.invalidations += entries_.size();
+    entries_.clear();
+    entriesByKey_.clear();
+    memoryUsed_ = 0;
+}
+
+QueryCacheStats QueryResultCache::stats() {
+    QueryCacheStats stats = stats_;
+    stats.entries = entries_.size();
+    stats.memoryUsed = memoryUsed_;
+    return stats;
+}
+
+void QueryResultCache::erase(std::list<Entry>::iterator entry) {
+    memoryUsed_ -= entry->memoryUsed;
+    entriesByKey_.erase(entry->key);
+    entries_.erase(entry);
+}
+
+void QueryResultCache::evictIfNeeded() {
+    while (!entries_.empty() && memoryUsed_ > maxMemory_) {
+        stats_.evictions++;
+        erase(std::prev(entries_.end()));
+    }
+}
+
+} // namespace watermelondb
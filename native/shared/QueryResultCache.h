@@ -0,0 +1,66 @@
+#pragma once
+
+#import <cstdint>
+#import <list>
+#import <memory>
+#import <string>
+#import <unordered_map>
+#import <vector>
+
+#import "QueryResult.h"
+#import "ChangeCapture.h"
+
+namespace watermelondb {
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    size_t entries = 0;
+    size_t memoryUsed = 0; // approximate, in bytes
+};
+
+// Cache of results of read queries, by kind, SQL and arguments. Each result is tagged with tables read by its
+// query (see QueryTables), and it's invalidated when a transaction that changes one of them is committed.
+// Bounded by memory used - least recently used results are evicted.
+// NOTE: Queries can be executed without the lock held, so a result must be cached with the version taken
+// before the query was executed. If any of its tables changed since, the result is not cached.
+// NOTE: Not thread-safe - must be used with the database locked
+class QueryResultCache {
+public:
+    // Cache is disabled if maxMemory is 0
+    void setMaxMemory(size_t maxMemory);
+    bool isEnabled() const { return maxMemory_ > 0; }
+
+    static std::string keyFor(const ReadQuery &query);
+    std::shared_ptr<const ReadQueryResult> get(const std::string &key);
+    uint64_t version() const { return version_; }
+    void put(std::string key, const std::vector<std::string> &tables, uint64_t version, std::shared_ptr<const ReadQueryResult> result);
+
+    void markChanged(const ChangeSet &changes);
+    void clear();
+    QueryCacheStats stats();
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<std::string> tables;
+        std::shared_ptr<const ReadQueryResult> result;
+        size_t memoryUsed;
+    };
+
+    size_t maxMemory_ = 0;
+    std::list<Entry> entries_; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entriesByKey_;
+    uint64_t version_ = 0;
+    std::unordered_map<std::string, uint64_t> tableVersions_; // version at which table was last changed
+    uint64_t clearedVersion_ = 0;
+    size_t memoryUsed_ = 0;
+    QueryCacheStats stats_;
+
+    void erase(std::list<Entry>::iterator entry);
+    void evictIfNeeded();
+};
+
+} // namespace watermelondb
@@ -0,0 +1,108 @@
+#include "QueryTables.h"
+#include "DatabasePlatform.h"
+
+namespace watermelondb {
+
+using platform::consoleError;
+
+// NOTE: Tables of distinct SQL are remembered until schema changes, so a limit is needed in case SQL is generated
+// (e.g. with values inlined)
+static const size_t maxRememberedSql = 512;
+
+QueryTables::QueryTables(std::string path) : path_(path) {
+}
+
+QueryTables::~QueryTables() {
+    destroy();
+}
+
+void QueryTables::destroy() {
+    if (schemaVersionStatement_) {
+        sqlite3_finalize(schemaVersionStatement_);
+        schemaVersionStatement_ = nullptr;
+    }
+    if (db_) {
+        db_->destroy();
+        db_ = nullptr;
+    }
+    tablesBySql_.clear();
+}
+
+bool QueryTables::open() {
+    if (db_) {
+        return true;
+    } else if (failedToOpen_) {
+        return false;
+    }
+
+    try {
+        db_ = std::make_unique<SqliteDb>(path_, true);
+    } catch (const std::exception &ex) {
+        consoleError(std::string("Failed to open connection used to find tables of queries - ") + ex.what());
+        failedToOpen_ = true;
+        return false;
+    }
+
+    // NOTE: Nothing is ever executed on this connection, so the authorizer is only installed once
+    auto authorizer = [](void *context, int action, const char *table, const char *, const char *, const char *) {
+        if (action == SQLITE_READ && table) {
+            static_cast<std::set<std::string> *>(context)->insert(table);
+        }
+        return SQLITE_OK;
+    };
+    sqlite3_set_authorizer(db_->sqlite, authorizer, &authorizedTables_);
+
+    if (sqlite3_prepare_v2(db_->sqlite, "pragma schema_version", -1, &schemaVersionStatement_, nullptr) != SQLITE_OK) {
+        consoleError("Failed to prepare schema version query - " + std::string(sqlite3_errmsg(db_->sqlite)));
+        destroy();
+        failedToOpen_ = true;
+        return false;
+    }
+    return true;
+}
+
+int64_t QueryTables::currentSchemaVersion() {
+    int64_t version = -1;
+    if (sqlite3_step(schemaVersionStatement_) == SQLITE_ROW) {
+        version = sqlite3_column_int64(schemaVersionStatement_, 0);
+    }
+    sqlite3_reset(schemaVersionStatement_);
+    return version;
+}
+
+std::optional<std::vector<std::string>> QueryTables::tablesReadBy(const std::string &sql) {
+    if (!open()) {
+        return std::nullopt;
+    }
+
+    // NOTE: Schema changes (e.g. a view redefined by raw SQL) can change tables read by a query
+    auto schemaVersion = currentSchemaVersion();
+    if (schemaVersion == -1) {
+        return std::nullopt;
+    } else if (schemaVersion != schemaVersion_) {
+        tablesBySql_.clear();
+        schemaVersion_ = schemaVersion;
+    }
+
+    auto found = tablesBySql_.find(sql);
+    if (found != tablesBySql_.end()) {
+        return found->second;
+    }
+
+    authorizedTables_.clear();
+    sqlite3_stmt *statement = nullptr;
+    int result = sqlite3_prepare_v2(db_->sqlite, sql.c_str(), -1, &statement, nullptr);
+    sqlite3_finalize(statement);
+    if (result != SQLITE_OK) {
+        return std::nullopt;
+    }
+
+    if (tablesBySql_.size() >= maxRememberedSql) {
+        tablesBySql_.clear();
+    }
+    std::vector<std::string> tables(authorizedTables_.begin(), authorizedTables_.end());
+    tablesBySql_[sql] = tables;
+    return tables;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,48 @@
+#pragma once
+
+#import <cstdint>
+#import <memory>
+#import <optional>
+#import <set>
+#import <string>
+#import <unordered_map>
+#import <vector>
+#import <sqlite3.h>
+
+#import "Sqlite.h"
+
+namespace watermelondb {
+
+// Finds tables read by queries (so that their cached results can be invalidated when those tables change), and
+// remembers them until the database schema changes.
+// Tables are found by preparing a query with an authorizer. Installing an authorizer expires all statements of
+// a connection, so this is done on a separate, read-only connection - never on one that executes queries.
+// NOTE: Not thread-safe - must be used with the database locked
+class QueryTables {
+public:
+    // Connection is opened lazily, when tables of a query are first needed
+    QueryTables(std::string path);
+    ~QueryTables();
+    void destroy();
+
+    // Returns names of tables read by a query, or nullopt if they can't be found (e.g. query uses a temporary
+    // table, which other connections don't see)
+    std::optional<std::vector<std::string>> tablesReadBy(const std::string &sql);
+
+    QueryTables &operator=(const QueryTables &) = delete;
+    QueryTables(const QueryTables &) = delete;
+
+private:
+    std::string path_;
+    std::unique_ptr<SqliteDb> db_;
+    bool failedToOpen_ = false;
+    sqlite3_stmt *schemaVersionStatement_ = nullptr;
+    int64_t schemaVersion_ = -1;
+    std::set<std::string> authorizedTables_; // tables read by query being prepared
+    std::unordered_map<std::string, std::vector<std::string>> tablesBySql_;
+
+    bool open();
+    int64_t currentSchemaVersion();
+};
+
+} // namespace watermelondb
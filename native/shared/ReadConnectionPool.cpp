@@ -0,0 +1,105 @@
+#include "ReadConnectionPool.h"
+#include "Database.h"
+#include "DatabasePlatform.h"
+#include <cassert>
+
+namespace watermelondb {
+
+using platform::consoleError;
+
+ReadConnection::ReadConnection(std::string path) : db(path, true) {
+}
+
+ReadConnection::~ReadConnection() {
+    statementCache.clear();
+    db.destroy();
+}
+
+sqlite3_stmt *ReadConnection::prepareQuery(std::string sql) {
+    return statementCache.prepare(db.sqlite, sql);
+}
+
+ReadConnectionPool::ReadConnectionPool(std::string path, size_t size) : path_(path), queue_("watermelondb-read", size) {
+}
+
+ReadConnectionPool::~ReadConnectionPool() {
+    destroy();
+}
+
+void ReadConnectionPool::destroy() {
+    // NOTE: Reads that were already dispatched are finished first
+    queue_.destroy();
+    const std::lock_guard<std::mutex> lock(mutex_);
+    idleConnections_.clear();
+}
+
+void ReadConnectionPool::dispatch(std::function<void(ReadConnection *)> read, std::function<void(void)> complete) {
+    // NOTE: Locked until work is queued, so that tickets are in queue order. Otherwise, with all threads
+    // waiting for an earlier ticket that's not yet running, we'd deadlock
+    const std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t ticket = dispatchedCount_++;
+
+    queue_.dispatch([this, ticket, read = std::move(read), complete = std::move(complete)]() {
+        std::unique_ptr<ReadConnection> connection;
+        try {
+            connection = takeConnection();
+        } catch (const std::exception &ex) {
+            consoleError("Failed to open read connection - " + std::string(ex.what()));
+        }
+
+        read(connection.get());
+
+        if (connection) {
+            returnConnection(std::move(connection));
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            completed_.wait(lock, [this, ticket]() {
+                return completedCount_ == ticket;
+            });
+        }
+
+        complete();
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            completedCount_++;
+        }
+        completed_.notify_all();
+    });
+}
+
+void ReadConnectionPool::waitUntilIdle() {
+    queue_.waitUntilIdle();
+}
+
+StatementCacheStats ReadConnectionPool::statementCacheStats() {
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    StatementCacheStats stats;
+    for (auto const &connection : idleConnections_) {
+        stats += connection->statementCache.stats();
+    }
+    return stats;
+}
+
+std::unique_ptr<ReadConnection> ReadConnectionPool::takeConnection() {
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (!idleConnections_.empty()) {
+            auto connection = std::move(idleConnections_.back());
+            idleConnections_.pop_back();
+            return connection;
+        }
+    }
+    // NOTE: There are never more connections than threads
+    return std::make_unique<ReadConnection>(path_);
+}
+
+void ReadConnectionPool::returnConnection(std::unique_ptr<ReadConnection> connection) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    idleConnections_.push_back(std::move(connection));
+}
+
+} // namespace watermelondb
@@ -0,0 +1,63 @@
+#pragma once
+
+#import <condition_variable>
+#import <functional>
+#import <memory>
+#import <mutex>
+#import <string>
+#import <vector>
+#import <sqlite3.h>
+
+#import "Sqlite.h"
+#import "StatementCache.h"
+#import "WorkQueue.h"
+
+namespace watermelondb {
+
+// Read-only connection to the database, with its own cache of prepared statements
+class ReadConnection {
+public:
+    ReadConnection(std::string path);
+    ~ReadConnection();
+
+    sqlite3_stmt *prepareQuery(std::string sql);
+
+    SqliteDb db;
+    StatementCache statementCache;
+};
+
+// Pool of read-only connections, used to execute reads in parallel on worker threads. This only makes sense
+// in WAL mode, where readers don't block each other (or the writer).
+// Connections are opened lazily, on the thread that first needs them
+class ReadConnectionPool {
+public:
+    ReadConnectionPool(std::string path, size_t size);
+    ~ReadConnectionPool();
+    void destroy();
+
+    // Executes `read` on one of the connections, in parallel with other reads. Then, `complete` is executed
+    // in the order in which reads were dispatched (not in the order in which they finished).
+    // If a read connection can't be opened, `read` is called with nullptr. Neither block may throw
+    void dispatch(std::function<void(ReadConnection *)> read, std::function<void(void)> complete);
+    // Blocks until all reads dispatched so far are complete
+    void waitUntilIdle();
+    // Stats of statement caches of connections that are not in use
+    StatementCacheStats statementCacheStats();
+
+    ReadConnectionPool &operator=(const ReadConnectionPool &) = delete;
+    ReadConnectionPool(const ReadConnectionPool &) = delete;
+
+private:
+    std::string path_;
+    WorkQueue queue_;
+    std::mutex mutex_;
+    std::condition_variable completed_;
+    std::vector<std::unique_ptr<ReadConnection>> idleConnections_;
+    uint64_t dispatchedCount_ = 0;
+    uint64_t completedCount_ = 0;
+
+    std::unique_ptr<ReadConnection> takeConnection();
+    void returnConnection(std::unique_ptr<ReadConnection> connection);
+};
+
+} // namespace watermelondb
@@ -0,0 +1,48 @@
+#pragma once
+
+#import <memory>
+#import <string>
+#import <vector>
+
+#import "SqliteArray.h"
+
+namespace watermelondb {
+
+// Schema of a table registered by JS (see Database::registerSchema), with SQL of batch operations on its
+// records - the same as made by src/adapters/sqlite/encodeBatch
+struct RegisteredTable {
+    std::string name;
+    std::vector<std::string> columns; // NOTE: without id, _status, _changed
+    std::string insertSql;
+    std::string updateSql;
+    std::string markAsDeletedSql;
+    std::string destroyPermanentlySql;
+    // Runs of at least `rowsPerInsert` creates are inserted with a multi-row `insert ... values (...), (...)`
+    // (1 if multi-row inserts are not used for this table)
+    size_t rowsPerInsert;
+    std::string multiRowInsertSql;
+    // Shorter runs (and tails of long runs) of at least `tailRowsPerInsert` creates are inserted with a second,
+    // smaller multi-row insert (0 if there's none)
+    size_t tailRowsPerInsert = 0;
+    std::string tailInsertSql;
+
+    // `maxVariables` is the connection's limit of arguments per statement (SQLITE_LIMIT_VARIABLE_NUMBER)
+    RegisteredTable(std::string name, std::vector<std::string> columns, size_t maxVariables);
+};
+
+enum class RecordOperationType { create, update, markAsDeleted, destroyPermanently };
+
+// Batch operation on a single record, with values already in order of arguments of the operation's SQL:
+// - create: id, _status, _changed, columns
+// - update: _status, _changed, columns, id
+// - markAsDeleted, destroyPermanently: id
+struct RecordOperation {
+    RecordOperationType type;
+    std::shared_ptr<const RegisteredTable> table;
+    std::vector<SqliteValue> values;
+
+    const std::string &sql() const;
+    const std::string &id() const;
+};
+
+} // namespace watermelondb
@@ -0,0 +1,187 @@
+#include "RecordIdCache.h"
+#include <cstring>
+#include <functional>
+
+namespace watermelondb {
+
+static const size_t minSlotCount = 16;
+
+// Smallest power of 2 that keeps the hash table at most half full
+static size_t slotCountFor(size_t count) {
+    size_t slotCount = minSlotCount;
+    while (slotCount < count * 2) {
+        slotCount *= 2;
+    }
+    return slotCount;
+}
+
+// MARK: - RecordIdSet
+
+uint32_t RecordIdSet::hashOf(std::string_view id) {
+    return (uint32_t) std::hash<std::string_view>()(id);
+}
+
+size_t RecordIdSet::find(std::string_view id, uint32_t hash) const {
+    if (slots_.empty()) {
+        return SIZE_MAX;
+    }
+
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        auto &slot = slots_[i];
+        if (slot.length == emptySlot) {
+            return SIZE_MAX;
+        } else if (slot.length != deletedSlot && slot.hash == hash && slot.length == id.size() &&
+                   std::memcmp(ids_.data() + slot.offset, id.data(), id.size()) == 0) {
+            return i;
+        }
+    }
+}
+
+bool RecordIdSet::contains(std::string_view id) const {
+    return find(id, hashOf(id)) != SIZE_MAX;
+}
+
+bool RecordIdSet::insert(std::string_view id) {
+    // NOTE: Deleted slots also count - a probe only stops at an empty slot
+    if ((count_ + deletedSlots_ + 1) * 4 > slots_.size() * 3) {
+        rehash(slotCountFor(count_ + 1));
+    }
+
+    uint32_t hash = hashOf(id);
+    size_t mask = slots_.size() - 1;
+    size_t target = SIZE_MAX;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        auto &slot = slots_[i];
+        if (slot.length == emptySlot) {
+            if (target == SIZE_MAX) {
+                target = i;
+            }
+            break;
+        } else if (slot.length == deletedSlot) {
+            if (target == SIZE_MAX) {
+                target = i;
+            }
+        } else if (slot.hash == hash && slot.length == id.size() &&
+                   std::memcmp(ids_.data() + slot.offset, id.data(), id.size()) == 0) {
+            return false;
+        }
+    }
+
+    if (slots_[target].length == deletedSlot) {
+        deletedSlots_--;
+    }
+    slots_[target] = { (uint32_t) ids_.size(), (uint32_t) id.size(), hash };
+    ids_.insert(ids_.end(), id.begin(), id.end());
+    count_++;
+    return true;
+}
+
+bool RecordIdSet::erase(std::string_view id) {
+    size_t index = find(id, hashOf(id));
+    if (index == SIZE_MAX) {
+        return false;
+    }
+
+    deletedBytes_ += slots_[index].length;
+    slots_[index].length = deletedSlot;
+    count_--;
+    deletedSlots_++;
+
+    if (count_ == 0) {
+        clear();
+    } else if (deletedBytes_ > ids_.size() / 2 || slots_.size() > slotCountFor(count_) * 4) {
+        // NOTE: Memory of erased ids is only given back when at least half of the buffer is unused, so that
+        // evicting ids one by one doesn't copy the whole set each time
+        rehash(slotCountFor(count_));
+    }
+    return true;
+}
+
+void RecordIdSet::clear() {
+    ids_ = {};
+    slots_ = {};
+    count_ = 0;
+    deletedSlots_ = 0;
+    deletedBytes_ = 0;
+}
+
+size_t RecordIdSet::memoryUsed() const {
+    return ids_.capacity() + slots_.capacity() * sizeof(Slot);
+}
+
+void RecordIdSet::rehash(size_t slotCount) {
+    std::vector<char> ids;
+    ids.reserve(ids_.size() - deletedBytes_);
+    std::vector<Slot> slots(slotCount, { 0, emptySlot, 0 });
+
+    size_t mask = slotCount - 1;
+    for (auto const &slot : slots_) {
+        if (slot.length == emptySlot || slot.length == deletedSlot) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].length != emptySlot) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = { (uint32_t) ids.size(), slot.length, slot.hash };
+        ids.insert(ids.end(), ids_.begin() + slot.offset, ids_.begin() + slot.offset + slot.length);
+    }
+
+    ids_ = std::move(ids);
+    slots_ = std::move(slots);
+    deletedSlots_ = 0;
+    deletedBytes_ = 0;
+}
+
+// MARK: - RecordIdCache
+
+RecordIdSet &RecordIdCache::table(const std::string &tableName) {
+    return tables_[tableName];
+}
+
+bool RecordIdCache::contains(std::string_view tableName, std::string_view id) const {
+    auto found = tables_.find(tableName);
+    return found != tables_.end() && found->second.contains(id);
+}
+
+void RecordIdCache::insert(const std::string &tableName, std::string_view id) {
+    table(tableName).insert(id);
+}
+
+void RecordIdCache::erase(std::string_view tableName, std::string_view id) {
+    auto found = tables_.find(tableName);
+    if (found != tables_.end()) {
+        found->second.erase(id);
+    }
+}
+
+size_t RecordIdCache::evict(std::string_view tableName, const std::vector<std::string> &ids) {
+    auto found = tables_.find(tableName);
+    if (found == tables_.end()) {
+        return 0;
+    }
+
+    size_t evicted = 0;
+    for (auto const &id : ids) {
+        if (found->second.erase(id)) {
+            evicted++;
+        }
+    }
+    return evicted;
+}
+
+void RecordIdCache::clear() {
+    tables_.clear();
+}
+
+RecordCacheStats RecordIdCache::stats() const {
+    RecordCacheStats stats = { tables_.size(), 0, 0 };
+    for (auto const &table : tables_) {
+        stats.records += table.second.size();
+        stats.memoryUsed += table.first.capacity() + sizeof(table) + table.second.memoryUsed();
+    }
+    return stats;
+}
+
+} // namespace watermelondb
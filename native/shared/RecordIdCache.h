@@ -0,0 +1,70 @@
+#pragma once
+
+#import <cstdint>
+#import <map>
+#import <string>
+#import <string_view>
+#import <vector>
+
+namespace watermelondb {
+
+// Set of ids of one table. Ids are stored back to back in one buffer, and indexed by an open addressing hash
+// table (linear probing), so that adding an id doesn't allocate, and ids can be looked up without copying
+// them into a std::string
+class RecordIdSet {
+public:
+    bool contains(std::string_view id) const;
+    // Returns true if the id was added (wasn't in the set)
+    bool insert(std::string_view id);
+    // Returns true if the id was removed
+    bool erase(std::string_view id);
+    void clear();
+
+    size_t size() const { return count_; }
+    size_t memoryUsed() const;
+
+private:
+    struct Slot {
+        uint32_t offset;
+        uint32_t length; // or emptySlot/deletedSlot
+        uint32_t hash;
+    };
+    static constexpr uint32_t emptySlot = UINT32_MAX;
+    static constexpr uint32_t deletedSlot = UINT32_MAX - 1;
+
+    std::vector<char> ids_;
+    std::vector<Slot> slots_; // NOTE: size is a power of 2
+    size_t count_ = 0;
+    size_t deletedSlots_ = 0;
+    size_t deletedBytes_ = 0; // of erased ids, until the buffer is compacted
+
+    static uint32_t hashOf(std::string_view id);
+    size_t find(std::string_view id, uint32_t hash) const;
+    // Rebuilds the hash table with the given number of slots, and compacts the ids buffer
+    void rehash(size_t slotCount);
+};
+
+struct RecordCacheStats {
+    size_t tables;
+    size_t records;
+    size_t memoryUsed; // bytes
+};
+
+// Ids of records cached in JS, by table. If a record is known to be cached, only its id is sent to JS
+// NOTE: Not thread-safe - must be used with the database locked
+class RecordIdCache {
+public:
+    RecordIdSet &table(const std::string &tableName);
+    bool contains(std::string_view tableName, std::string_view id) const;
+    void insert(const std::string &tableName, std::string_view id);
+    void erase(std::string_view tableName, std::string_view id);
+    // Forgets ids released by JS's RecordCache. Returns number of ids that were cached
+    size_t evict(std::string_view tableName, const std::vector<std::string> &ids);
+    void clear();
+    RecordCacheStats stats() const;
+
+private:
+    std::map<std::string, RecordIdSet, std::less<>> tables_;
+};
+
+} // namespace watermelondb
@@ -0,0 +1,126 @@
+#include "RowCache.h"
+
+namespace watermelondb {
+
+std::string RowCache::keyFor(const std::string &table, std::string_view id) {
+    std::string key;
+    key.reserve(table.size() + 1 + id.size());
+    key += table;
+    key += '\0'; // NOTE: can't be a part of table name
+    key += id;
+    return key;
+}
+
+void RowCache::setLimits(size_t maxCount, size_t maxMemory) {
+    maxCount_ = maxCount;
+    maxMemory_ = maxMemory;
+    if (!maxCount) {
+        clear();
+    } else {
+        evictIfNeeded();
+    }
+}
+
+const CachedRow *RowCache::get(const std::string &table, std::string_view id) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    auto found = entriesByKey_.find(keyFor(table, id));
+    if (found == entriesByKey_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+
+    stats_.hits++;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return &found->second->row;
+}
+
+void RowCache::put(const std::string &table, std::string_view id, int64_t rowid, const std::vector<std::string> &columnNames, std::vector<SqliteValue> values) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    auto key = keyFor(table, id);
+    auto found = entriesByKey_.find(key);
+    if (found != entriesByKey_.end()) {
+        erase(found->second);
+    }
+    invalidate(table, rowid); // NOTE: rowids can be reused after a row is deleted
+
+    // NOTE: Column names only change on migration, so they're stored once per table
+    auto &tableColumnNames = columnNames_[table];
+    if (!tableColumnNames || *tableColumnNames != columnNames) {
+        tableColumnNames = std::make_shared<const std::vector<std::string>>(columnNames);
+    }
+
+    size_t memoryUsed = sizeof(Entry) + key.size() + table.size() + values.size() * sizeof(SqliteValue);
+    for (auto const &value : values) {
+        if (auto text = std::get_if<std::string>(&value)) {
+            memoryUsed += text->capacity();
+        }
+    }
+
+    entries_.push_front(Entry { key, table, rowid, CachedRow { tableColumnNames, std::move(values) }, memoryUsed });
+    entriesByKey_[std::move(key)] = entries_.begin();
+    entriesByRowid_[table][rowid] = entries_.begin();
+    memoryUsed_ += memoryUsed;
+    evictIfNeeded();
+}
+
+void RowCache::invalidate(const std::string &table, int64_t rowid) {
+    auto tableEntries = entriesByRowid_.find(table);
+    if (tableEntries == entriesByRowid_.end()) {
+        return;
+    }
+    auto found = tableEntries->second.find(rowid);
+    if (found != tableEntries->second.end()) {
+        stats_.invalidations++;
+        erase(found->second);
+    }
+}
+
+void RowCache::invalidate(const std::string &table, std::string_view id) {
+    auto found = entriesByKey_.find(keyFor(table, id));
+    if (found != entriesByKey_.end()) {
+        stats_.invalidations++;
+        erase(found->second);
+    }
+}
+
+void RowCache::clear() {
+    stats_.invalidations += entries_.size();
+    entries_.clear();
+    entriesByKey_.clear();
+    entriesByRowid_.clear();
+    columnNames_.clear();
+    memoryUsed_ = 0;
+}
+
+RowCacheStats RowCache::stats() {
+    RowCacheStats stats = stats_;
+    stats.rows = entries_.size();
+    stats.memoryUsed = memoryUsed_;
+    return stats;
+}
+
+void RowCache::erase(std::list<Entry>::iterator entry) {
+    memoryUsed_ -= entry->memoryUsed;
+    entriesByKey_.erase(entry->key);
+    auto tableEntries = entriesByRowid_.find(entry->table);
+    tableEntries->second.erase(entry->rowid);
+    if (tableEntries->second.empty()) {
+        entriesByRowid_.erase(tableEntries);
+    }
+    entries_.erase(entry);
+}
+
+void RowCache::evictIfNeeded() {
+    while (!entries_.empty() && (entries_.size() > maxCount_ || memoryUsed_ > maxMemory_)) {
+        stats_.evictions++;
+        erase(std::prev(entries_.end()));
+    }
+}
+
+} // namespace watermelondb
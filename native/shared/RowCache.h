@@ -0,0 +1,71 @@
+#pragma once
+
+#import <cstdint>
+#import <list>
+#import <memory>
+#import <string>
+#import <string_view>
+#import <unordered_map>
+#import <vector>
+
+#import "SqliteArray.h"
+
+namespace watermelondb {
+
+struct RowCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;
+    size_t rows = 0;
+    size_t memoryUsed = 0; // approximate, in bytes
+};
+
+// Column values of a record, as last read from the database
+struct CachedRow {
+    std::shared_ptr<const std::vector<std::string>> columnNames; // shared by rows of a table
+    std::vector<SqliteValue> values;
+};
+
+// Cache of recently read rows of records, by table and id, so that repeated finds don't have to step sqlite.
+// Bounded by row count and memory used - least recently used rows are evicted. Rows are invalidated by rowid
+// (from sqlite's update hook), so they must be cached with their rowid.
+// NOTE: Not thread-safe - must be used with the database locked
+class RowCache {
+public:
+    // Cache is disabled if maxCount is 0
+    void setLimits(size_t maxCount, size_t maxMemory);
+    bool isEnabled() const { return maxCount_ > 0; }
+
+    // Returns cached row (valid until cache is next modified), or nullptr
+    const CachedRow *get(const std::string &table, std::string_view id);
+    void put(const std::string &table, std::string_view id, int64_t rowid, const std::vector<std::string> &columnNames, std::vector<SqliteValue> values);
+    void invalidate(const std::string &table, int64_t rowid);
+    void invalidate(const std::string &table, std::string_view id);
+    void clear();
+    RowCacheStats stats();
+
+private:
+    struct Entry {
+        std::string key;
+        std::string table;
+        int64_t rowid;
+        CachedRow row;
+        size_t memoryUsed;
+    };
+
+    size_t maxCount_ = 0;
+    size_t maxMemory_ = 0;
+    std::list<Entry> entries_; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entriesByKey_;
+    std::unordered_map<std::string, std::unordered_map<int64_t, std::list<Entry>::iterator>> entriesByRowid_;
+    std::unordered_map<std::string, std::shared_ptr<const std::vector<std::string>>> columnNames_;
+    size_t memoryUsed_ = 0;
+    RowCacheStats stats_;
+
+    static std::string keyFor(const std::string &table, std::string_view id);
+    void erase(std::list<Entry>::iterator entry);
+    void evictIfNeeded();
+};
+
+} // namespace watermelondb
@@ -1,4 +1,5 @@
 #include "Sqlite.h"
+#include "SqliteArray.h"
 #include "DatabasePlatform.h"
 #include <cassert>
 
@@ -7,6 +8,17 @@ namespace watermelondb {
 using platform::consoleError;
 using platform::consoleLog;
 
+DatabaseError sqliteError(sqlite3 *db, std::string description) {
+    // TODO: In serialized threading mode, those may be incorrect - probably smarter to pass result codes around?
+    auto sqliteMessage = std::string(sqlite3_errmsg(db));
+    auto code = sqlite3_extended_errcode(db);
+    auto message = description + " - sqlite error " + std::to_string(code) + " (" + sqliteMessage + ")";
+    // Note: logging to console in case another exception is thrown so that the original error isn't lost
+    consoleError(message);
+
+    return DatabaseError(message);
+}
+
 std::string resolveDatabasePath(std::string path) {
     if (path == "" || path == ":memory:" || path.rfind("file:", 0) == 0 || path.rfind("/", 0) == 0) {
         // These seem like paths/sqlite path-like strings
@@ -17,27 +29,30 @@ std::string resolveDatabasePath(std::string path) {
     }
 }
 
-SqliteDb::SqliteDb(std::string path) {
+SqliteDb::SqliteDb(std::string path, bool readOnly) {
     platform::initializeSqlite();
     #ifndef ANDROID
     assert(sqlite3_threadsafe());
     #endif
 
     auto resolvedPath = resolveDatabasePath(path);
-    int openResult = sqlite3_open(resolvedPath.c_str(), &sqlite);
+    int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    int openResult = sqlite3_open_v2(resolvedPath.c_str(), &sqlite, flags, nullptr);
 
     if (openResult != SQLITE_OK) {
         if (sqlite) {
             auto error = std::string(sqlite3_errmsg(sqlite));
-            throw new std::runtime_error("Error while trying to open database - " + error);
+            throw std::runtime_error("Error while trying to open database - " + error);
         } else {
             // whoa, sqlite couldn't allocate memory
-            throw new std::runtime_error("Error while trying to open database, sqlite is null - " + std::to_string(openResult));
+            throw std::runtime_error("Error while trying to open database, sqlite is null - " + std::to_string(openResult));
         }
     }
     assert(sqlite != nullptr);
 
-    consoleLog("Opened database at " + resolvedPath);
+    registerArrayModule(sqlite);
+
+    consoleLog(std::string(readOnly ? "Opened read-only database connection at " : "Opened database at ") + resolvedPath);
 }
 
 void SqliteDb::destroy() {
@@ -1,14 +1,25 @@
 #pragma once
 
+#import <stdexcept>
 #import <string>
 #import <sqlite3.h>
 
 namespace watermelondb {
 
+// Error in a database operation. Unlike jsi::JSError, it's safe to create off the JS thread - it's
+// converted to a JS Error when it reaches JS
+class DatabaseError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Makes a DatabaseError with description of the last error on the passed connection
+DatabaseError sqliteError(sqlite3 *db, std::string description);
+
 // Lightweight wrapper for handling sqlite3 lifetime
 class SqliteDb {
 public:
-    SqliteDb(std::string path);
+    SqliteDb(std::string path, bool readOnly = false);
     ~SqliteDb();
     void destroy();
 
@@ -18,7 +29,7 @@ public:
     SqliteDb(const SqliteDb &) = delete;
 
 private:
-    bool isDestroyed_;
+    bool isDestroyed_ = false;
 };
 
 class SqliteStatement {
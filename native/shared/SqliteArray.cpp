@@ -0,0 +1,143 @@
+#include "SqliteArray.h"
+
+namespace watermelondb {
+
+static const char *arrayPointerType = "watermelondb-array";
+
+// NOTE: Columns of the virtual table: value, pointer (hidden - array passed as argument)
+static const int arrayColumnValue = 0;
+static const int arrayColumnPointer = 1;
+
+struct ArrayCursor {
+    sqlite3_vtab_cursor base; // NOTE: must be first
+    std::shared_ptr<SqliteValueArray> array;
+    size_t row = 0;
+};
+
+static int arrayConnect(sqlite3 *db, void *, int, const char *const *, sqlite3_vtab **vtab, char **) {
+    int result = sqlite3_declare_vtab(db, "create table x(value, pointer hidden)");
+    if (result != SQLITE_OK) {
+        return result;
+    }
+
+    *vtab = (sqlite3_vtab *) sqlite3_malloc(sizeof(sqlite3_vtab));
+    if (!*vtab) {
+        return SQLITE_NOMEM;
+    }
+    *(*vtab) = {};
+    return SQLITE_OK;
+}
+
+static int arrayDisconnect(sqlite3_vtab *vtab) {
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+static int arrayBestIndex(sqlite3_vtab *, sqlite3_index_info *info) {
+    for (int i = 0; i < info->nConstraint; i++) {
+        auto &constraint = info->aConstraint[i];
+        if (constraint.iColumn == arrayColumnPointer && constraint.op == SQLITE_INDEX_CONSTRAINT_EQ && constraint.usable) {
+            info->aConstraintUsage[i].argvIndex = 1;
+            info->aConstraintUsage[i].omit = 1;
+            info->idxNum = 1;
+            info->estimatedCost = 1;
+            info->estimatedRows = 100;
+            return SQLITE_OK;
+        }
+    }
+
+    // NOTE: Without an array passed, there are no rows - make sure query planner avoids this
+    info->idxNum = 0;
+    info->estimatedCost = 2147483647;
+    info->estimatedRows = 2147483647;
+    return SQLITE_OK;
+}
+
+static int arrayOpen(sqlite3_vtab *, sqlite3_vtab_cursor **cursor) {
+    *cursor = (sqlite3_vtab_cursor *) new ArrayCursor();
+    return SQLITE_OK;
+}
+
+static int arrayClose(sqlite3_vtab_cursor *cursor) {
+    delete (ArrayCursor *) cursor;
+    return SQLITE_OK;
+}
+
+static int arrayFilter(sqlite3_vtab_cursor *vtabCursor, int idxNum, const char *, int argc, sqlite3_value **argv) {
+    auto cursor = (ArrayCursor *) vtabCursor;
+    cursor->array = nullptr;
+    cursor->row = 0;
+
+    if (idxNum == 1 && argc == 1) {
+        auto array = (std::shared_ptr<SqliteValueArray> *) sqlite3_value_pointer(argv[0], arrayPointerType);
+        if (array) {
+            cursor->array = *array;
+        }
+    }
+    return SQLITE_OK;
+}
+
+static int arrayNext(sqlite3_vtab_cursor *cursor) {
+    ((ArrayCursor *) cursor)->row++;
+    return SQLITE_OK;
+}
+
+static int arrayEof(sqlite3_vtab_cursor *vtabCursor) {
+    auto cursor = (ArrayCursor *) vtabCursor;
+    return !cursor->array || cursor->row >= cursor->array->values.size();
+}
+
+static int arrayColumn(sqlite3_vtab_cursor *vtabCursor, sqlite3_context *context, int column) {
+    auto cursor = (ArrayCursor *) vtabCursor;
+    if (column != arrayColumnValue) {
+        sqlite3_result_null(context);
+        return SQLITE_OK;
+    }
+
+    auto &value = cursor->array->values[cursor->row];
+    if (auto text = std::get_if<std::string>(&value)) {
+        // NOTE: Array outlives the cursor's use of the value
+        sqlite3_result_text(context, text->c_str(), (int) text->length(), SQLITE_STATIC);
+    } else if (auto number = std::get_if<double>(&value)) {
+        sqlite3_result_double(context, *number);
+    } else if (auto integer = std::get_if<int64_t>(&value)) {
+        sqlite3_result_int64(context, *integer);
+    } else {
+        sqlite3_result_null(context);
+    }
+    return SQLITE_OK;
+}
+
+static int arrayRowid(sqlite3_vtab_cursor *cursor, sqlite_int64 *rowid) {
+    *rowid = (sqlite_int64) ((ArrayCursor *) cursor)->row;
+    return SQLITE_OK;
+}
+
+static sqlite3_module arrayModule = {
+    0, // iVersion
+    nullptr, // xCreate - eponymous-only virtual table
+    arrayConnect,
+    arrayBestIndex,
+    arrayDisconnect,
+    nullptr, // xDestroy
+    arrayOpen,
+    arrayClose,
+    arrayFilter,
+    arrayNext,
+    arrayEof,
+    arrayColumn,
+    arrayRowid,
+};
+
+void registerArrayModule(sqlite3 *db) {
+    sqlite3_create_module(db, "watermelon_array", &arrayModule, nullptr);
+}
+
+int bindArray(sqlite3_stmt *statement, int index, std::shared_ptr<SqliteValueArray> array) {
+    // NOTE: sqlite owns the pointer (and calls the destructor, even if binding fails) until it's rebound or cleared
+    return sqlite3_bind_pointer(statement, index, new std::shared_ptr<SqliteValueArray>(array), arrayPointerType, [](void *pointer) {
+        delete (std::shared_ptr<SqliteValueArray> *) pointer;
+    });
+}
+
+} // namespace watermelondb
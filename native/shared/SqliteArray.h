@@ -0,0 +1,29 @@
+#pragma once
+
+#import <memory>
+#import <string>
+#import <variant>
+#import <vector>
+#import <sqlite3.h>
+
+namespace watermelondb {
+
+struct SqliteValueArray;
+
+// Query argument or a column value, read from/to JS values so that it can be used off the JS thread
+using SqliteValue = std::variant<std::monostate, int64_t, double, std::string, std::shared_ptr<SqliteValueArray>>;
+
+// List of values bound as a single query argument, e.g. `where id in watermelon_array(?)`
+struct SqliteValueArray {
+    std::vector<SqliteValue> values; // NOTE: nested arrays are not supported
+};
+
+// Registers `watermelon_array` - a table-valued function (similar to sqlite's carray extension) that
+// returns values of an array bound with bindArray(). Must be called on every connection
+void registerArrayModule(sqlite3 *db);
+
+// Binds an array of values, so that a list of any length can be passed as a single argument, without
+// inlining it into SQL
+int bindArray(sqlite3_stmt *statement, int index, std::shared_ptr<SqliteValueArray> array);
+
+} // namespace watermelondb
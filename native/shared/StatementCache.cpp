@@ -0,0 +1,115 @@
+#include "StatementCache.h"
+#include "Sqlite.h"
+#include <cassert>
+
+namespace watermelondb {
+
+StatementCacheStats &StatementCacheStats::operator+=(const StatementCacheStats &other) {
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    liveStatements += other.liveStatements;
+    pinnedStatements += other.pinnedStatements;
+    memoryUsed += other.memoryUsed;
+    return *this;
+}
+
+StatementCache::StatementCache(size_t maxCount, size_t maxMemory) : maxCount_(maxCount), maxMemory_(maxMemory) {
+}
+
+StatementCache::~StatementCache() {
+    clear();
+}
+
+sqlite3_stmt *StatementCache::prepare(sqlite3 *db, const std::string &sql, bool pinned) {
+    auto found = entriesBySql_.find(sql);
+    if (found != entriesBySql_.end()) {
+        stats_.hits++;
+        auto entry = found->second;
+        if (pinned && !entry->isPinned) {
+            entry->isPinned = true;
+            unpinnedCount_--;
+            unpinnedMemoryUsed_ -= entry->memoryUsed;
+        }
+        entries_.splice(entries_.begin(), entries_, entry);
+
+        // in theory, this shouldn't be necessary, since statements ought to be reset *after* use, not before use
+        // but still this might prevent some crashes if this is not done right
+        // TODO: Remove this later - should not be necessary, and it wastes time
+        sqlite3_reset(entry->statement);
+        return entry->statement;
+    }
+
+    stats_.misses++;
+    sqlite3_stmt *statement = nullptr;
+    int resultPrepare = sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr);
+
+    if (resultPrepare != SQLITE_OK) {
+        sqlite3_finalize(statement);
+        throw sqliteError(db, "Failed to prepare query statement");
+    }
+    assert(statement != nullptr);
+
+    size_t memoryUsed = sql.size() + sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_MEMUSED, 0);
+    entries_.push_front(Entry { sql, statement, memoryUsed, pinned });
+    entriesBySql_[sql] = entries_.begin();
+    if (!pinned) {
+        unpinnedCount_++;
+        unpinnedMemoryUsed_ += memoryUsed;
+        evictIfNeeded(statement);
+    }
+
+    return statement;
+}
+
+void StatementCache::evictIfNeeded(sqlite3_stmt *justUsed) {
+    auto entry = entries_.end();
+    while ((unpinnedCount_ > maxCount_ || unpinnedMemoryUsed_ > maxMemory_) && entry != entries_.begin()) {
+        entry--;
+        if (entry->isPinned || entry->statement == justUsed || sqlite3_stmt_busy(entry->statement)) {
+            continue;
+        }
+
+        finalize(entry->statement);
+        unpinnedCount_--;
+        unpinnedMemoryUsed_ -= entry->memoryUsed;
+        stats_.evictions++;
+        entriesBySql_.erase(entry->sql);
+        entry = entries_.erase(entry);
+    }
+}
+
+void StatementCache::clear() {
+    for (auto const &entry : entries_) {
+        finalize(entry.statement);
+    }
+    entries_.clear();
+    entriesBySql_.clear();
+    unpinnedCount_ = 0;
+    unpinnedMemoryUsed_ = 0;
+}
+
+void StatementCache::setFinalizeListener(std::function<void(sqlite3_stmt *)> listener) {
+    finalizeListener_ = listener;
+}
+
+void StatementCache::finalize(sqlite3_stmt *statement) {
+    if (finalizeListener_) {
+        finalizeListener_(statement);
+    }
+    sqlite3_finalize(statement);
+}
+
+StatementCacheStats StatementCache::stats() {
+    StatementCacheStats stats = stats_;
+    stats.liveStatements = entries_.size();
+    for (auto const &entry : entries_) {
+        stats.memoryUsed += entry.memoryUsed;
+        if (entry.isPinned) {
+            stats.pinnedStatements++;
+        }
+    }
+    return stats;
+}
+
+} // namespace watermelondb
@@ -0,0 +1,66 @@
+#pragma once
+
+#import <functional>
+#import <list>
+#import <string>
+#import <unordered_map>
+#import <sqlite3.h>
+
+namespace watermelondb {
+
+struct StatementCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t liveStatements = 0;
+    size_t pinnedStatements = 0;
+    size_t memoryUsed = 0; // approximate, in bytes
+
+    StatementCacheStats &operator+=(const StatementCacheStats &other);
+};
+
+// Cache of prepared statements of a single connection.
+// Because most queries have their arguments inlined into SQL, most statements are only used once or a few times,
+// so the cache is bounded by statement count and memory used, and least recently used statements are finalized.
+// Pinned statements are never evicted, and do not count towards the limits - only pin a fixed set of statements
+// (e.g. transactions, or inserts/updates/deletes of records), never SQL made by the app
+class StatementCache {
+public:
+    StatementCache(size_t maxCount = 256, size_t maxMemory = 4 * 1024 * 1024);
+    ~StatementCache();
+
+    // Returns a cached statement, or prepares a new one on the passed connection and caches it.
+    // NOTE: Returned statement stays valid until the next call to prepare() - it's not evicted while busy,
+    // but statement can't be known to be in use before it's stepped
+    sqlite3_stmt *prepare(sqlite3 *db, const std::string &sql, bool pinned = false);
+    // Finalizes all statements
+    void clear();
+    StatementCacheStats stats();
+    // Called just before a statement is finalized (evicted or cleared), e.g. to drop data associated with it
+    void setFinalizeListener(std::function<void(sqlite3_stmt *)> listener);
+
+    StatementCache &operator=(const StatementCache &) = delete;
+    StatementCache(const StatementCache &) = delete;
+
+private:
+    struct Entry {
+        std::string sql;
+        sqlite3_stmt *statement;
+        size_t memoryUsed;
+        bool isPinned;
+    };
+
+    size_t maxCount_;
+    size_t maxMemory_;
+    std::list<Entry> entries_; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entriesBySql_;
+    size_t unpinnedCount_ = 0;
+    size_t unpinnedMemoryUsed_ = 0;
+    StatementCacheStats stats_;
+    std::function<void(sqlite3_stmt *)> finalizeListener_;
+
+    void evictIfNeeded(sqlite3_stmt *justUsed);
+    void finalize(sqlite3_stmt *statement);
+};
+
+} // namespace watermelondb
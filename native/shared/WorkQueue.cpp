@@ -0,0 +1,101 @@
+#include "WorkQueue.h"
+#include "DatabasePlatform.h"
+#include <pthread.h>
+#include <cassert>
+
+namespace watermelondb {
+
+using platform::consoleError;
+
+WorkQueue::WorkQueue(std::string name, size_t threadCount) : name_(name), threadCount_(threadCount) {
+    assert(threadCount > 0);
+}
+
+WorkQueue::~WorkQueue() {
+    destroy();
+}
+
+void WorkQueue::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (isDestroyed_) {
+            return;
+        }
+        isDestroyed_ = true;
+    }
+    // NOTE: Work that was already dispatched is finished before threads exit
+    workAvailable_.notify_all();
+    for (auto &thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+bool WorkQueue::dispatch(std::function<void(void)> work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (isDestroyed_) {
+            return false;
+        }
+        queue_.push_back(std::move(work));
+        if (threads_.size() < threadCount_ && threads_.size() < queue_.size() + runningCount_) {
+            threads_.emplace_back([this]() {
+                run();
+            });
+        }
+    }
+    workAvailable_.notify_one();
+    return true;
+}
+
+void WorkQueue::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() {
+        return queue_.empty() && runningCount_ == 0;
+    });
+}
+
+void WorkQueue::run() {
+    #ifdef __APPLE__
+    pthread_setname_np(name_.substr(0, 63).c_str());
+    #else
+    pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+    #endif
+
+    while (true) {
+        std::function<void(void)> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workAvailable_.wait(lock, [this]() {
+                return !queue_.empty() || isDestroyed_;
+            });
+            if (queue_.empty()) {
+                // destroyed and drained
+                return;
+            }
+            work = std::move(queue_.front());
+            queue_.pop_front();
+            runningCount_++;
+        }
+
+        try {
+            work();
+        } catch (const std::exception &ex) {
+            // NOTE: work is expected to handle its own errors - this is a last resort to keep the thread alive
+            consoleError("Uncaught exception in " + name_ + " - " + std::string(ex.what()));
+        }
+        work = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            runningCount_--;
+            if (queue_.empty() && runningCount_ == 0) {
+                idle_.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace watermelondb
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace watermelondb {
+
+// Executes blocks of work on background thread(s). Threads are only spawned once work is dispatched.
+// With one thread (default), work is executed serially in FIFO order
+class WorkQueue {
+public:
+    WorkQueue(std::string name, size_t threadCount = 1);
+    ~WorkQueue();
+    void destroy();
+
+    // Returns false (and drops the work) if the queue was already destroyed
+    bool dispatch(std::function<void(void)> work);
+    // Blocks until all work dispatched so far has been executed
+    void waitUntilIdle();
+
+    WorkQueue &operator=(const WorkQueue &) = delete;
+    WorkQueue(const WorkQueue &) = delete;
+
+private:
+    std::string name_;
+    size_t threadCount_;
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable idle_;
+    std::deque<std::function<void(void)>> queue_;
+    std::vector<std::thread> threads_;
+    size_t runningCount_ = 0;
+    bool isDestroyed_ = false;
+
+    void run();
+};
+
+} // namespace watermelondb
@@ -3,7 +3,7 @@
 
 import { invariant, deprecated, logger } from '../utils/common'
 import type Model from '../Model'
-import type Database from './index'
+import type Database, { BatchOptions } from './index'
 
 export interface ReaderInterface {
   callReader<T>(reader: () => Promise<T>): Promise<T>;
@@ -11,7 +11,9 @@ export interface ReaderInterface {
 
 export interface WriterInterface extends ReaderInterface {
   callWriter<T>(writer: () => Promise<T>): Promise<T>;
-  batch(...records: $ReadOnlyArray<Model | Model[] | null | void | false>): Promise<void>;
+  batch(
+    ...records: $ReadOnlyArray<Model | Model[] | BatchOptions | null | void | false>
+  ): Promise<void>;
 }
 
 class ReaderInterfaceImpl implements ReaderInterface {
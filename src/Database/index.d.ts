@@ -1,7 +1,7 @@
 import { type Observable, startWith, merge as merge$ } from '../utils/rx'
 import { Unsubscribe } from '../utils/subscriptions'
 
-import type { DatabaseAdapter } from '../adapters/type'
+import type { DatabaseAdapter, BatchDurability } from '../adapters/type'
 import DatabaseAdapterCompat from '../adapters/compat'
 import type Model from '../Model'
 import type Collection from '../Collection'
@@ -21,6 +21,10 @@ type DatabaseProps = $Exact<{
 
 export function setExperimentalAllowsFatalError()
 
+export type BatchOptions = $Exact<{
+  durability?: BatchDurability
+}>
+
 export default class Database {
   adapter: DatabaseAdapterCompat
 
@@ -44,7 +48,10 @@ export default class Database {
   // Executes multiple prepared operations
   // (made with `collection.prepareCreate` and `record.prepareUpdate`)
   // Note: falsy values (null, undefined, false) passed to batch are just ignored
-  batch(...records: $ReadOnlyArray<Model | Model[] | null | void | false>): Promise<void>
+  // Models (or an array of them) can be followed by options, e.g. `batch(records, { durability: 'normal' })`
+  batch(
+    ...records: $ReadOnlyArray<Model | Model[] | BatchOptions | null | void | false>
+  ): Promise<void>
 
   // Enqueues a Writer - a block of code that, when it's running, has a guarantee that no other Writer
   // is running at the same time.
@@ -5,7 +5,7 @@ import { type Unsubscribe } from '../utils/subscriptions'
 import { invariant, logger, deprecated } from '../utils/common'
 import { noop } from '../utils/fp'
 
-import type { DatabaseAdapter, BatchOperation } from '../adapters/type'
+import type { DatabaseAdapter, BatchOperation, BatchDurability } from '../adapters/type'
 import DatabaseAdapterCompat from '../adapters/compat'
 import type Model from '../Model'
 import type Collection, { CollectionChangeSet } from '../Collection'
@@ -15,6 +15,10 @@ import CollectionMap from './CollectionMap'
 import type LocalStorage from './LocalStorage'
 import WorkQueue, { type ReaderInterface, type WriterInterface } from './WorkQueue'
 
+export type BatchOptions = $Exact<{
+  durability?: BatchDurability,
+}>
+
 type DatabaseProps = $Exact<{
   adapter: DatabaseAdapter,
   modelClasses: Array<Class<Model>>,
@@ -76,16 +80,28 @@ export default class Database {
   // Executes multiple prepared operations
   // (made with `collection.prepareCreate` and `record.prepareUpdate`)
   // Note: falsy values (null, undefined, false) passed to batch are just ignored
-  async batch(...records: $ReadOnlyArray<Model | Model[] | null | void | false>): Promise<void> {
+  // Models (or an array of them) can be followed by options, e.g. `batch(records, { durability: 'normal' })`
+  // to make a batch of unimportant changes cheaper to commit (see BatchDurability)
+  async batch(
+    ...records: $ReadOnlyArray<Model | Model[] | BatchOptions | null | void | false>
+  ): Promise<void> {
     if (!Array.isArray(records[0])) {
+      const last = records[records.length - 1]
+      if (last && last.constructor === Object) {
+        // $FlowFixMe
+        return this.batch(records.slice(0, -1), last)
+      }
       // $FlowFixMe
       return this.batch(records)
     }
     invariant(
-      records.length === 1,
-      'batch should be called with a list of models or a single array',
+      records.length === 1 ||
+        (records.length === 2 && records[1] && records[1].constructor === Object),
+      'batch should be called with a list of models or a single array (optionally followed by options)',
     )
     const actualRecords = records[0]
+    // $FlowFixMe
+    const options: BatchOptions = records[1] || {}
 
     this._ensureInWriter(`Database.batch()`)
 
@@ -138,7 +154,11 @@ export default class Database {
       changeNotifications[table].push({ record, type: changeType })
     })
 
-    await this.adapter.batch(batchOperations)
+    if (options.durability) {
+      await this.adapter.batch(batchOperations, options.durability)
+    } else {
+      await this.adapter.batch(batchOperations)
+    }
 
     // NOTE: We must make two passes to ensure all changes to caches are applied before subscribers are called
     const affectedTables = Object.keys(changeNotifications)
@@ -267,6 +267,36 @@ describe('Database', () => {
       expect(adapterBatchSpy).toHaveBeenCalledTimes(1)
       expect(adapterBatchSpy).toHaveBeenLastCalledWith([['create', 'mock_tasks', model._raw]])
     })
+    it(`can batch with durability`, async () => {
+      const { database, tasks: tasksCollection } = mockDatabase()
+      const adapterBatchSpy = jest.spyOn(database.adapter, 'batch')
+
+      const model = tasksCollection.prepareCreate()
+      await database.write(() => database.batch([model], { durability: 'normal' }))
+
+      expect(adapterBatchSpy).toHaveBeenCalledTimes(1)
+      expect(adapterBatchSpy).toHaveBeenLastCalledWith(
+        [['create', 'mock_tasks', model._raw]],
+        'normal',
+      )
+    })
+    it(`can batch with durability with models passed as arguments`, async () => {
+      const { database, tasks: tasksCollection } = mockDatabase()
+      const adapterBatchSpy = jest.spyOn(database.adapter, 'batch')
+
+      const m1 = tasksCollection.prepareCreate()
+      const m2 = tasksCollection.prepareCreate()
+      await database.write(() => database.batch(m1, null, m2, { durability: 'normal' }))
+
+      expect(adapterBatchSpy).toHaveBeenCalledTimes(1)
+      expect(adapterBatchSpy).toHaveBeenLastCalledWith(
+        [
+          ['create', 'mock_tasks', m1._raw],
+          ['create', 'mock_tasks', m2._raw],
+        ],
+        'normal',
+      )
+    })
     it('throws error if attempting to batch records without a pending operation', async () => {
       const { database, tasks } = mockDatabase()
       const m1 = await database.write(() => tasks.create())
@@ -314,6 +344,10 @@ describe('Database', () => {
         database.batch([], null),
         'batch should be called with a list',
       )
+      await expectToRejectWithMessage(
+        database.batch([], []),
+        'batch should be called with a list',
+      )
     })
   })
 
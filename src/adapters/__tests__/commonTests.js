@@ -8,12 +8,14 @@ import expectToRejectWithMessage from '../../__tests__/utils/expectToRejectWithM
 import Model from '../../Model'
 import Query from '../../Query'
 import { sanitizedRaw } from '../../RawRecord'
+import { toPromise } from '../../utils/fp/Result'
 import * as Q from '../../QueryDescription'
 import { appSchema, tableSchema } from '../../Schema'
 import { schemaMigrations, createTable, addColumns } from '../../Schema/migrations'
 
 import { matchTests, naughtyMatchTests, joinTests } from '../../__tests__/databaseTests'
 import DatabaseAdapterCompat from '../compat'
+import applyIdsDiff from '../sqlite/applyIdsDiff'
 import {
   testSchema,
   taskQuery,
@@ -33,6 +35,15 @@ class BadModel extends Model {
   static table = 'nonexistent'
 }
 
+// Returns underlying SQLiteAdapter if it uses JSI (so that JSI-only methods can be tested), or null
+const jsiSqliteAdapter = (adapter, AdapterClass) =>
+  AdapterClass.name === 'SQLiteAdapter' && adapter.underlyingAdapter._dispatcherType === 'jsi'
+    ? adapter.underlyingAdapter
+    : null
+
+const callSqlite = (sqliteAdapter, methodName, ...args) =>
+  toPromise((callback) => sqliteAdapter[methodName](...args, callback))
+
 export default () => {
   const commonTests = []
   const it = (name, test) => commonTests.push([name, test])
@@ -520,6 +531,25 @@ export default () => {
 
     expect(await adapter.getDeletedRecords('tasks')).toEqual(['t4'])
   })
+  it('can create long runs of records in a batch', async (adapter) => {
+    // NOTE: 100 = 64 + 32 + 4 - runs of full, tail, and single-row inserts (where used)
+    const tasks = Array.from({ length: 100 }, (_, i) =>
+      mockTaskRaw({ id: `t${i}`, text1: `task ${i}`, order: i }),
+    )
+    await adapter.batch([
+      ...tasks.map((task) => ['create', 'tasks', task]),
+      ['create', 'projects', mockProjectRaw({ id: 'p1' })],
+      ['create', 'tasks', mockTaskRaw({ id: 't100' })],
+    ])
+
+    const created = await adapter.unsafeQueryRaw(taskQuery(Q.where('text1', Q.like('task %'))))
+    expectSortedEqual(
+      created.map(({ id, text1 }) => `${id}: ${text1}`),
+      tasks.map(({ id, text1 }) => `${id}: ${text1}`),
+    )
+    expect(await adapter.count(taskQuery())).toBe(101)
+    expect(await adapter.count(projectQuery())).toBe(1)
+  })
   it('batches are transactional', async (adapter, AdapterClass) => {
     // sanity check
     await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1' })]])
@@ -727,6 +757,770 @@ export default () => {
       'Sync json 2137 does not exist',
     )
   })
+  it(`reports records changed into and out of native matchers`, async (adapter, AdapterClass) => {
+    if (AdapterClass.name !== 'SQLiteAdapter') {
+      return
+    }
+    const sqliteAdapter = adapter.underlyingAdapter
+    const query = taskQuery(Q.where('bool1', true))
+    if (sqliteAdapter._dispatcherType !== 'jsi') {
+      await expectToRejectWithMessage(
+        toPromise((callback) => sqliteAdapter.registerMatcher(query, callback)),
+        'registerMatcher unavailable',
+      )
+      return
+    }
+
+    const handle = await toPromise((callback) => sqliteAdapter.registerMatcher(query, callback))
+    const matchChangedRows = () => toPromise((callback) => sqliteAdapter.matchChangedRows(callback))
+
+    await adapter.batch([
+      ['create', 'tasks', mockTaskRaw({ id: 't1', bool1: true })],
+      ['create', 'tasks', mockTaskRaw({ id: 't2', bool1: true })],
+      ['create', 'tasks', mockTaskRaw({ id: 't3', bool1: false })],
+    ])
+    expect(await matchChangedRows()).toEqual([
+      { handle, ids: ['t1', 't2'], unmatchedIds: ['t3'], hasUnknownDeletions: false },
+    ])
+    expect(await matchChangedRows()).toEqual([])
+
+    // update out of filter, and permanent deletion
+    await adapter.batch([
+      ['update', 'tasks', mockTaskRaw({ id: 't1', bool1: false })],
+      ['destroyPermanently', 'tasks', 't2'],
+    ])
+    expect(await matchChangedRows()).toEqual([
+      { handle, ids: [], unmatchedIds: ['t1', 't2'], hasUnknownDeletions: false },
+    ])
+
+    // ids of rows deleted by raw SQL are not known - neither are tables of `delete from` without `where`,
+    // which can be optimized into a truncate, unnoticed by sqlite hooks
+    await adapter.unsafeExecute({ sqls: [['delete from tasks where id = ?', ['t3']]] })
+    expect(await matchChangedRows()).toEqual([
+      { handle, ids: [], unmatchedIds: [], hasUnknownDeletions: true },
+    ])
+    await adapter.unsafeExecute({ sqls: [['delete from projects', []]] })
+    expect(await matchChangedRows()).toEqual([
+      { handle, ids: [], unmatchedIds: [], hasUnknownDeletions: true },
+    ])
+    expect(await matchChangedRows()).toEqual([])
+
+    await toPromise((callback) => sqliteAdapter.unregisterMatcher(handle, callback))
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't4', bool1: true })]])
+    expect(await matchChangedRows()).toEqual([])
+  })
+  it('can find many records at once', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const t1 = mockTaskRaw({ id: 't1', text1: 'foo', order: 1 })
+    const t2 = mockTaskRaw({ id: 't2', text1: 'bar', order: 2 })
+    const p1 = mockProjectRaw({ id: 'p1', text1: 'baz' })
+    await adapter.batch([
+      ['create', 'tasks', t1],
+      ['create', 'tasks', t2],
+      ['create', 'projects', p1],
+    ])
+
+    // returns cached IDs after create, null if not found, in order of passed ids
+    expect(await callSqlite(sqliteAdapter, 'findMany', 'tasks', ['t2', 'x', 't1'])).toEqual([
+      't2',
+      null,
+      't1',
+    ])
+
+    // returns raws if not cached (once, if an id is passed more than once), and caches them
+    const clone = await sqliteAdapter.testClone()
+    expect(await callSqlite(clone, 'findMany', 'tasks', ['t2', 't1', 't2'])).toEqual([t2, t1, 't2'])
+    expect(await callSqlite(clone, 'findMany', 'tasks', ['t1', 't2'])).toEqual(['t1', 't2'])
+
+    // finds records of many tables at once (ids are not global)
+    expect(
+      await callSqlite(clone, 'findManyTables', { tasks: ['t1', 'p1'], projects: ['p1', 't1'] }),
+    ).toEqual({ tasks: ['t1', null], projects: [p1, null] })
+    expect(await callSqlite(clone, 'findMany', 'projects', [])).toEqual([])
+  })
+  it('can execute many queries at once', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const t1 = mockTaskRaw({ id: 't1', bool1: true, order: 1 })
+    await adapter.batch([
+      ['create', 'tasks', t1],
+      ['create', 'tasks', mockTaskRaw({ id: 't2', bool1: false, order: 2 })],
+      ['create', 'projects', mockProjectRaw({ id: 'p1' })],
+    ])
+
+    const queries = [
+      { kind: 'query', query: taskQuery(Q.where('bool1', true)) },
+      { kind: 'ids', query: taskQuery(Q.sortBy('order', Q.desc)) },
+      { kind: 'count', query: projectQuery() },
+      {
+        kind: 'raw',
+        query: taskQuery(Q.unsafeSqlQuery('select id, "order" from tasks order by "order"')),
+      },
+    ]
+    const rawResult = [
+      { id: 't1', order: 1 },
+      { id: 't2', order: 2 },
+    ]
+
+    // results are the same as of individual queries, so records cached in JS are returned as ids...
+    expect(await callSqlite(sqliteAdapter, 'queryMany', queries)).toEqual([
+      ['t1'],
+      ['t2', 't1'],
+      1,
+      rawResult,
+    ])
+
+    // ...and other records are returned as raws, and cached
+    const clone = await sqliteAdapter.testClone()
+    expect(await callSqlite(clone, 'queryMany', queries)).toEqual([
+      [t1],
+      ['t2', 't1'],
+      1,
+      rawResult,
+    ])
+    expect(await callSqlite(clone, 'find', 'tasks', 't1')).toBe('t1')
+
+    expect(await callSqlite(clone, 'queryMany', [])).toEqual([])
+  })
+  it('marks live queries as dirty when their tables change', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const register = (query, kind) => callSqlite(sqliteAdapter, 'registerLiveQuery', query, kind)
+    const drainDirtyQueries = () => callSqlite(sqliteAdapter, 'drainDirtyQueries')
+    const tasksHandle = await register(taskQuery(Q.where('bool1', true)), 'ids')
+    const projectsHandle = await register(projectQuery(), 'count')
+    const joinHandle = await register(taskQuery(Q.on('projects', 'num1', 1)), 'ids')
+
+    // new queries are dirty
+    expect(await drainDirtyQueries()).toEqual([tasksHandle, projectsHandle, joinHandle])
+    expect(await drainDirtyQueries()).toEqual([])
+
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1' })]])
+    expect(await drainDirtyQueries()).toEqual([tasksHandle, joinHandle])
+    await adapter.batch([['create', 'projects', mockProjectRaw({ id: 'p1' })]])
+    expect(await drainDirtyQueries()).toEqual([projectsHandle, joinHandle])
+    await adapter.batch([['create', 'tag_assignments', mockTagAssignmentRaw({ id: 'ta1' })]])
+    expect(await drainDirtyQueries()).toEqual([])
+
+    // changes not made by batch are noticed too
+    await adapter.unsafeExecute({ sqls: [[`update tasks set text1 = 'a' where id = 't1'`, []]] })
+    expect(await drainDirtyQueries()).toEqual([tasksHandle, joinHandle])
+    await adapter.unsafeExecute({ sqls: [['delete from projects where id = ?', ['p1']]] })
+    expect(await drainDirtyQueries()).toEqual([projectsHandle, joinHandle])
+
+    // raw SQL can delete rows unnoticed by sqlite hooks (`delete from` without `where` can become a
+    // truncate), and its tables are not known, so all queries are dirty
+    await adapter.unsafeExecute({ sqls: [['delete from tag_assignments', []]] })
+    expect(await drainDirtyQueries()).toEqual([tasksHandle, projectsHandle, joinHandle])
+    await adapter.unsafeExecute({ sqlString: 'delete from tag_assignments;' })
+    expect(await drainDirtyQueries()).toEqual([tasksHandle, projectsHandle, joinHandle])
+
+    await callSqlite(sqliteAdapter, 'unregisterLiveQuery', tasksHandle)
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't2' })]])
+    expect(await drainDirtyQueries()).toEqual([joinHandle])
+  })
+  it('returns id diffs of refreshed live queries', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await adapter.batch([
+      ['create', 'tasks', mockTaskRaw({ id: 't1', bool1: true, order: 1 })],
+      ['create', 'tasks', mockTaskRaw({ id: 't2', bool1: true, order: 2 })],
+      ['create', 'tasks', mockTaskRaw({ id: 't3', bool1: false, order: 3 })],
+    ])
+
+    const query = taskQuery(Q.where('bool1', true), Q.sortBy('order', Q.asc))
+    const handle = await callSqlite(sqliteAdapter, 'registerLiveQuery', query, 'ids')
+    const countHandle = await callSqlite(sqliteAdapter, 'registerLiveQuery', taskQuery(), 'count')
+    const refreshDirtyQueries = () => callSqlite(sqliteAdapter, 'refreshDirtyQueries')
+
+    // first refresh returns all ids as inserted
+    expect(await refreshDirtyQueries()).toEqual([
+      {
+        handle,
+        diff: {
+          length: 2,
+          insertedIds: ['t1', 't2'],
+          insertedPositions: [0, 1],
+          removedPositions: [],
+          movedRanges: [],
+        },
+      },
+      { handle: countHandle, count: 3 },
+    ])
+    // clean queries are not re-executed
+    expect(await refreshDirtyQueries()).toEqual([])
+
+    let ids = ['t1', 't2']
+    const expectRefreshedIds = async (expectedIds, expectedCount) => {
+      const results = await refreshDirtyQueries()
+      const { diff } = results.find((result) => result.handle === handle)
+      ids = applyIdsDiff(ids, diff)
+      expect(ids).toEqual(expectedIds)
+      expect(ids).toEqual(await adapter.queryIds(query))
+      expect(results.find((result) => result.handle === countHandle).count).toBe(expectedCount)
+      return diff
+    }
+
+    // id inserted at the top doesn't move others
+    await adapter.batch([['update', 'tasks', mockTaskRaw({ id: 't3', bool1: true, order: 0 })]])
+    expect(await expectRefreshedIds(['t3', 't1', 't2'], 3)).toEqual({
+      length: 3,
+      insertedIds: ['t3'],
+      insertedPositions: [0],
+      removedPositions: [],
+      movedRanges: [],
+    })
+
+    // moves, removals and insertions at once
+    await adapter.batch([
+      ['update', 'tasks', mockTaskRaw({ id: 't3', bool1: true, order: 5 })],
+      ['destroyPermanently', 'tasks', 't1'],
+      ['create', 'tasks', mockTaskRaw({ id: 't4', bool1: true, order: 3 })],
+      ['create', 'tasks', mockTaskRaw({ id: 't5', bool1: false, order: 4 })],
+    ])
+    await expectRefreshedIds(['t2', 't4', 't3'], 4)
+
+    // rows deleted by raw SQL
+    await adapter.unsafeExecute({ sqls: [['delete from tasks', []]] })
+    await expectRefreshedIds([], 0)
+
+    await callSqlite(sqliteAdapter, 'unregisterLiveQuery', handle)
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't6', bool1: true })]])
+    expect(await refreshDirtyQueries()).toEqual([{ handle: countHandle, count: 1 }])
+  })
+  it('captures rows changed by committed transactions', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const drainChanges = () => callSqlite(sqliteAdapter, 'drainChanges')
+    const tableChanges = (changes) => ({
+      inserted: [],
+      updated: [],
+      deleted: [],
+      insertedRowids: [],
+      updatedRowids: [],
+      deletedRowids: [],
+      ...changes,
+    })
+
+    await callSqlite(sqliteAdapter, 'enableChangeCapture')
+    expect(await drainChanges()).toEqual([])
+
+    await adapter.batch([
+      ['create', 'tasks', mockTaskRaw({ id: 't1' })],
+      ['create', 'tasks', mockTaskRaw({ id: 't2' })],
+      ['create', 'projects', mockProjectRaw({ id: 'p1' })],
+    ])
+    await adapter.batch([
+      ['update', 'tasks', mockTaskRaw({ id: 't1', text1: 'foo' })],
+      ['create', 'tasks', mockTaskRaw({ id: 't3' })],
+      ['update', 'tasks', mockTaskRaw({ id: 't3', text1: 'bar' })],
+      ['destroyPermanently', 'tasks', 't2'],
+    ])
+    // changes not made by batch are captured too, but ids of deleted rows are not known
+    await adapter.unsafeExecute({
+      sqls: [
+        ['update tasks set text1 = ? where id = ?', ['baz', 't1']],
+        ['delete from tasks where id = ?', ['t3']],
+      ],
+    })
+    // not committed
+    await expectToRejectWithMessage(
+      adapter.batch([
+        ['create', 'tasks', mockTaskRaw({ id: 't4' })],
+        ['create', 'tasks', mockTaskRaw({ id: 't1' })],
+      ]),
+      /constraint/i,
+    )
+
+    expect(await drainChanges()).toEqual([
+      {
+        tasks: tableChanges({ inserted: ['t1', 't2'], insertedRowids: [1, 2] }),
+        projects: tableChanges({ inserted: ['p1'], insertedRowids: [1] }),
+      },
+      {
+        tasks: tableChanges({
+          inserted: ['t3'],
+          updated: ['t1'],
+          deleted: ['t2'],
+          insertedRowids: [3],
+          updatedRowids: [1],
+          deletedRowids: [2],
+        }),
+      },
+      {
+        tasks: tableChanges({ updated: ['t1'], updatedRowids: [1], deletedRowids: [3] }),
+      },
+    ])
+    expect(await drainChanges()).toEqual([])
+  })
+  it('finds records using native row cache', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const t1 = mockTaskRaw({ id: 't1', text1: 'foo', order: 1 })
+    const t2 = mockTaskRaw({ id: 't2', text1: 'bar', order: 2 })
+    await adapter.batch([
+      ['create', 'tasks', t1],
+      ['create', 'tasks', t2],
+    ])
+    await callSqlite(sqliteAdapter, 'configureRowCache', 100, 1024 * 1024)
+
+    // NOTE: Records released by JS are sent in full, so they're read from the row cache (if cached)
+    const findReleased = async (id) => {
+      await callSqlite(sqliteAdapter, 'evictCachedRecords', 'tasks', [id])
+      return adapter.find('tasks', id)
+    }
+    expect(await findReleased('t1')).toEqual(t1)
+    expect(await findReleased('t1')).toEqual(t1)
+    expect(await callSqlite(sqliteAdapter, 'getRowCacheStats')).toMatchObject({
+      hits: 1,
+      misses: 1,
+      rows: 1,
+    })
+
+    // rows are invalidated when changed by batch...
+    const t1Updated = mockTaskRaw({ id: 't1', text1: 'updated', order: 1 })
+    await adapter.batch([['update', 'tasks', t1Updated]])
+    expect(await findReleased('t1')).toEqual(t1Updated)
+
+    // ...or raw SQL
+    await adapter.unsafeExecute({ sqls: [[`update tasks set text1 = 'raw' where id = 't1'`, []]] })
+    expect(await findReleased('t1')).toEqual({ ...t1Updated, text1: 'raw' })
+
+    // rows deleted by `delete from` without `where` may not be noticed by sqlite hooks
+    expect(await findReleased('t2')).toEqual(t2)
+    await adapter.unsafeExecute({ sqls: [['delete from tasks', []]] })
+    expect(await findReleased('t1')).toBe(null)
+    expect(await findReleased('t2')).toBe(null)
+    expect(await callSqlite(sqliteAdapter, 'getRowCacheStats')).toMatchObject({
+      hits: 1,
+      misses: 6,
+      invalidations: 4,
+      rows: 0,
+    })
+
+    // disabled
+    await adapter.batch([['create', 'tasks', t1]])
+    await callSqlite(sqliteAdapter, 'configureRowCache', 0, 0)
+    expect(await findReleased('t1')).toEqual(t1)
+    expect(await callSqlite(sqliteAdapter, 'getRowCacheStats')).toMatchObject({
+      misses: 6,
+      rows: 0,
+    })
+  })
+  it('caches query results natively until their tables change', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await adapter.batch([
+      ['create', 'tasks', mockTaskRaw({ id: 't1', bool1: true })],
+      ['create', 'tasks', mockTaskRaw({ id: 't2', bool1: false })],
+    ])
+    await callSqlite(sqliteAdapter, 'configureQueryCache', 1024 * 1024)
+
+    const query = taskQuery(Q.where('bool1', true))
+    const expectResults = async (count, ids) => {
+      expect(await adapter.count(taskQuery())).toBe(count)
+      expect(await adapter.queryIds(query)).toEqual(ids)
+    }
+    const getQueryCacheStats = () => callSqlite(sqliteAdapter, 'getQueryCacheStats')
+
+    await expectResults(2, ['t1'])
+    await expectResults(2, ['t1'])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 2, misses: 2, entries: 2 })
+
+    // changes of other tables don't invalidate results
+    await adapter.batch([['create', 'projects', mockProjectRaw({ id: 'p1' })]])
+    await expectResults(2, ['t1'])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 4, misses: 2 })
+
+    // results are invalidated by batch...
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't3', bool1: true })]])
+    await expectResults(3, ['t1', 't3'])
+
+    // ...or raw SQL
+    await adapter.unsafeExecute({ sqls: [[`update tasks set bool1 = 0 where id = 't1'`, []]] })
+    await expectResults(3, ['t3'])
+    await adapter.unsafeExecute({ sqlString: `insert into tasks (id, bool1) values ('t4', 1);` })
+    await expectResults(4, ['t3', 't4'])
+
+    // including `delete from` without `where`, which may not be noticed by sqlite hooks
+    await adapter.unsafeExecute({ sqls: [['delete from tasks', []]] })
+    await expectResults(0, [])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 4, misses: 10, entries: 2 })
+  })
+  it('coalesces async batches, and rolls back failed ones alone', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    // NOTE: Without async JSI (on Android), batches are executed one by one, with the same results
+    const asyncAdapter = await sqliteAdapter.testClone({ experimentalUsesAsyncJSI: true })
+    const asyncCompat = new DatabaseAdapterCompat(asyncAdapter)
+    await asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't1', text1: 'foo' })]])
+    await callSqlite(asyncAdapter, 'configureWriteCoalescing', 50)
+    await callSqlite(asyncAdapter, 'enableChangeCapture')
+
+    const isRejected = (promise) => promise.then(() => false, () => true)
+    // NOTE: Batches made at once are coalesced into one transaction, each in its own savepoint
+    expect(
+      await Promise.all([
+        isRejected(asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't2' })]])),
+        isRejected(asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't3' })]])),
+        isRejected(
+          asyncCompat.batch([
+            ['create', 'tasks', mockTaskRaw({ id: 't4' })],
+            ['update', 'tasks', mockTaskRaw({ id: 't1', text1: 'bar' })],
+            ['create', 'tasks', mockTaskRaw({ id: 't2' })],
+          ]),
+        ),
+      ]),
+    ).toEqual([false, false, true])
+
+    // failed batch is rolled back to its savepoint, without affecting others...
+    expectSortedEqual(await adapter.queryIds(taskQuery()), ['t1', 't2', 't3'])
+    expect((await adapter.unsafeQueryRaw(taskQuery(Q.where('id', 't1'))))[0].text1).toBe('foo')
+
+    // ...and its changes are not captured
+    const changes = await callSqlite(asyncAdapter, 'drainChanges')
+    const changesOf = (key) => [].concat(...changes.map((changeSet) => changeSet.tasks[key]))
+    expectSortedEqual(changesOf('inserted'), ['t2', 't3'])
+    expect(changesOf('insertedRowids')).toHaveLength(2)
+    expect(changesOf('updated')).toEqual([])
+
+    // coalescing can be disabled
+    await callSqlite(asyncAdapter, 'configureWriteCoalescing', 0)
+    await Promise.all([
+      asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't5' })]]),
+      asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't6' })]]),
+    ])
+    expect(await adapter.count(taskQuery())).toBe(5)
+  })
+  it('commits batches with any durability', async (adapter, AdapterClass) => {
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1' })]], 'full')
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't2' })]], 'normal')
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't3' })]], 'deferred')
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't4' })]])
+    expectSortedEqual(await adapter.queryIds(taskQuery()), ['t1', 't2', 't3', 't4'])
+
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await expectToRejectWithMessage(
+      adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't5' })]], 'bad'),
+      'Invalid batch durability',
+    )
+    // coalesced batches are committed together, as durably as the most durable of them
+    const asyncAdapter = await sqliteAdapter.testClone({ experimentalUsesAsyncJSI: true })
+    const asyncCompat = new DatabaseAdapterCompat(asyncAdapter)
+    await callSqlite(asyncAdapter, 'configureWriteCoalescing', 50)
+    await Promise.all([
+      asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't6' })]], 'deferred'),
+      asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't7' })]], 'full'),
+      asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't8' })]]),
+    ])
+    await asyncCompat.batch([['create', 'tasks', mockTaskRaw({ id: 't9' })]], 'deferred')
+    expect(await asyncCompat.count(taskQuery())).toBe(8)
+    expect(await adapter.count(taskQuery())).toBe(8)
+  })
+  it('reuses prepared queries, and releases least recently used', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const tasks = Array.from({ length: 70 }, (_, i) => mockTaskRaw({ id: `t${i}`, order: i }))
+    await adapter.batch(tasks.map((task) => ['create', 'tasks', task]))
+    const ids = tasks.map((task) => task.id)
+
+    // NOTE: Values are passed as arguments, so queries differing only by values are prepared once
+    const { _preparedQueries: preparedQueries } = sqliteAdapter._dispatcher
+    const queryFirst = (count) => adapter.queryIds(taskQuery(Q.sortBy('order'), Q.take(count)))
+    expect(await queryFirst(1)).toEqual(['t0'])
+    const preparedCount = preparedQueries.size
+    expect(await adapter.queryIds(taskQuery(Q.where('order', 1)))).toEqual(['t1'])
+    expect(await adapter.queryIds(taskQuery(Q.where('order', 2)))).toEqual(['t2'])
+    expect(preparedQueries.size).toBe(preparedCount + 1)
+
+    for (let count = 1; count <= 70; count++) {
+      expect(await queryFirst(count)).toEqual(ids.slice(0, count))
+    }
+    expect(preparedQueries.size).toBe(64)
+
+    // released queries are prepared again
+    expect(await queryFirst(1)).toEqual(['t0'])
+    expect(await adapter.queryIds(taskQuery(Q.where('order', 3)))).toEqual(['t3'])
+    expect(await adapter.count(taskQuery(Q.where('order', Q.gte(60))))).toBe(10)
+    expect(preparedQueries.size).toBe(64)
+  })
+  it('caches native statements, and evicts least recently used', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1', order: 1 })]])
+    const rawQuery = (sql) => adapter.unsafeQueryRaw(taskQuery(Q.unsafeSqlQuery(sql)))
+    const getStats = () => callSqlite(sqliteAdapter, 'getStatementCacheStats')
+
+    const statsBefore = await getStats()
+    expect(await rawQuery('select id, "order" from tasks')).toEqual([{ id: 't1', order: 1 }])
+    expect(await rawQuery('select id, "order" from tasks')).toEqual([{ id: 't1', order: 1 }])
+    const stats = await getStats()
+    expect(stats.hits).toBe(statsBefore.hits + 1)
+    expect(stats.misses).toBe(statsBefore.misses + 1)
+
+    // NOTE: Raw SQL is not pinned, so only 256 most recently used statements are kept
+    for (let i = 0; i < 300; i++) {
+      expect(await rawQuery(`select ${i} as n, id from tasks`)).toEqual([{ n: i, id: 't1' }])
+    }
+    const statsAfter = await getStats()
+    expect(statsAfter.misses).toBe(stats.misses + 300)
+    expect(statsAfter.evictions).toBeGreaterThanOrEqual(stats.evictions + 300 - 256)
+    expect(statsAfter.liveStatements - statsAfter.pinnedStatements).toBeLessThanOrEqual(256)
+
+    // evicted statements are prepared again
+    expect(await rawQuery('select 0 as n, id from tasks')).toEqual([{ n: 0, id: 't1' }])
+    expect(await rawQuery('select 299 as n, id from tasks')).toEqual([{ n: 299, id: 't1' }])
+    const statsFinal = await getStats()
+    expect(statsFinal.misses).toBe(statsAfter.misses + 1)
+    expect(statsFinal.hits).toBe(statsAfter.hits + 1)
+  })
+  it('can query results in columnar format', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const tasks = [
+      { id: 't1', text1: 'a', float1: 1.5, num1: 1, bool1: true, order: 1 },
+      { id: 't2', text1: 'a', float1: -2, num1: 0, order: 2 },
+      { id: 't3', text1: 'b', float1: 0, num1: 3, bool1: true, order: 3 },
+    ]
+    await adapter.batch(tasks.map((task) => ['create', 'tasks', mockTaskRaw(task)]))
+
+    // decodes rows as documented in ColumnarQueryResult
+    const decodeColumnar = ({ rowCount, columns, strings }) =>
+      Array.from({ length: rowCount }, (_, i) => {
+        const row = {}
+        columns.forEach((column) => {
+          if (column.nulls && column.nulls[i >> 3] & (1 << (i & 7))) {
+            row[column.name] = null
+          } else if (column.strings && column.strings[i] !== -1) {
+            row[column.name] = strings[column.strings[i]]
+          } else {
+            row[column.name] = column.numbers[i]
+          }
+        })
+        return row
+      })
+    const queryColumnar = (query) => callSqlite(sqliteAdapter, 'unsafeQueryColumnar', query)
+
+    const query = taskQuery(
+      Q.unsafeSqlQuery(
+        'select id, text1, float1, nullif(num1, 0) as num1, ' +
+          'case when bool1 then text1 else float1 end as mixed from tasks order by "order"',
+      ),
+    )
+    const result = await queryColumnar(query)
+    expect(result.rowCount).toBe(3)
+    expect(result.columns.map((column) => column.name)).toEqual([
+      'id',
+      'text1',
+      'float1',
+      'num1',
+      'mixed',
+    ])
+    expect(result.strings).toEqual(['t1', 'a', 't2', 't3', 'b'])
+    const [id, text1, float1, num1, mixed] = result.columns
+    expect(Array.from(id.strings)).toEqual([0, 2, 3])
+    expect(id.numbers).toBe(null)
+    expect(id.nulls).toBe(null)
+    expect(Array.from(float1.numbers)).toEqual([1.5, -2, 0])
+    expect(float1.strings).toBe(null)
+    expect(Array.from(text1.strings)).toEqual([1, 1, 4])
+    expect(Array.from(num1.nulls)).toEqual([0b010])
+    expect(Array.from(mixed.strings)).toEqual([1, -1, 4])
+
+    const rows = [
+      { id: 't1', text1: 'a', float1: 1.5, num1: 1, mixed: 'a' },
+      { id: 't2', text1: 'a', float1: -2, num1: null, mixed: -2 },
+      { id: 't3', text1: 'b', float1: 0, num1: 3, mixed: 'b' },
+    ]
+    expect(decodeColumnar(result)).toEqual(rows)
+    expect(await adapter.unsafeQueryRaw(query)).toEqual(rows)
+
+    // empty results
+    const emptyResult = await queryColumnar(
+      taskQuery(Q.unsafeSqlQuery('select id, float1 from tasks where id = ?', ['none'])),
+    )
+    expect(emptyResult).toEqual({
+      rowCount: 0,
+      columns: [
+        { name: 'id', numbers: null, strings: null, nulls: null },
+        { name: 'float1', numbers: null, strings: null, nulls: null },
+      ],
+      strings: [],
+    })
+
+    // results are not stale after raw SQL changes
+    await adapter.unsafeExecute({ sqls: [['delete from tasks where id = ?', ['t2']]] })
+    expect(decodeColumnar(await queryColumnar(query))).toEqual([rows[0], rows[2]])
+  })
+  it('can query lazy raw records', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const tasks = [
+      mockTaskRaw({ id: 't1', text1: 'a', float1: 1.5, bool1: true, order: 1 }),
+      mockTaskRaw({ id: 't2', text1: 'b', float1: -2, order: 2 }),
+    ]
+    await adapter.batch(tasks.map((task) => ['create', 'tasks', task]))
+    const queryLazy = (query) => callSqlite(sqliteAdapter, 'unsafeQueryRawLazy', query)
+
+    const query = taskQuery(Q.sortBy('order'))
+    const rows = await queryLazy(query)
+    const raws = await adapter.unsafeQueryRaw(query)
+    expect(rows.length).toBe(2)
+    expect(rows.map((row) => row.toRaw())).toEqual(raws)
+    expect(Object.keys(rows[0]).sort()).toEqual(Object.keys(raws[0]).sort())
+    expect(rows[0].id).toBe('t1')
+    expect(rows[0].text1).toBe('a')
+    expect(rows[0].bool1).toBe(1)
+    expect(rows[1].float1).toBe(-2)
+    expect(rows[1].bool1).toBe(0)
+    expect(rows[1].not_a_column).toBe(undefined)
+
+    const nullsQuery = taskQuery(
+      Q.unsafeSqlQuery('select id, nullif(text1, ?) as text1 from tasks order by "order"', ['a']),
+    )
+    const nullRows = await queryLazy(nullsQuery)
+    expect(nullRows.map((row) => row.toRaw())).toEqual([
+      { id: 't1', text1: null },
+      { id: 't2', text1: 'b' },
+    ])
+    expect(nullRows[0].text1).toBe(null)
+
+    // rows are snapshots, not affected by later changes, but new queries are not stale
+    await adapter.unsafeExecute({
+      sqls: [
+        ['update tasks set text1 = ? where id = ?', ['c', 't1']],
+        ['delete from tasks where id = ?', ['t2']],
+      ],
+    })
+    expect(rows[0].text1).toBe('a')
+    expect(rows[1].toRaw()).toEqual(raws[1])
+    const rowsAfter = await queryLazy(query)
+    expect(rowsAfter.map((row) => row.toRaw())).toEqual(await adapter.unsafeQueryRaw(query))
+    expect(rowsAfter.length).toBe(1)
+    expect(rowsAfter[0].text1).toBe('c')
+  })
+  it('can query results in JSON format', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    const t1 = mockTaskRaw({ id: 't1', text1: '"quoted"\n\\ zażółć 🍉', float1: 1.5, order: 1 })
+    const t2 = mockTaskRaw({ id: 't2', text1: '', bool1: true, order: 2 })
+    const t3 = mockTaskRaw({ id: 't3', order: 3 })
+    await adapter.batch([t1, t2, t3].map((task) => ['create', 'tasks', task]))
+
+    // NOTE: Records created by this adapter are cached, so a new one is needed to get their raws
+    const jsonSqlite = await sqliteAdapter.testClone({ experimentalQueryResultFormat: 'json' })
+    const jsonAdapter = new DatabaseAdapterCompat(jsonSqlite)
+    await callSqlite(jsonSqlite, 'configureQueryCache', 1024 * 1024)
+    const getQueryCacheStats = () => callSqlite(jsonSqlite, 'getQueryCacheStats')
+
+    const query = taskQuery(Q.sortBy('order'))
+    expect(await jsonAdapter.query(query)).toEqual([t1, t2, t3])
+    expect(await jsonAdapter.query(query)).toEqual(['t1', 't2', 't3'])
+    expect(await jsonAdapter.query(taskQuery(Q.where('bool1', true)))).toEqual(['t2'])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 1, misses: 2, entries: 2 })
+
+    // results are not stale after raw SQL changes
+    await jsonAdapter.unsafeExecute({ sqls: [['delete from tasks where id = ?', ['t2']]] })
+    expect(await jsonAdapter.query(query)).toEqual(['t1', 't3'])
+    await jsonAdapter.unsafeExecute({ sqls: [['delete from tasks', []]] })
+    expect(await jsonAdapter.query(query)).toEqual([])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 1, misses: 4 })
+  })
+  it('returns current column names after raw SQL renames them', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1', text1: 'foo', order: 1 })]])
+    const query = taskQuery(Q.unsafeSqlQuery('select * from tasks'))
+    expect((await adapter.unsafeQueryRaw(query))[0].text1).toBe('foo')
+
+    // NOTE: Statement is re-prepared by sqlite with as many columns as before, but renamed
+    await adapter.unsafeExecute({ sqls: [['alter table tasks rename column text1 to text9', []]] })
+    const [raw] = await adapter.unsafeQueryRaw(query)
+    expect(raw.text9).toBe('foo')
+    expect(raw.text1).toBe(undefined)
+
+    await adapter.unsafeExecute({ sqls: [['alter table tasks rename column text9 to text1', []]] })
+    expect((await adapter.unsafeQueryRaw(query))[0].text1).toBe('foo')
+  })
+  it('invalidates cached results of views when tables change', async (adapter, AdapterClass) => {
+    const sqliteAdapter = jsiSqliteAdapter(adapter, AdapterClass)
+    if (!sqliteAdapter) {
+      return
+    }
+
+    await callSqlite(sqliteAdapter, 'configureQueryCache', 1024 * 1024)
+    const getQueryCacheStats = () => callSqlite(sqliteAdapter, 'getQueryCacheStats')
+    await adapter.batch([
+      ['create', 'tasks', mockTaskRaw({ id: 't1', bool1: true })],
+      ['create', 'projects', mockProjectRaw({ id: 'p1' })],
+    ])
+    await adapter.unsafeExecute({
+      sqlString: 'create view view_ids as select id from tasks where bool1 = 1 order by id;',
+    })
+    const query = taskQuery(Q.unsafeSqlQuery('select * from view_ids'))
+    expect(await adapter.queryIds(query)).toEqual(['t1'])
+    expect(await adapter.queryIds(query)).toEqual(['t1'])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 1, misses: 1 })
+
+    await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't2', bool1: true })]])
+    expect(await adapter.queryIds(query)).toEqual(['t1', 't2'])
+
+    // NOTE: Tables read by the same SQL change if the schema does
+    await adapter.unsafeExecute({
+      sqlString: 'drop view view_ids; create view view_ids as select id from projects order by id;',
+    })
+    expect(await adapter.queryIds(query)).toEqual(['p1'])
+    await adapter.batch([['create', 'projects', mockProjectRaw({ id: 'p2' })]])
+    expect(await adapter.queryIds(query)).toEqual(['p1', 'p2'])
+    expect(await getQueryCacheStats()).toMatchObject({ hits: 1, misses: 4 })
+  })
   it('can unsafely reset database', async (adapter) => {
     await adapter.batch([['create', 'tasks', mockTaskRaw({ id: 't1', text1: 'bar', order: 1 })]])
     await adapter.unsafeResetDatabase()
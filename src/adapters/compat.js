@@ -11,6 +11,7 @@ import type {
   CachedFindResult,
   CachedQueryResult,
   BatchOperation,
+  BatchDurability,
   UnsafeExecuteOperations,
 } from './type'
 
@@ -53,8 +54,8 @@ export default class DatabaseAdapterCompat {
     return toPromise((callback) => this.underlyingAdapter.count(query, callback))
   }
 
-  batch(operations: BatchOperation[]): Promise<void> {
-    return toPromise((callback) => this.underlyingAdapter.batch(operations, callback))
+  batch(operations: BatchOperation[], durability?: BatchDurability): Promise<void> {
+    return toPromise((callback) => this.underlyingAdapter.batch(operations, callback, durability))
   }
 
   getDeletedRecords(tableName: TableName<any>): Promise<RecordId[]> {
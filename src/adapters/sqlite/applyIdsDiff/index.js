@@ -0,0 +1,46 @@
+// @flow
+
+import type { RecordId } from '../../../Model'
+import type { IdsDiff } from '../type'
+
+// Applies difference of live query ids (returned by SQLiteAdapter.refreshDirtyQueries) to the previous ids
+export default function applyIdsDiff(previousIds: RecordId[], diff: IdsDiff): RecordId[] {
+  const { length, insertedIds, insertedPositions, removedPositions, movedRanges } = diff
+  const ids: RecordId[] = new Array(length)
+  const isFilled: boolean[] = new Array(length).fill(false)
+  const isTaken: boolean[] = new Array(previousIds.length).fill(false)
+
+  for (let i = 0, len = insertedIds.length; i < len; i++) {
+    ids[insertedPositions[i]] = insertedIds[i]
+    isFilled[insertedPositions[i]] = true
+  }
+
+  for (let i = 0, len = removedPositions.length; i < len; i++) {
+    isTaken[removedPositions[i]] = true
+  }
+
+  for (let i = 0, len = movedRanges.length; i < len; i += 3) {
+    const from = movedRanges[i]
+    const to = movedRanges[i + 1]
+    const count = movedRanges[i + 2]
+    for (let j = 0; j < count; j++) {
+      ids[to + j] = previousIds[from + j]
+      isFilled[to + j] = true
+      isTaken[from + j] = true
+    }
+  }
+
+  // Remaining ids keep their order
+  let position = 0
+  for (let i = 0, len = previousIds.length; i < len; i++) {
+    if (!isTaken[i]) {
+      while (isFilled[position]) {
+        position += 1
+      }
+      ids[position] = previousIds[i]
+      position += 1
+    }
+  }
+
+  return ids
+}
@@ -0,0 +1,49 @@
+import applyIdsDiff from './index'
+
+const diff = (length, inserted, removedPositions = [], movedRanges = []) => ({
+  length,
+  insertedIds: inserted.map(([id]) => id),
+  insertedPositions: inserted.map(([, position]) => position),
+  removedPositions,
+  movedRanges,
+})
+
+describe('applyIdsDiff', () => {
+  it('applies initial diff', () => {
+    expect(applyIdsDiff([], diff(0, []))).toEqual([])
+    expect(
+      applyIdsDiff(
+        [],
+        diff(3, [
+          ['a', 0],
+          ['b', 1],
+          ['c', 2],
+        ]),
+      ),
+    ).toEqual(['a', 'b', 'c'])
+  })
+  it('applies empty diff', () => {
+    expect(applyIdsDiff(['a', 'b'], diff(2, []))).toEqual(['a', 'b'])
+  })
+  it('applies inserts and removals', () => {
+    expect(applyIdsDiff(['a', 'b', 'c'], diff(4, [['x', 0]]))).toEqual(['x', 'a', 'b', 'c'])
+    expect(applyIdsDiff(['a', 'b', 'c'], diff(2, [], [1]))).toEqual(['a', 'c'])
+    expect(applyIdsDiff(['a', 'b', 'c'], diff(3, [['x', 2]], [0]))).toEqual(['b', 'c', 'x'])
+  })
+  it('applies moves', () => {
+    // a b c d -> c d a b
+    expect(applyIdsDiff(['a', 'b', 'c', 'd'], diff(4, [], [], [0, 2, 2]))).toEqual([
+      'c',
+      'd',
+      'a',
+      'b',
+    ])
+    // a b c d -> b a x d (c removed)
+    expect(applyIdsDiff(['a', 'b', 'c', 'd'], diff(4, [['x', 2]], [2], [0, 1, 1]))).toEqual([
+      'b',
+      'a',
+      'x',
+      'd',
+    ])
+  })
+})
@@ -60,6 +60,9 @@ type GroupedBatchOperation =
   | ['markAsDeleted', TableName<any>, RecordId[]]
   | ['destroyPermanently', TableName<any>, RecordId[]]
 
+// For large batches, it's profitable to delete all indices and then recreate them
+export const RECREATE_INDICES_BATCH_SIZE = 1000
+
 const REMOVE_FROM_CACHE = -1
 const IGNORE_CACHE = 0
 const ADD_TO_CACHE = 1
@@ -146,8 +149,7 @@ export default function encodeBatch(
     }
   })
 
-  // For large batches, it's profitable to delete all indices and then recreate them
-  if (operations.length >= 1000) {
+  if (operations.length >= RECREATE_INDICES_BATCH_SIZE) {
     return withRecreatedIndices(nativeOperations, schema)
   }
   return nativeOperations
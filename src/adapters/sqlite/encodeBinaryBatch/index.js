@@ -0,0 +1,174 @@
+// @flow
+/* eslint-disable no-bitwise */
+
+import type { NativeBridgeBatchOperation, SQLiteArg } from '../type'
+
+// Encodes batch operations into a binary format read natively in place (see native/shared/BinaryBatch.h),
+// which is cheaper to produce and consume than JSON. Table names and SQL are deduplicated
+export const FORMAT_VERSION = 1
+const NO_STRING = 0xffffffff
+
+const NULL_TAG = 0
+const FALSE_TAG = 1
+const TRUE_TAG = 2
+const NUMBER_TAG = 3
+const STRING_TAG = 4
+
+// NOTE: TextEncoder is not available on all supported JS engines, so UTF-8 is encoded manually.
+// Unpaired surrogates are encoded as U+FFFD, like TextEncoder does
+export function utf8Length(string: string): number {
+  const { length } = string
+  let byteLength = length
+  for (let i = 0; i < length; i++) {
+    const code = string.charCodeAt(i)
+    if (code >= 0x80) {
+      if (code < 0x800) {
+        byteLength += 1
+      } else if (
+        code >= 0xd800 &&
+        code <= 0xdbff &&
+        i + 1 < length &&
+        (string.charCodeAt(i + 1) & 0xfc00) === 0xdc00
+      ) {
+        byteLength += 2 // 4 bytes for 2 UTF-16 code units
+        i++
+      } else {
+        byteLength += 2
+      }
+    }
+  }
+  return byteLength
+}
+
+function writeUtf8(bytes: Uint8Array, offset: number, string: string): number {
+  const { length } = string
+  let position = offset
+  for (let i = 0; i < length; i++) {
+    let code = string.charCodeAt(i)
+    if (code < 0x80) {
+      bytes[position++] = code
+    } else if (code < 0x800) {
+      bytes[position++] = 0xc0 | (code >> 6)
+      bytes[position++] = 0x80 | (code & 0x3f)
+    } else {
+      if (code >= 0xd800 && code <= 0xdfff) {
+        const next = i + 1 < length ? string.charCodeAt(i + 1) : 0
+        if (code <= 0xdbff && (next & 0xfc00) === 0xdc00) {
+          code = 0x10000 + ((code - 0xd800) << 10) + (next - 0xdc00)
+          i++
+        } else {
+          code = 0xfffd
+        }
+      }
+      if (code >= 0x10000) {
+        bytes[position++] = 0xf0 | (code >> 18)
+        bytes[position++] = 0x80 | ((code >> 12) & 0x3f)
+      } else {
+        bytes[position++] = 0xe0 | (code >> 12)
+      }
+      bytes[position++] = 0x80 | ((code >> 6) & 0x3f)
+      bytes[position++] = 0x80 | (code & 0x3f)
+    }
+  }
+  return position
+}
+
+// NOTE: Like with JSON.stringify, undefined and non-finite numbers are encoded as null
+function argByteLength(arg: SQLiteArg): number {
+  if (typeof arg === 'string') {
+    return 5 + utf8Length(arg)
+  } else if (typeof arg === 'number') {
+    return Number.isFinite(arg) ? 9 : 1
+  } else if (arg === null || arg === undefined || typeof arg === 'boolean') {
+    return 1
+  }
+  throw new Error(
+    'Invalid argument type for query - only strings, numbers, booleans and null are allowed',
+  )
+}
+
+export default function encodeBinaryBatch(operations: NativeBridgeBatchOperation[]): ArrayBuffer {
+  const strings: string[] = []
+  const stringIndexes: Map<string, number> = new Map()
+  const intern = (string: string): number => {
+    let index = stringIndexes.get(string)
+    if (index === undefined) {
+      index = strings.length
+      strings.push(string)
+      stringIndexes.set(string, index)
+    }
+    return index
+  }
+
+  // Pass 1: intern strings, compute size
+  let size = 1 + 4 + 4
+  const operationStrings = operations.map(([cacheBehavior, table, sql, argsBatches]) => {
+    size += 1 + 4 + 4 + 4
+    for (let i = 0; i < argsBatches.length; i++) {
+      const args = argsBatches[i]
+      size += 4
+      for (let j = 0; j < args.length; j++) {
+        size += argByteLength(args[j])
+      }
+    }
+    return [cacheBehavior !== 0 && table ? intern(table) : NO_STRING, intern(sql)]
+  })
+  const stringByteLengths = strings.map(utf8Length)
+  stringByteLengths.forEach((byteLength) => {
+    size += 4 + byteLength
+  })
+
+  // Pass 2: write
+  const buffer = new ArrayBuffer(size)
+  const view = new DataView(buffer)
+  const bytes = new Uint8Array(buffer)
+  let offset = 0
+  const writeU32 = (value: number): void => {
+    view.setUint32(offset, value, true)
+    offset += 4
+  }
+  const writeString = (string: string, byteLength: number): void => {
+    writeU32(byteLength)
+    offset = writeUtf8(bytes, offset, string)
+  }
+
+  view.setUint8(offset, FORMAT_VERSION)
+  offset += 1
+  writeU32(strings.length)
+  strings.forEach((string, i) => writeString(string, stringByteLengths[i]))
+  writeU32(operations.length)
+  operations.forEach(([cacheBehavior, , , argsBatches], operationIndex) => {
+    const [tableIndex, sqlIndex] = operationStrings[operationIndex]
+    view.setInt8(offset, cacheBehavior)
+    offset += 1
+    writeU32(tableIndex)
+    writeU32(sqlIndex)
+    writeU32(argsBatches.length)
+    for (let i = 0; i < argsBatches.length; i++) {
+      const args = argsBatches[i]
+      writeU32(args.length)
+      for (let j = 0; j < args.length; j++) {
+        const arg = args[j]
+        if (typeof arg === 'string') {
+          bytes[offset++] = STRING_TAG
+          // NOTE: Byte length is only known after writing, so it's filled in afterwards
+          const lengthOffset = offset
+          offset = writeUtf8(bytes, offset + 4, arg)
+          view.setUint32(lengthOffset, offset - lengthOffset - 4, true)
+        } else if (typeof arg === 'number' && Number.isFinite(arg)) {
+          bytes[offset++] = NUMBER_TAG
+          view.setFloat64(offset, arg, true)
+          offset += 8
+        } else if (arg === true) {
+          bytes[offset++] = TRUE_TAG
+        } else if (arg === false) {
+          bytes[offset++] = FALSE_TAG
+        } else {
+          bytes[offset++] = NULL_TAG
+        }
+      }
+    }
+  })
+
+  return buffer
+}
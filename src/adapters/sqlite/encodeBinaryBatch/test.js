@@ -0,0 +1,98 @@
+import encodeBinaryBatch, { FORMAT_VERSION, utf8Length } from './index'
+
+// Reference decoder of the format (see native/shared/BinaryBatch.h)
+function decodeBinaryBatch(buffer) {
+  const view = new DataView(buffer)
+  const decoder = new TextDecoder()
+  let offset = 0
+  const u8 = () => view.getUint8(offset++)
+  const u32 = () => {
+    const value = view.getUint32(offset, true)
+    offset += 4
+    return value
+  }
+  const string = () => {
+    const length = u32()
+    offset += length
+    return decoder.decode(new Uint8Array(buffer, offset - length, length))
+  }
+
+  expect(u8()).toBe(FORMAT_VERSION)
+  const strings = Array.from({ length: u32() }, string)
+  const operations = Array.from({ length: u32() }, () => {
+    const cacheBehavior = view.getInt8(offset++)
+    const tableIndex = u32()
+    const sql = strings[u32()]
+    const argsBatches = Array.from({ length: u32() }, () =>
+      Array.from({ length: u32() }, () => {
+        const tag = u8()
+        if (tag === 3) {
+          const value = view.getFloat64(offset, true)
+          offset += 8
+          return value
+        } else if (tag === 4) {
+          return string()
+        }
+        return [null, false, true][tag]
+      }),
+    )
+    return [cacheBehavior, tableIndex === 0xffffffff ? null : strings[tableIndex], sql, argsBatches]
+  })
+  expect(offset).toBe(buffer.byteLength)
+  return { strings, operations }
+}
+
+describe('utf8Length', () => {
+  it(`counts UTF-8 bytes`, () => {
+    const strings = ['', 'abc', 'zażółć', '日本語', '🍉x', 'a\ud800b', '\udc00', '\ud83c']
+    strings.forEach((string) => {
+      expect(utf8Length(string)).toBe(new TextEncoder().encode(string).length)
+    })
+  })
+})
+
+describe('encodeBinaryBatch', () => {
+  it(`encodes empty batch`, () => {
+    expect(decodeBinaryBatch(encodeBinaryBatch([]))).toEqual({ strings: [], operations: [] })
+  })
+  it(`encodes batch operations`, () => {
+    const operations = [
+      [1, 'tasks', 'insert into tasks', [['t1', 'zażółć 🍉', 1.5, true, null]]],
+      [0, null, 'update tasks', [['t1', false, -10], ['t2', '', 0]]],
+      [-1, 'tasks', 'delete from tasks', [['t1'], ['t2']]],
+      [0, null, 'update tasks', []],
+      [1, 'comments', 'insert into comments', [[]]],
+    ]
+    const { strings, operations: decoded } = decodeBinaryBatch(encodeBinaryBatch(operations))
+    expect(decoded).toEqual(operations)
+    expect(strings).toEqual([
+      'tasks',
+      'insert into tasks',
+      'update tasks',
+      'delete from tasks',
+      'comments',
+      'insert into comments',
+    ])
+  })
+  it(`ignores table of operations that don't affect cache`, () => {
+    const { strings, operations } = decodeBinaryBatch(
+      encodeBinaryBatch([[0, 'tasks', 'delete from tasks', [[]]]]),
+    )
+    expect(strings).toEqual(['delete from tasks'])
+    expect(operations[0][1]).toBe(null)
+  })
+  it(`encodes undefined and non-finite numbers as null, like JSON`, () => {
+    const { operations } = decodeBinaryBatch(
+      encodeBinaryBatch([[0, null, 'update', [[undefined, NaN, Infinity, 0]]]]),
+    )
+    expect(operations[0][3]).toEqual([[null, null, null, 0]])
+  })
+  it(`encodes strings like TextEncoder`, () => {
+    const string = 'a\ud800b\udc00🍉'
+    const { operations } = decodeBinaryBatch(encodeBinaryBatch([[0, null, 'q', [[string]]]]))
+    expect(operations[0][3][0][0]).toBe(new TextDecoder().decode(new TextEncoder().encode(string)))
+  })
+  it(`throws on invalid arguments`, () => {
+    expect(() => encodeBinaryBatch([[0, null, 'q', [[{}]]]])).toThrow(/Invalid argument type/)
+  })
+})
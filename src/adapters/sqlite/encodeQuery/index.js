@@ -15,26 +15,57 @@ import type {
 import * as Q from '../../../QueryDescription'
 import { type TableName, type ColumnName } from '../../../Schema'
 
-import encodeValue from '../encodeValue'
+import encodeValue, { encodeArg } from '../encodeValue'
 import type { SQL, SQLiteArg } from '../index'
 
+// How values compared against are encoded:
+// - inline: inlined into SQL (useful for debugging, but every query becomes a different statement)
+// - placeholders: passed as arguments. Q.oneOf/Q.notIn lists are still inlined, because one placeholder per
+//   value can easily exceed SQLite's limit on the number of variables
+// - arrays: passed as arguments, and Q.oneOf/Q.notIn lists are bound natively as a single array argument
+//   (JSI only)
+export type EncodeQueryMode = 'inline' | 'placeholders' | 'arrays'
+
+type Encoder = $Exact<{ mode: EncodeQueryMode, args: SQLiteArg[] }>
+
 function mapJoin<T>(array: T[], mapper: (T) => string, joiner: string): string {
   // NOTE: DO NOT try to optimize this by concatenating strings together. In non-JIT JSC,
   // concatenating strings is extremely slow (5000ms vs 120ms on 65K sample)
   return array.map(mapper).join(joiner)
 }
 
-const encodeValues: (NonNullValues) => string = (values) =>
-  `(${mapJoin((values: any[]), encodeValue, ', ')})`
+const encodeValueOrArg = (encoder: Encoder, value: any): string => {
+  if (encoder.mode === 'inline') {
+    return encodeValue(value)
+  }
+  encoder.args.push(encodeArg(value))
+  return '?'
+}
 
-const getComparisonRight = (table: TableName<any>, comparisonRight: ComparisonRight): string => {
+const encodeValues = (encoder: Encoder, values: NonNullValues): string => {
+  if (encoder.mode === 'arrays') {
+    // NOTE: watermelon_array is a table-valued function registered natively (see SqliteArray.cpp)
+    encoder.args.push((values: any))
+    return 'watermelon_array(?)'
+  }
+  return `(${mapJoin((values: any[]), encodeValue, ', ')})`
+}
+
+const getComparisonRight = (
+  encoder: Encoder,
+  table: TableName<any>,
+  comparisonRight: ComparisonRight,
+): string => {
   if (comparisonRight.values) {
-    return encodeValues(comparisonRight.values)
+    return encodeValues(encoder, comparisonRight.values)
   } else if (comparisonRight.column) {
     return `"${table}"."${comparisonRight.column}"`
   }
 
-  return typeof comparisonRight.value !== 'undefined' ? encodeValue(comparisonRight.value) : 'null'
+  return encodeValueOrArg(
+    encoder,
+    typeof comparisonRight.value !== 'undefined' ? comparisonRight.value : null,
+  )
 }
 
 // Note: it's necessary to use `is` / `is not` for NULL comparisons to work correctly
@@ -54,28 +85,31 @@ const operators: { [Operator]: string } = {
   notLike: 'not like',
 }
 
-const encodeComparison = (table: TableName<any>, comparison: Comparison) => {
+const encodeComparison = (encoder: Encoder, table: TableName<any>, comparison: Comparison) => {
   const { operator } = comparison
   if (operator === 'between') {
     const { right } = comparison
     return right.values
-      ? `between ${encodeValue(right.values[0])} and ${encodeValue(right.values[1])}`
+      ? `between ${encodeValueOrArg(encoder, right.values[0])} and ${encodeValueOrArg(
+          encoder,
+          right.values[1],
+        )}`
       : ''
   }
 
-  return `${operators[operator]} ${getComparisonRight(table, comparison.right)}`
+  return `${operators[operator]} ${getComparisonRight(encoder, table, comparison.right)}`
 }
 
 const encodeWhere =
-  (table: TableName<any>, associations: QueryAssociation[]) =>
+  (encoder: Encoder, table: TableName<any>, associations: QueryAssociation[]) =>
   (where: Where): string => {
     switch (where.type) {
       case 'and':
-        return `(${encodeAndOr(associations, 'and', table, where.conditions)})`
+        return `(${encodeAndOr(encoder, associations, 'and', table, where.conditions)})`
       case 'or':
-        return `(${encodeAndOr(associations, 'or', table, where.conditions)})`
+        return `(${encodeAndOr(encoder, associations, 'or', table, where.conditions)})`
       case 'where':
-        return encodeWhereCondition(associations, table, where.left, where.comparison)
+        return encodeWhereCondition(encoder, associations, table, where.left, where.comparison)
       case 'on':
         if (process.env.NODE_ENV !== 'production') {
           invariant(
@@ -83,7 +117,7 @@ const encodeWhere =
             'To nest Q.on inside Q.and/Q.or you must explicitly declare Q.experimentalJoinTables at the beginning of the query',
           )
         }
-        return `(${encodeAndOr(associations, 'and', where.table, where.conditions)})`
+        return `(${encodeAndOr(encoder, associations, 'and', where.table, where.conditions)})`
       case 'sql':
         return where.expr
       default:
@@ -92,6 +126,7 @@ const encodeWhere =
   }
 
 const encodeWhereCondition = (
+  encoder: Encoder,
   associations: QueryAssociation[],
   table: TableName<any>,
   left: ColumnName,
@@ -102,6 +137,7 @@ const encodeWhereCondition = (
   // if a column, we must check for `not null > null`
   if (operator === 'weakGt' && comparison.right.column) {
     return encodeWhere(
+      encoder,
       table,
       associations,
     )(
@@ -112,20 +148,21 @@ const encodeWhereCondition = (
       ),
     )
   } else if (operator === 'includes') {
-    return `instr("${table}"."${left}", ${getComparisonRight(table, comparison.right)})`
+    return `instr("${table}"."${left}", ${getComparisonRight(encoder, table, comparison.right)})`
   }
 
-  return `"${table}"."${left}" ${encodeComparison(table, comparison)}`
+  return `"${table}"."${left}" ${encodeComparison(encoder, table, comparison)}`
 }
 
 const encodeAndOr = (
+  encoder: Encoder,
   associations: QueryAssociation[],
   op: string,
   table: TableName<any>,
   conditions: Where[],
 ) => {
   if (conditions.length) {
-    return mapJoin(conditions, encodeWhere(table, associations), ` ${op} `)
+    return mapJoin(conditions, encodeWhere(encoder, table, associations), ` ${op} `)
   }
   return ''
 }
@@ -133,11 +170,12 @@ const encodeAndOr = (
 const andJoiner = ' and '
 
 const encodeConditions = (
+  encoder: Encoder,
   table: TableName<any>,
   description: QueryDescription,
   associations: QueryAssociation[],
 ): string => {
-  const clauses = mapJoin(description.where, encodeWhere(table, associations), andJoiner)
+  const clauses = mapJoin(description.where, encodeWhere(encoder, table, associations), andJoiner)
 
   return clauses.length ? ` where ${clauses}` : ''
 }
@@ -209,7 +247,11 @@ const encodeLimitOffset = (limit: ?number, offset: ?number) => {
   return ` limit ${limit}${optionalOffsetStmt}`
 }
 
-const encodeQuery = (query: SerializedQuery, countMode: boolean = false): [SQL, SQLiteArg[]] => {
+const encodeQuery = (
+  query: SerializedQuery,
+  countMode: boolean = false,
+  mode: EncodeQueryMode = 'inline',
+): [SQL, SQLiteArg[]] => {
   const { table, description, associations } = query
 
   // TODO: Test if encoding a `select x.id from x` query speeds up queryIds() calls
@@ -229,14 +271,15 @@ const encodeQuery = (query: SerializedQuery, countMode: boolean = false): [SQL,
     invariant(!description.lokiTransform, 'unsafeLokiTransform not supported with SQLite')
   }
 
+  const encoder: Encoder = { mode, args: [] }
   const sql =
     encodeMethod(table, countMode, hasToManyJoins) +
     encodeJoin(description, associations) +
-    encodeConditions(table, description, associations) +
+    encodeConditions(encoder, table, description, associations) +
     encodeOrderBy(table, description.sortBy) +
     encodeLimitOffset(description.take, description.skip)
 
-  return [sql, []]
+  return [sql, encoder.args]
 }
 
 export default encodeQuery
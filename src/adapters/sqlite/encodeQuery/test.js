@@ -28,8 +28,8 @@ const mockCollection = Object.freeze({
   db: { get: (table) => (table === 'projects' ? { modelClass: MockProject } : {}) },
 })
 
-const encodedWithArgs = (clauses, countMode) =>
-  encodeQuery(new Query(mockCollection, clauses), countMode)
+const encodedWithArgs = (clauses, countMode, mode) =>
+  encodeQuery(new Query(mockCollection, clauses), countMode, mode)
 
 const encoded = (clauses, countMode) => {
   const [sql] = encodedWithArgs(clauses, countMode)
@@ -292,6 +292,60 @@ describe('SQLite encodeQuery', () => {
       ['foo', 10, true],
     ])
   })
+  it('encodes values as arguments', () => {
+    expect(
+      encodedWithArgs(
+        [
+          Q.where('col1', `value "'with'" quotes`),
+          Q.where('col2', Q.gt(2)),
+          Q.where('col3', true),
+          Q.where('col4', null),
+          Q.where('col5', Q.oneOf([1, 2, 3])),
+          Q.where('col6', Q.notIn(['a', 'b'])),
+          Q.where('col7', Q.between(10, 11)),
+          Q.or(Q.where('col8', Q.like('%abc')), Q.where('col9', Q.includes('foo'))),
+          Q.where('col10', Q.gt(Q.column('col11'))),
+        ],
+        false,
+        'placeholders',
+      ),
+    ).toEqual([
+      `select "tasks".* from "tasks" where "tasks"."col1" is ?` +
+        ` and "tasks"."col2" > ?` +
+        ` and "tasks"."col3" is ?` +
+        ` and "tasks"."col4" is ?` +
+        ` and "tasks"."col5" in (1, 2, 3)` +
+        ` and "tasks"."col6" not in ('a', 'b')` +
+        ` and "tasks"."col7" between ? and ?` +
+        ` and ("tasks"."col8" like ? or instr("tasks"."col9", ?))` +
+        ` and "tasks"."col10" > "tasks"."col11"` +
+        ` and "tasks"."_status" is not ?`,
+      [`value "'with'" quotes`, 2, 1, null, 10, 11, '%abc', 'foo', 'deleted'],
+    ])
+  })
+  it('encodes oneOf/notIn lists as array arguments', () => {
+    const ids = ['a', 'b', 'c']
+    expect(
+      encodedWithArgs(
+        [
+          Q.where('col1', 'foo'),
+          Q.where('col2', Q.oneOf(ids)),
+          Q.on('projects', 'team_id', Q.notIn([1, 2])),
+        ],
+        true,
+        'arrays',
+      ),
+    ).toEqual([
+      `select count(*) as "count" from "tasks"` +
+        ` join "projects" on "projects"."id" = "tasks"."project_id"` +
+        ` where "tasks"."col1" is ?` +
+        ` and "tasks"."col2" in watermelon_array(?)` +
+        ` and ("projects"."team_id" not in watermelon_array(?)` +
+        ` and "projects"."_status" is not ?)` +
+        ` and "tasks"."_status" is not ?`,
+      ['foo', ids, [1, 2], 'deleted', 'deleted'],
+    ])
+  })
   it(`does not encode loki-specific syntax`, () => {
     expect(() => encoded([Q.unsafeLokiExpr({ hi: true })])).toThrow('Unknown clause')
     expect(() => encoded([Q.unsafeLokiTransform(() => {})])).toThrow('not supported')
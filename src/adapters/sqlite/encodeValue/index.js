@@ -4,6 +4,7 @@ import escapeString from 'sql-escape-string'
 import { logError } from '../../../utils/common'
 
 import type { Value } from '../../../QueryDescription'
+import type { SQLiteArg } from '../type'
 
 // Note: SQLite doesn't support literal TRUE and FALSE; expects 1 or 0 instead
 // It also doesn't encode strings the same way
@@ -30,3 +31,22 @@ export default function encodeValue(value: Value): string {
   }
   throw new Error('Invalid value to encode into query')
 }
+
+// Same as encodeValue, but for values passed as arguments to a query (bound to `?` placeholders)
+// instead of being inlined into SQL
+export function encodeArg(value: Value): SQLiteArg {
+  if (value === true) {
+    return 1
+  } else if (value === false) {
+    return 0
+  } else if (Number.isNaN(value)) {
+    logError('Passed NaN to query')
+    return null
+  } else if (value === undefined) {
+    logError('Passed undefined to query')
+    return null
+  } else if (value === null || typeof value === 'number' || typeof value === 'string') {
+    return value
+  }
+  throw new Error('Invalid value to encode into query')
+}
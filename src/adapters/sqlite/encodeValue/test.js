@@ -1,5 +1,5 @@
 import { logger } from '../../../utils/common'
-import encodeValue from './index'
+import encodeValue, { encodeArg } from './index'
 
 describe('SQLite encodeValue', () => {
   it('encodes SQLite values', () => {
@@ -20,4 +20,22 @@ describe('SQLite encodeValue', () => {
     expect(() => encodeValue([])).toThrow()
     expect(() => encodeValue({})).toThrow()
   })
+  it('encodes SQLite query arguments', () => {
+    expect(encodeArg(true)).toBe(1)
+    expect(encodeArg(false)).toBe(0)
+    expect(encodeArg(null)).toBe(null)
+    expect(encodeArg(10)).toBe(10)
+    expect(encodeArg(3.14)).toBe(3.14)
+    expect(encodeArg(`foo 'bar' hah`)).toBe(`foo 'bar' hah`)
+  })
+  it('catches invalid query arguments', () => {
+    const spy = jest.spyOn(logger, 'error').mockImplementation(() => {})
+    expect(encodeArg(undefined)).toBe(null)
+    expect(encodeArg(NaN)).toBe(null)
+    expect(spy).toHaveBeenCalledTimes(2)
+    spy.mockRestore()
+
+    expect(() => encodeArg([])).toThrow()
+    expect(() => encodeArg({})).toThrow()
+  })
 })
@@ -10,6 +10,7 @@ import type {
   CachedQueryResult,
   CachedFindResult,
   BatchOperation,
+  BatchDurability,
   UnsafeExecuteOperations,
 } from '../type'
 import type {
@@ -20,11 +21,37 @@ import type {
   SQLiteQuery,
   SqliteDispatcher,
   MigrationEvents,
+  StatementCacheStats,
+  RecordCacheStats,
+  RowCacheStats,
+  QueryCacheStats,
+  ColumnarQueryResult,
+  LazyRawRecord,
+  NativeChangeSet,
+  LiveQueryKind,
+  LiveQueryResult,
+  IdsDiff,
+  MatcherMatch,
+  ReadQueryKind,
+  ReadQuery,
 } from './type'
 
 import { $Shape } from '../../types'
 
-export type { SQL, SQLiteArg, SQLiteQuery }
+export type {
+  SQL,
+  SQLiteArg,
+  SQLiteQuery,
+  ColumnarQueryResult,
+  LazyRawRecord,
+  NativeChangeSet,
+  LiveQueryKind,
+  LiveQueryResult,
+  IdsDiff,
+  MatcherMatch,
+  ReadQueryKind,
+  ReadQuery,
+}
 
 export default class SQLiteAdapter implements DatabaseAdapter {
   static adapterType: string
@@ -61,15 +88,32 @@ export default class SQLiteAdapter implements DatabaseAdapter {
 
   find(table: TableName<any>, id: RecordId, callback: ResultCallback<CachedFindResult>): void
 
+  findMany(table: TableName<any>, ids: RecordId[], callback: ResultCallback<CachedFindResult[]>): void
+
+  findManyTables(
+    idsByTable: { [table: TableName<any>]: RecordId[] },
+    callback: ResultCallback<{ [table: TableName<any>]: CachedFindResult[] }>,
+  ): void
+
   query(query: SerializedQuery, callback: ResultCallback<CachedQueryResult>): void
 
+  queryMany(queries: ReadQuery[], callback: ResultCallback<any[]>): void
+
   queryIds(query: SerializedQuery, callback: ResultCallback<RecordId[]>): void
 
   unsafeQueryRaw(query: SerializedQuery, callback: ResultCallback<any[]>): void
 
+  unsafeQueryRawLazy(query: SerializedQuery, callback: ResultCallback<LazyRawRecord[]>): void
+
+  unsafeQueryColumnar(query: SerializedQuery, callback: ResultCallback<ColumnarQueryResult>): void
+
   count(query: SerializedQuery, callback: ResultCallback<number>): void
 
-  batch(operations: BatchOperation[], callback: ResultCallback<void>): void
+  batch(
+    operations: BatchOperation[],
+    callback: ResultCallback<void>,
+    durability?: BatchDurability,
+  ): void
 
   getDeletedRecords(table: TableName<any>, callback: ResultCallback<RecordId[]>): void
 
@@ -83,16 +127,54 @@ export default class SQLiteAdapter implements DatabaseAdapter {
 
   provideSyncJson(id: number, syncPullResultJson: string, callback: ResultCallback<void>): void
 
+  getStatementCacheStats(callback: ResultCallback<StatementCacheStats>): void
+
+  evictCachedRecords(table: TableName<any>, ids: RecordId[], callback: ResultCallback<number>): void
+
+  getRecordCacheStats(callback: ResultCallback<RecordCacheStats>): void
+
+  configureRowCache(maxCount: number, maxMemory: number, callback: ResultCallback<void>): void
+
+  getRowCacheStats(callback: ResultCallback<RowCacheStats>): void
+
+  configureQueryCache(maxMemory: number, callback: ResultCallback<void>): void
+
+  getQueryCacheStats(callback: ResultCallback<QueryCacheStats>): void
+
+  configureWriteCoalescing(windowMs: number, callback: ResultCallback<void>): void
+
+  enableChangeCapture(callback: ResultCallback<void>): void
+
+  drainChanges(callback: ResultCallback<NativeChangeSet[]>): void
+
+  registerLiveQuery(query: SerializedQuery, kind: LiveQueryKind, callback: ResultCallback<number>): void
+
+  unregisterLiveQuery(handle: number, callback: ResultCallback<void>): void
+
+  drainDirtyQueries(callback: ResultCallback<number[]>): void
+
+  refreshDirtyQueries(callback: ResultCallback<LiveQueryResult[]>): void
+
+  registerMatcher(query: SerializedQuery, callback: ResultCallback<number>): void
+
+  unregisterMatcher(handle: number, callback: ResultCallback<void>): void
+
+  matchChangedRows(callback: ResultCallback<MatcherMatch[]>): void
+
   unsafeResetDatabase(callback: ResultCallback<void>): void
 
   unsafeExecute(operations: UnsafeExecuteOperations, callback: ResultCallback<void>): void
 
   getLocal(key: string, callback: ResultCallback<string | undefined>): void
 
+  getLocalMany(keys: string[], callback: ResultCallback<(string | null)[]>): void
+
   setLocal(key: string, value: string, callback: ResultCallback<void>): void
 
   removeLocal(key: string, callback: ResultCallback<void>): void
 
+  _encodeQuery(query: SerializedQuery, countMode?: boolean): SQLiteQuery
+
   _encodedSchema(): SQL
 
   _migrationSteps(fromVersion: SchemaVersion): MigrationStep[] | undefined
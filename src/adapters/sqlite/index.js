@@ -14,6 +14,7 @@ import type {
   CachedQueryResult,
   CachedFindResult,
   BatchOperation,
+  BatchDurability,
   UnsafeExecuteOperations,
 } from '../type'
 import {
@@ -31,13 +32,40 @@ import type {
   SQLiteQuery,
   SqliteDispatcher,
   MigrationEvents,
+  StatementCacheStats,
+  RecordCacheStats,
+  RowCacheStats,
+  QueryCacheStats,
+  ColumnarQueryResult,
+  LazyRawRecord,
+  NativeChangeSet,
+  LiveQueryKind,
+  LiveQueryResult,
+  IdsDiff,
+  MatcherMatch,
+  ReadQueryKind,
+  ReadQuery,
 } from './type'
 
 import encodeQuery from './encodeQuery'
+import canEncodeMatcher, { forbiddenError } from '../../observation/encodeMatcher/canEncode'
 
 import { makeDispatcher, getDispatcherType } from './makeDispatcher'
 
-export type { SQL, SQLiteArg, SQLiteQuery }
+export type {
+  SQL,
+  SQLiteArg,
+  SQLiteQuery,
+  ColumnarQueryResult,
+  LazyRawRecord,
+  NativeChangeSet,
+  LiveQueryKind,
+  LiveQueryResult,
+  IdsDiff,
+  MatcherMatch,
+  ReadQueryKind,
+  ReadQuery,
+}
 
 if (process.env.NODE_ENV !== 'production') {
   require('./devtools')
@@ -66,7 +94,15 @@ export default class SQLiteAdapter implements DatabaseAdapter {
 
   constructor(options: SQLiteAdapterOptions): void {
     // console.log(`---> Initializing new adapter (${this._tag})`)
-    const { dbName, schema, migrations, migrationEvents, usesExclusiveLocking = false } = options
+    const {
+      dbName,
+      schema,
+      migrations,
+      migrationEvents,
+      usesExclusiveLocking = false,
+      experimentalUsesAsyncJSI = false,
+      experimentalQueryResultFormat,
+    } = options
     this.schema = schema
     this.migrations = migrations
     this._migrationEvents = migrationEvents
@@ -79,6 +115,8 @@ export default class SQLiteAdapter implements DatabaseAdapter {
       this._tag,
       this.dbName,
       usesExclusiveLocking,
+      experimentalUsesAsyncJSI,
+      experimentalQueryResultFormat,
     )
 
     if (process.env.NODE_ENV !== 'production') {
@@ -135,6 +173,14 @@ export default class SQLiteAdapter implements DatabaseAdapter {
     // we're good. If not, we try again, this time sending the compiled schema or a migration set
     // This is to speed up the launch (less to do and pass through bridge), and avoid repeating
     // migration logic inside native code
+    const onSetUp = (result) => {
+      if (result.error || this._dispatcherType !== 'jsi') {
+        callback(result)
+        return
+      }
+      this._registerSchema(callback)
+    }
+
     this._dispatcher.call('initialize', [this.dbName, this.schema.version], (result) => {
       if (result.error) {
         callback(result)
@@ -143,17 +189,28 @@ export default class SQLiteAdapter implements DatabaseAdapter {
 
       const status = result.value
       if (status.code === 'schema_needed') {
-        this._setUpWithSchema(callback)
+        this._setUpWithSchema(onSetUp)
       } else if (status.code === 'migrations_needed') {
-        this._setUpWithMigrations(status.databaseVersion, callback)
+        this._setUpWithMigrations(status.databaseVersion, onSetUp)
       } else if (status.code !== 'ok') {
         callback({ error: new Error('Invalid database initialization status') })
       } else {
-        callback({ value: undefined })
+        onSetUp({ value: undefined })
       }
     })
   }
 
+  // (JSI only) Passes schema to native once, so that batches can be made of raw records (see batch)
+  _registerSchema(callback: ResultCallback<void>): void {
+    const { encodeDropIndices, encodeCreateIndices } = require('./encodeSchema')
+    const { schema } = this
+    this._dispatcher.call(
+      'registerSchema',
+      [schema, encodeDropIndices(schema), encodeCreateIndices(schema)],
+      callback,
+    )
+  }
+
   _setUpWithMigrations(databaseVersion: SchemaVersion, callback: ResultCallback<void>): void {
     logger.log('[SQLite] Database needs migrations')
     invariant(databaseVersion > 0, 'Invalid database schema version')
@@ -221,10 +278,50 @@ export default class SQLiteAdapter implements DatabaseAdapter {
     )
   }
 
+  // (JSI only) Like find, but finds records of many ids at once. Results are in order of passed ids (null if
+  // there's no such record)
+  findMany(
+    table: TableName<any>,
+    ids: RecordId[],
+    callback: ResultCallback<CachedFindResult[]>,
+  ): void {
+    this.findManyTables({ [table]: ids }, (result) =>
+      callback(mapValue((results) => results[table], result)),
+    )
+  }
+
+  // (JSI only) Like findMany, but finds records of many tables in a single native call
+  findManyTables(
+    idsByTable: { [TableName<any>]: RecordId[] },
+    callback: ResultCallback<{ [TableName<any>]: CachedFindResult[] }>,
+  ): void {
+    if (!this._requireJsi(callback, 'findMany')) {
+      return
+    }
+
+    const tables = Object.keys(idsByTable)
+    tables.forEach((table) => validateTable(table, this.schema))
+    const requests = tables.map((table) => [table, idsByTable[table]])
+    this._dispatcher.call('findMany', [requests], (result) =>
+      callback(
+        mapValue((rawResults) => {
+          const results = {}
+          tables.forEach((table, i) => {
+            const tableSchema = this.schema.tables[table]
+            results[table] = rawResults[i].map((rawRecord) =>
+              sanitizeFindResult(rawRecord, tableSchema),
+            )
+          })
+          return results
+        }, result),
+      ),
+    )
+  }
+
   query(query: SerializedQuery, callback: ResultCallback<CachedQueryResult>): void {
     validateTable(query.table, this.schema)
     const { table } = query
-    const [sql, args] = encodeQuery(query)
+    const [sql, args] = this._encodeQuery(query)
     this._dispatcher.call('query', [table, sql, args], (result) =>
       callback(
         mapValue(
@@ -235,12 +332,41 @@ export default class SQLiteAdapter implements DatabaseAdapter {
     )
   }
 
+  // (JSI only) Executes many queries in a single native call and a single read transaction, so that their results
+  // are consistent with each other. Results are the same as of query/queryIds/count/unsafeQueryRaw, in order
+  // (but native query result cache is not used - its results may come from a different snapshot)
+  queryMany(queries: ReadQuery[], callback: ResultCallback<any[]>): void {
+    if (!this._requireJsi(callback, 'queryMany')) {
+      return
+    }
+
+    queries.forEach(({ query }) => validateTable(query.table, this.schema))
+    const nativeQueries = queries.map(({ kind, query }) => {
+      const [sql, args] = this._encodeQuery(query, kind === 'count')
+      return { kind, table: query.table, sql, args }
+    })
+    this._dispatcher.call('queryMany', [nativeQueries], (result) =>
+      callback(
+        mapValue(
+          (results) =>
+            results.map((queryResult, i) => {
+              const { kind, query } = queries[i]
+              return kind === 'query'
+                ? sanitizeQueryResult(queryResult, this.schema.tables[query.table])
+                : queryResult
+            }),
+          result,
+        ),
+      ),
+    )
+  }
+
   queryIds(query: SerializedQuery, callback: ResultCallback<RecordId[]>): void {
     validateTable(query.table, this.schema)
     this._dispatcher.call(
       'queryIds',
       // $FlowFixMe
-      encodeQuery(query),
+      this._encodeQuery(query),
       callback,
     )
   }
@@ -250,29 +376,74 @@ export default class SQLiteAdapter implements DatabaseAdapter {
     this._dispatcher.call(
       'unsafeQueryRaw',
       // $FlowFixMe
-      encodeQuery(query),
+      this._encodeQuery(query),
       callback,
     )
   }
 
-  count(query: SerializedQuery, callback: ResultCallback<number>): void {
+  // (JSI only) Like unsafeQueryRaw, but returns native rows, which only convert values to JS when accessed.
+  // Useful when only a few columns of a wide table are needed (e.g. in long lists)
+  unsafeQueryRawLazy(query: SerializedQuery, callback: ResultCallback<LazyRawRecord[]>): void {
+    if (!this._requireJsi(callback, 'unsafeQueryRawLazy')) {
+      return
+    }
+
     validateTable(query.table, this.schema)
     this._dispatcher.call(
-      'count',
+      'unsafeQueryRawLazy',
       // $FlowFixMe
-      encodeQuery(query, true),
+      this._encodeQuery(query),
       callback,
     )
   }
 
-  batch(operations: BatchOperation[], callback: ResultCallback<void>): void {
+  // (JSI only) Like unsafeQueryRaw, but returns results per column, in typed arrays (see ColumnarQueryResult).
+  // Use with Q.unsafeSqlQuery to select (or aggregate) specific columns
+  unsafeQueryColumnar(query: SerializedQuery, callback: ResultCallback<ColumnarQueryResult>): void {
+    if (!this._requireJsi(callback, 'unsafeQueryColumnar')) {
+      return
+    }
+
+    validateTable(query.table, this.schema)
     this._dispatcher.call(
-      'batch',
-      [require('./encodeBatch').default(operations, this.schema)],
+      'queryColumnar',
+      // $FlowFixMe
+      this._encodeQuery(query),
       callback,
     )
   }
 
+  count(query: SerializedQuery, callback: ResultCallback<number>): void {
+    validateTable(query.table, this.schema)
+    this._dispatcher.call(
+      'count',
+      // $FlowFixMe
+      this._encodeQuery(query, true),
+      callback,
+    )
+  }
+
+  // NOTE: durability is only supported with JSI. Without it, batches use connection's default durability
+  // (on Android, `synchronous = FULL`, i.e. the same as 'full')
+  batch(
+    operations: BatchOperation[],
+    callback: ResultCallback<void>,
+    durability?: BatchDurability,
+  ): void {
+    const { default: encodeBatch, RECREATE_INDICES_BATCH_SIZE } = require('./encodeBatch')
+    if (this._dispatcherType === 'jsi') {
+      // NOTE: SQL and arguments are made natively from raw records, using schema registered in _init
+      this._dispatcher.call(
+        'batchRecords',
+        [operations, operations.length >= RECREATE_INDICES_BATCH_SIZE, durability || null],
+        callback,
+      )
+      return
+    }
+
+    this._dispatcher.call('batch', [encodeBatch(operations, this.schema)], callback)
+  }
+
   getDeletedRecords(table: TableName<any>, callback: ResultCallback<RecordId[]>): void {
     validateTable(table, this.schema)
     this._dispatcher.call(
@@ -298,8 +469,7 @@ export default class SQLiteAdapter implements DatabaseAdapter {
   }
 
   unsafeLoadFromSync(jsonId: number, callback: ResultCallback<any>): void {
-    if (this._dispatcherType !== 'jsi') {
-      callback({ error: new Error('unsafeLoadFromSync unavailable') })
+    if (!this._requireJsi(callback, 'unsafeLoadFromSync')) {
       return
     }
 
@@ -320,14 +490,192 @@ export default class SQLiteAdapter implements DatabaseAdapter {
   }
 
   provideSyncJson(id: number, syncPullResultJson: string, callback: ResultCallback<void>): void {
-    if (this._dispatcherType !== 'jsi') {
-      callback({ error: new Error('provideSyncJson unavailable') })
+    if (!this._requireJsi(callback, 'provideSyncJson')) {
       return
     }
 
     this._dispatcher.call('provideSyncJson', [id, syncPullResultJson], callback)
   }
 
+  // (JSI only) Returns stats of native prepared statement caches - useful for diagnosing memory use
+  getStatementCacheStats(callback: ResultCallback<StatementCacheStats>): void {
+    if (!this._requireJsi(callback, 'getStatementCacheStats')) {
+      return
+    }
+
+    this._dispatcher.call('getStatementCacheStats', [], callback)
+  }
+
+  // (JSI only) Tells native that records were released by JS's RecordCache, so that they're sent in full (not
+  // as ids) the next time they're queried. Returns number of ids that were cached natively
+  evictCachedRecords(table: TableName<any>, ids: RecordId[], callback: ResultCallback<number>): void {
+    if (!this._requireJsi(callback, 'evictCachedRecords')) {
+      return
+    }
+
+    this._dispatcher.call('evictCachedRecords', [table, ids], callback)
+  }
+
+  // (JSI only) Returns number and memory use of record ids known (natively) to be cached in JS
+  getRecordCacheStats(callback: ResultCallback<RecordCacheStats>): void {
+    if (!this._requireJsi(callback, 'getRecordCacheStats')) {
+      return
+    }
+
+    this._dispatcher.call('getRecordCacheStats', [], callback)
+  }
+
+  // (JSI only) Enables (or disables, if maxCount is 0) native cache of rows read by find, so that finding a
+  // record again (e.g. after it was released by JS) doesn't query SQLite. Cache is bounded by number of rows
+  // and (approximate) memory used in bytes
+  configureRowCache(maxCount: number, maxMemory: number, callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'configureRowCache')) {
+      return
+    }
+
+    this._dispatcher.call('configureRowCache', [maxCount, maxMemory], callback)
+  }
+
+  // (JSI only) Returns hit rate and size of native row cache
+  getRowCacheStats(callback: ResultCallback<RowCacheStats>): void {
+    if (!this._requireJsi(callback, 'getRowCacheStats')) {
+      return
+    }
+
+    this._dispatcher.call('getRowCacheStats', [], callback)
+  }
+
+  // (JSI only) Enables (or disables, if maxMemory is 0) native cache of results of query, queryIds and count,
+  // bounded by (approximate) memory used in bytes. Results are invalidated when a transaction changes any
+  // of the tables they read. Results are not cached for private in-memory databases, or with
+  // usesExclusiveLocking
+  configureQueryCache(maxMemory: number, callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'configureQueryCache')) {
+      return
+    }
+
+    this._dispatcher.call('configureQueryCache', [maxMemory], callback)
+  }
+
+  // (JSI only) Enables (or disables, if windowMs is 0) coalescing of async batches (with experimentalUsesAsyncJSI).
+  // Batches made within windowMs of the first one are executed in a single transaction (each in its own
+  // savepoint, so a failed batch doesn't affect others), and are resolved after it's committed. Note that other
+  // async work made after a batch is not delayed by the window, but it does end it
+  configureWriteCoalescing(windowMs: number, callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'configureWriteCoalescing')) {
+      return
+    }
+
+    this._dispatcher.call('configureWriteCoalescing', [windowMs], callback)
+  }
+
+  // (JSI only) Returns hit rate and size of native query result cache
+  getQueryCacheStats(callback: ResultCallback<QueryCacheStats>): void {
+    if (!this._requireJsi(callback, 'getQueryCacheStats')) {
+      return
+    }
+
+    this._dispatcher.call('getQueryCacheStats', [], callback)
+  }
+
+  // (JSI only) Starts collecting rows changed by every committed transaction - including ones not made with
+  // batch (e.g. unsafeExecute). Changes are kept until drained with drainChanges
+  enableChangeCapture(callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'enableChangeCapture')) {
+      return
+    }
+
+    this._dispatcher.call('enableChangeCapture', [], callback)
+  }
+
+  // (JSI only) Returns changes committed since last call (one change set per transaction)
+  drainChanges(callback: ResultCallback<NativeChangeSet[]>): void {
+    if (!this._requireJsi(callback, 'drainChanges')) {
+      return
+    }
+
+    this._dispatcher.call('drainChanges', [], callback)
+  }
+
+  // (JSI only) Registers a query to be observed. It's marked as dirty natively when a transaction that changes
+  // any of its tables (including joined tables) commits, so that only dirty queries have to be re-executed.
+  // Returns a handle, which must be unregistered with unregisterLiveQuery when no longer observed
+  registerLiveQuery(query: SerializedQuery, kind: LiveQueryKind, callback: ResultCallback<number>): void {
+    if (!this._requireJsi(callback, 'registerLiveQuery')) {
+      return
+    }
+
+    validateTable(query.table, this.schema)
+    const [sql, args] = this._encodeQuery(query, kind === 'count')
+    const tables = [query.table].concat(query.associations.map(({ to }) => to))
+    this._dispatcher.call('registerLiveQuery', [sql, args, tables, kind], callback)
+  }
+
+  unregisterLiveQuery(handle: number, callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'unregisterLiveQuery')) {
+      return
+    }
+
+    this._dispatcher.call('unregisterLiveQuery', [handle], callback)
+  }
+
+  // (JSI only) Returns handles of live queries that may have changed results since last call
+  drainDirtyQueries(callback: ResultCallback<number[]>): void {
+    if (!this._requireJsi(callback, 'drainDirtyQueries')) {
+      return
+    }
+
+    this._dispatcher.call('drainDirtyQueries', [], callback)
+  }
+
+  // (JSI only) Re-executes live queries that may have changed results since last call, and returns their new
+  // results. Clean queries are not executed. Results of `ids` queries are differences from their last results
+  // (kept natively), to be applied with applyIdsDiff - so that unchanged ids don't have to be passed to JS
+  refreshDirtyQueries(callback: ResultCallback<LiveQueryResult[]>): void {
+    if (!this._requireJsi(callback, 'refreshDirtyQueries')) {
+      return
+    }
+
+    this._dispatcher.call('refreshDirtyQueries', [], callback)
+  }
+
+  // (JSI only) Compiles conditions of a simple query (one that can be observed with encodeMatcher) natively.
+  // Returns a handle, which must be unregistered with unregisterMatcher when no longer needed
+  registerMatcher(query: SerializedQuery, callback: ResultCallback<number>): void {
+    if (!this._requireJsi(callback, 'registerMatcher')) {
+      return
+    }
+    if (!canEncodeMatcher(query.description)) {
+      callback({ error: new Error(forbiddenError) })
+      return
+    }
+
+    validateTable(query.table, this.schema)
+    this._dispatcher.call(
+      'registerMatcher',
+      [query.table, JSON.stringify(query.description.where)],
+      callback,
+    )
+  }
+
+  unregisterMatcher(handle: number, callback: ResultCallback<void>): void {
+    if (!this._requireJsi(callback, 'unregisterMatcher')) {
+      return
+    }
+
+    this._dispatcher.call('unregisterMatcher', [handle], callback)
+  }
+
+  // (JSI only) Checks rows inserted, updated or deleted since last call against all registered matchers of their
+  // tables, and returns ids of matching and not matching (or deleted) records of every matcher of a changed table
+  matchChangedRows(callback: ResultCallback<MatcherMatch[]>): void {
+    if (!this._requireJsi(callback, 'matchChangedRows')) {
+      return
+    }
+
+    this._dispatcher.call('matchChangedRows', [], callback)
+  }
+
   unsafeResetDatabase(callback: ResultCallback<void>): void {
     this._dispatcher.call(
       'unsafeResetDatabase',
@@ -364,8 +712,23 @@ export default class SQLiteAdapter implements DatabaseAdapter {
     this._dispatcher.call('getLocal', [key], callback)
   }
 
+  // (JSI only) Like getLocal, but gets values of many keys at once (null if there's no value)
+  getLocalMany(keys: string[], callback: ResultCallback<Array<?string>>): void {
+    if (!this._requireJsi(callback, 'getLocalMany')) {
+      return
+    }
+
+    this._dispatcher.call('getLocalMany', [keys], callback)
+  }
+
   setLocal(key: string, value: string, callback: ResultCallback<void>): void {
     invariant(typeof value === 'string', 'adapter.setLocal() value must be a string')
+    if (this._dispatcherType === 'jsi') {
+      // NOTE: Written through native local storage cache
+      this._dispatcher.call('setLocal', [key, value], callback)
+      return
+    }
+
     const operation = [
       IGNORE_CACHE,
       null,
@@ -376,10 +739,29 @@ export default class SQLiteAdapter implements DatabaseAdapter {
   }
 
   removeLocal(key: string, callback: ResultCallback<void>): void {
+    if (this._dispatcherType === 'jsi') {
+      this._dispatcher.call('removeLocal', [key], callback)
+      return
+    }
+
     const operation = [IGNORE_CACHE, null, `delete from "local_storage" where "key" == ?`, [[key]]]
     this._dispatcher.call('batch', [[operation]], callback)
   }
 
+  // Returns false (and calls back with an error) if method is not available, because JSI is not used
+  _requireJsi(callback: ResultCallback<any>, methodName: string): boolean {
+    if (this._dispatcherType !== 'jsi') {
+      callback({ error: new Error(`${methodName} unavailable`) })
+      return false
+    }
+    return true
+  }
+
+  _encodeQuery(query: SerializedQuery, countMode: boolean = false): SQLiteQuery {
+    // NOTE: Only JSI can bind Q.oneOf/Q.notIn lists as a single argument
+    return encodeQuery(query, countMode, this._dispatcherType === 'jsi' ? 'arrays' : 'placeholders')
+  }
+
   _encodedSchema(): SQL {
     return require('./encodeSchema').encodeSchema(this.schema)
   }
@@ -6,6 +6,7 @@ import { type ConnectionTag } from '../../../utils/common'
 import { type ResultCallback } from '../../../utils/fp/Result'
 import type {
   DispatcherType,
+  QueryResultFormat,
   SQLiteAdapterOptions,
   SqliteDispatcher,
   SqliteDispatcherMethod,
@@ -35,6 +36,8 @@ export const makeDispatcher = (
   tag: ConnectionTag,
   _dbName: string,
   _usesExclusiveLocking: boolean,
+  _usesAsyncMethods: boolean,
+  _queryResultFormat: ?QueryResultFormat,
 ): SqliteDispatcher => {
   return new SqliteNodeDispatcher(tag)
 }
@@ -6,10 +6,12 @@ import { type ConnectionTag, logger, invariant } from '../../../utils/common'
 import { fromPromise, type ResultCallback } from '../../../utils/fp/Result'
 import type {
   DispatcherType,
+  QueryResultFormat,
   SQLiteAdapterOptions,
   SqliteDispatcher,
   SqliteDispatcherMethod,
 } from '../type'
+import encodeBinaryBatch from '../encodeBinaryBatch'
 
 const { DatabaseBridge } = NativeModules
 
@@ -37,23 +39,105 @@ class SqliteNativeModulesDispatcher implements SqliteDispatcher {
   }
 }
 
+// Methods that can be executed using a prepared query handle instead of SQL
+const preparedQueryMethods: { [string]: string } = {
+  query: 'executeQuery',
+  queryAsArray: 'executeQueryAsArray',
+  queryAsJSON: 'executeQueryAsJSON',
+  queryIds: 'executeQueryIds',
+  count: 'executeCount',
+}
+const preparedQueriesLimit = 64
+
+function decodeResult(methodName: string, result: any): any {
+  switch (methodName) {
+    case 'queryAsArray':
+    case 'executeQueryAsArray':
+      return require('./decodeQueryResult').default(result)
+    case 'queryAsJSON':
+    case 'executeQueryAsJSON':
+      return require('./decodeQueryResult').default(JSON.parse(result))
+    default:
+      return result
+  }
+}
+
 class SqliteJsiDispatcher implements SqliteDispatcher {
   _db: any
+  _usesAsyncMethods: boolean
+  _queryMethod: string
+  _preparedQueries: Map<string, number> // sql -> handle, least recently used first
   _unsafeErrorListener: (Error) => void // debug hook for NT use
 
-  constructor(dbName: string, usesExclusiveLocking: boolean): void {
+  constructor(
+    dbName: string,
+    usesExclusiveLocking: boolean,
+    usesAsyncMethods: boolean,
+    queryResultFormat: ?QueryResultFormat,
+  ): void {
     this._db = global.nativeWatermelonCreateAdapter(dbName, usesExclusiveLocking)
+    // NOTE: Async methods are not available on Android - synchronous methods are used instead
+    this._usesAsyncMethods = usesAsyncMethods && !!this._db.findAsync
+    if (usesAsyncMethods && !this._usesAsyncMethods) {
+      logger.warn(
+        '[SQLite] experimentalUsesAsyncJSI is not supported on this platform (only iOS), so database work will block JS thread. Parallel reads, write coalescing and deferred checkpoints are not available either',
+      )
+    }
+    // NOTE: compressing results of a query into a compact array makes querying 15-30% faster on JSC
+    // but actually 9% slower on Hermes (presumably because Hermes has faster C++ JSI and slower JS execution)
+    const format = queryResultFormat || (global.HermesInternal ? 'objects' : 'arrays')
+    this._queryMethod =
+      format === 'json' && this._db.queryAsJSON
+        ? 'queryAsJSON'
+        : format === 'arrays'
+        ? 'queryAsArray'
+        : 'query'
+    this._preparedQueries = new Map()
     this._unsafeErrorListener = () => {}
   }
 
+  // Returns handle of a native prepared statement for this query, so that native side doesn't have to
+  // convert and look up SQL on every call. Least recently used handles are released
+  _preparedQuery(sql: string): number {
+    const cachedHandle = this._preparedQueries.get(sql)
+    if (cachedHandle !== undefined) {
+      this._preparedQueries.delete(sql)
+      this._preparedQueries.set(sql, cachedHandle)
+      return cachedHandle
+    }
+
+    const handle = this._db.prepare(sql)
+    // On Android, errors are returned, not thrown - see DatabaseInstallation.cpp
+    if (handle instanceof Error) {
+      throw handle
+    }
+    this._preparedQueries.set(sql, handle)
+
+    if (this._preparedQueries.size > preparedQueriesLimit) {
+      const [leastRecentSql, leastRecentHandle] = this._preparedQueries.entries().next().value
+      this._preparedQueries.delete(leastRecentSql)
+      this._db.release(leastRecentHandle)
+    }
+
+    return handle
+  }
+
   call(name: SqliteDispatcherMethod, _args: any[], callback: ResultCallback<any>): void {
     let methodName = name
     let args = _args
 
-    if (methodName === 'query' && !global.HermesInternal) {
-      // NOTE: compressing results of a query into a compact array makes querying 15-30% faster on JSC
-      // but actually 9% slower on Hermes (presumably because Hermes has faster C++ JSI and slower JS execution)
-      methodName = 'queryAsArray'
+    if (methodName === 'query') {
+      methodName = this._queryMethod
+    } else if (methodName === 'batch' && this._db.batchBinary) {
+      // NOTE: Binary batch is faster to encode in JS and to decode natively than JSON. Record batches
+      // go to batchRecords, so only raw SQL operations (unsafeExecute, local storage etc.) end up here
+      methodName = 'batchBinary'
+      try {
+        args = [encodeBinaryBatch(args[0])]
+      } catch (error) {
+        callback({ error })
+        return
+      }
     } else if (methodName === 'batch') {
       methodName = 'batchJSON'
       args = [JSON.stringify(args[0])]
@@ -62,7 +146,32 @@ class SqliteJsiDispatcher implements SqliteDispatcher {
       return
     }
 
+    const asyncMethod = this._usesAsyncMethods ? this._db[`${methodName}Async`] : null
+    if (asyncMethod) {
+      // NOTE: Executed on a native background thread, results are resolved back on JS thread
+      asyncMethod(...args).then(
+        (result) => {
+          callback({ value: decodeResult(methodName, result) })
+        },
+        (error) => {
+          this._unsafeErrorListener(error)
+          callback({ error })
+        },
+      )
+      return
+    }
+
     try {
+      const preparedMethodName = preparedQueryMethods[methodName]
+      if (preparedMethodName && this._db[preparedMethodName]) {
+        // NOTE: query(table, sql, args), queryIds(sql, args) -> executeQuery(handle, table, args), ...
+        const hasTable = args.length === 3
+        const sql = hasTable ? args[1] : args[0]
+        const handle = this._preparedQuery(sql)
+        args = hasTable ? [handle, args[0], args[2]] : [handle, args[1]]
+        methodName = preparedMethodName
+      }
+
       const method = this._db[methodName]
       if (!method) {
         throw new Error(
@@ -71,15 +180,12 @@ class SqliteJsiDispatcher implements SqliteDispatcher {
           ).join(',')}`,
         )
       }
-      let result = method(...args)
+      const result = method(...args)
       // On Android, errors are returned, not thrown - see DatabaseInstallation.cpp
       if (result instanceof Error) {
         throw result
       } else {
-        if (methodName === 'queryAsArray') {
-          result = require('./decodeQueryResult').default(result)
-        }
-        callback({ value: result })
+        callback({ value: decodeResult(methodName, result) })
       }
     } catch (error) {
       this._unsafeErrorListener(error)
@@ -93,9 +199,11 @@ export const makeDispatcher = (
   tag: ConnectionTag,
   dbName: string,
   usesExclusiveLocking: boolean,
+  usesAsyncMethods: boolean,
+  queryResultFormat: ?QueryResultFormat,
 ): SqliteDispatcher =>
   type === 'jsi'
-    ? new SqliteJsiDispatcher(dbName, usesExclusiveLocking)
+    ? new SqliteJsiDispatcher(dbName, usesExclusiveLocking, usesAsyncMethods, queryResultFormat)
     : new SqliteNativeModulesDispatcher(tag)
 
 const initializeJSI = () => {
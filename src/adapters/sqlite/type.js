@@ -4,6 +4,8 @@ import { type ResultCallback } from '../../utils/fp/Result'
 
 import type { AppSchema, TableName, SchemaVersion } from '../../Schema'
 import type { SchemaMigrations } from '../../Schema/migrations'
+import type { RecordId } from '../../Model'
+import type { SerializedQuery } from '../../Query'
 
 export type SQL = string
 export type SQLiteArg = string | boolean | number | null
@@ -30,10 +32,136 @@ export type SQLiteAdapterOptions = $Exact<{
   // Sets exclusive file locking mode in sqlite. Use this ONLY if you need to - e.g. seems to fix
   // mysterious "database is malformed" issues on JSI+Android when using Headless JS
   usesExclusiveLocking?: boolean,
+  // (JSI only, iOS only) Executes queries and batches on a native background thread instead of blocking JS
+  // thread. Results are returned asynchronously. On Android, this option has no effect (other than
+  // a warning), so parallel reads, write coalescing (configureWriteCoalescing) and deferred
+  // checkpoints (durability: 'deferred') are not available there either
+  experimentalUsesAsyncJSI?: boolean,
+  // (JSI only) Format in which query results are passed from native to JS:
+  // - 'objects' - an object per record
+  // - 'arrays' - an array of values per record (faster on JSC, but slower on Hermes)
+  // - 'json' - one JSON string, built natively, and decoded with JSON.parse (one JSI call per query)
+  // By default, 'arrays' is used on JSC, and 'objects' on Hermes
+  experimentalQueryResultFormat?: QueryResultFormat,
 }>
 
+export type QueryResultFormat = 'objects' | 'arrays' | 'json'
+
 export type DispatcherType = 'asynchronous' | 'jsi'
 
+// Stats of native prepared statement caches (summed across all connections)
+export type StatementCacheStats = $Exact<{
+  hits: number,
+  misses: number,
+  hitRate: number,
+  evictions: number,
+  liveStatements: number,
+  pinnedStatements: number,
+  memoryUsed: number, // approximate, in bytes
+}>
+
+export type RecordCacheStats = $Exact<{
+  tables: number,
+  records: number,
+  memoryUsed: number, // approximate, in bytes
+}>
+
+export type RowCacheStats = $Exact<{
+  hits: number,
+  misses: number,
+  hitRate: number,
+  evictions: number,
+  invalidations: number,
+  rows: number,
+  memoryUsed: number, // approximate, in bytes
+}>
+
+export type QueryCacheStats = $Exact<{
+  hits: number,
+  misses: number,
+  hitRate: number,
+  evictions: number,
+  invalidations: number,
+  entries: number,
+  memoryUsed: number, // approximate, in bytes
+}>
+
+// Row returned by unsafeQueryRawLazy. Values are converted from native only when accessed. Call toRaw() to
+// get a plain object with all values
+export type LazyRawRecord = {
+  +[column: string]: any,
+  toRaw(): { [column: string]: any },
+}
+
+// Result of queryColumnar - values are returned per column, not per row, so that large numbers of rows can be
+// processed (e.g. aggregated) without creating an object for each. For row `i` of a column, value is:
+// - null, if bit `i` of `nulls` is set (`nulls[i >> 3] & (1 << (i & 7))`)
+// - `strings[columns.strings[i]]`, if `columns.strings[i]` is not -1
+// - `numbers[i]` otherwise
+// Arrays (numbers/strings/nulls) of a column are null if the column contains no values of that type
+export type ColumnarQueryResultColumn = $Exact<{
+  name: string,
+  numbers: ?Float64Array,
+  strings: ?Int32Array,
+  nulls: ?Uint8Array,
+}>
+
+export type ColumnarQueryResult = $Exact<{
+  rowCount: number,
+  columns: ColumnarQueryResultColumn[],
+  strings: string[], // deduplicated
+}>
+
+// Rows changed by a single committed transaction, by table name (see ChangeCapture.h).
+// `inserted`/`updated` are ids of records that still exist, `deleted` are ids of records deleted by batch
+// (ids of records deleted by other queries can't be known - only their rowids)
+export type NativeTableChanges = $Exact<{
+  inserted: RecordId[],
+  updated: RecordId[],
+  deleted: RecordId[],
+  insertedRowids: number[],
+  updatedRowids: number[],
+  deletedRowids: number[],
+}>
+
+export type NativeChangeSet = { [tableName: string]: NativeTableChanges }
+
+export type LiveQueryKind = 'ids' | 'count'
+
+// Difference between last known and new ids of a live query (see IdsDiff in LiveQueries.h).
+// Apply with applyIdsDiff
+export type IdsDiff = $Exact<{
+  length: number,
+  insertedIds: RecordId[],
+  insertedPositions: number[], // in the new list
+  removedPositions: number[], // in the previous list
+  movedRanges: number[], // (from, to, count) triples
+}>
+
+// New results of a re-executed live query - `diff` or `count`, depending on its kind
+export type LiveQueryResult = $Exact<{
+  handle: number,
+  diff?: IdsDiff,
+  count?: number,
+}>
+
+// Ids of changed records of a native observation matcher's table - `ids` match it, `unmatchedIds` don't
+// (or were deleted). If rows were deleted by unsafe SQL, their ids are unknown (`hasUnknownDeletions`)
+export type MatcherMatch = $Exact<{
+  handle: number,
+  ids: RecordId[],
+  unmatchedIds: RecordId[],
+  hasUnknownDeletions: boolean,
+}>
+
+// Query made with queryMany - `kind` is the adapter method whose result is returned
+export type ReadQueryKind = 'query' | 'ids' | 'count' | 'raw'
+
+export type ReadQuery = $Exact<{
+  kind: ReadQueryKind,
+  query: SerializedQuery,
+}>
+
 // This is the internal format of batch operations
 // It's ugly, but optimized for performance and versatility, e.g.:
 // adding a record:  [1, 'table', 'insert into...', [['id', 'created', ...]]]
@@ -63,16 +191,42 @@ export type SqliteDispatcherMethod =
   | 'setUpWithSchema'
   | 'setUpWithMigrations'
   | 'find'
+  | 'findMany'
+  | 'queryMany'
   | 'query'
   | 'queryIds'
   | 'unsafeQueryRaw'
+  | 'unsafeQueryRawLazy'
+  | 'queryColumnar'
   | 'count'
   | 'batch'
+  | 'registerSchema'
+  | 'batchRecords'
   | 'unsafeLoadFromSync'
   | 'provideSyncJson'
   | 'unsafeResetDatabase'
   | 'getLocal'
+  | 'getLocalMany'
+  | 'setLocal'
+  | 'removeLocal'
   | 'unsafeExecuteMultiple'
+  | 'getStatementCacheStats'
+  | 'evictCachedRecords'
+  | 'getRecordCacheStats'
+  | 'configureRowCache'
+  | 'getRowCacheStats'
+  | 'configureQueryCache'
+  | 'getQueryCacheStats'
+  | 'configureWriteCoalescing'
+  | 'enableChangeCapture'
+  | 'drainChanges'
+  | 'registerLiveQuery'
+  | 'unregisterLiveQuery'
+  | 'drainDirtyQueries'
+  | 'refreshDirtyQueries'
+  | 'registerMatcher'
+  | 'unregisterMatcher'
+  | 'matchChangedRows'
 
 export interface SqliteDispatcher {
   call(methodName: SqliteDispatcherMethod, args: any[], callback: ResultCallback<any>): void;
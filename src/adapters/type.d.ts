@@ -18,6 +18,8 @@ export type BatchOperation =
   | ['markAsDeleted', TableName<any>, RecordId]
   | ['destroyPermanently', TableName<any>, RecordId]
 
+export type BatchDurability = 'full' | 'normal' | 'deferred'
+
 export type UnsafeExecuteOperations =
   | $Exact<{ sqls: SQLiteQuery[] }>
   | $Exact<{ loki: (Loki) => void }>
@@ -45,7 +47,11 @@ export interface DatabaseAdapter {
   count(query: SerializedQuery, callback: ResultCallback<number>): void
 
   // Executes multiple prepared operations
-  batch(operations: BatchOperation[], callback: ResultCallback<void>): void
+  batch(
+    operations: BatchOperation[],
+    callback: ResultCallback<void>,
+    durability?: BatchDurability,
+  ): void
 
   // Return marked as deleted records
   getDeletedRecords(tableName: TableName<any>, callback: ResultCallback<RecordId[]>): void
@@ -19,6 +19,13 @@ export type BatchOperation =
   | ['markAsDeleted', TableName<any>, RecordId]
   | ['destroyPermanently', TableName<any>, RecordId]
 
+// How durable a batch should be once it's committed (a hint - adapters may ignore it):
+// - 'full' - survives app crashes and power loss
+// - 'normal' - survives app crashes, but may be lost (not corrupted) on power loss, until the next 'full' batch
+// - 'deferred' - like 'normal', but committing is cheaper still, since making it durable is deferred until idle
+// By default, adapter's default durability is used
+export type BatchDurability = 'full' | 'normal' | 'deferred'
+
 export type UnsafeExecuteOperations =
   | $Exact<{ sqls: SQLiteQuery[] }>
   | $Exact<{ sqlString: SQL }> // JSI-only
@@ -47,7 +54,11 @@ export interface DatabaseAdapter {
   count(query: SerializedQuery, callback: ResultCallback<number>): void;
 
   // Executes multiple prepared operations
-  batch(operations: BatchOperation[], callback: ResultCallback<void>): void;
+  batch(
+    operations: BatchOperation[],
+    callback: ResultCallback<void>,
+    durability?: BatchDurability,
+  ): void;
 
   // Return marked as deleted records
   getDeletedRecords(tableName: TableName<any>, callback: ResultCallback<RecordId[]>): void;